@@ -0,0 +1,256 @@
+#!/bin/sh
+# Testes dos formatos de arquivo do tetris_mestre: cada arquivo gravado é
+# lido de volta e comparado com a execução que o gerou, e cópias truncadas
+# ou com um byte alterado precisam ser recusadas (código de saída != 0).
+# Uso: testes/teste_arquivos.sh [caminho do tetris_mestre]
+
+MESTRE=${1:-./tetris_mestre}
+DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+falhas=0
+verificacoes=0
+
+falhar() {
+    echo "FALHA: $*" >&2
+    falhas=$((falhas + 1))
+}
+
+# confere "descrição" valor_obtido valor_esperado
+confere() {
+    verificacoes=$((verificacoes + 1))
+    [ "$2" = "$3" ] || falhar "$1: obtido '$2', esperado '$3'"
+}
+
+# Valor de 'chave=' na saída (primeira ocorrência)
+campo() {
+    printf '%s\n' "$1" | tr ' ' '\n' | sed -n "s/^$2=//p" | head -n 1
+}
+
+# Gera N comandos de 1 a 5 (e alguns inválidos) a partir de uma semente
+gerarComandos() {
+    awk -v n="$1" -v s="$2" 'BEGIN { srand(s); for (i = 0; i < n; i++) {
+        r = int(rand() * 40); print (r < 38 ? 1 + r % 5 : 6 + r % 3) } }'
+}
+
+# Copia 'origem' para 'destino' com o byte da posição 'posicao' invertido
+alterarByte() {
+    cp "$1" "$2"
+    byte=$(od -An -tu1 -j "$3" -N 1 "$1" | tr -d ' ')
+    printf "$(printf '\\%03o' $((byte ^ 255)))" |
+        dd of="$2" bs=1 seek="$3" conv=notrunc 2>/dev/null
+}
+
+# Grava 'valor' em 'arquivo' como inteiro little-endian de 'bytes' bytes na
+# posição 'posicao' (aritmética de 64 bits do shell: negativos dão a volta)
+escreverLE() {
+    i=0
+    while [ "$i" -lt "$4" ]; do
+        printf "$(printf '\\%03o' $((($3 >> (8 * i)) & 255)))" |
+            dd of="$1" bs=1 seek=$(($2 + i)) conv=notrunc 2>/dev/null
+        i=$((i + 1))
+    done
+}
+
+# somaPalavras arquivo pular [bytes]: soma de verificação, como
+# continuarSoma, das palavras de 64 bits dos primeiros 'bytes' bytes (todo o
+# arquivo se omitido), menos a da posição 'pular' (a própria soma)
+somaPalavras() {
+    soma=$(((0x84222325 << 32) | 0xCBF29CE4))
+    posicao=0
+    for metades in $(od -An -v -tx4 ${3:+-N "$3"} "$1" | tr -s ' ' '\n' | sed '/^$/d' | paste -d: - -); do
+        if [ "$posicao" -ne "$2" ]; then
+            palavra=$(((0x${metades#*:} << 32) | 0x${metades%:*}))
+            x=$(((soma ^ palavra) * ((0x9E3779B9 << 32) | 0x7F4A7C15)))
+            soma=$(((x << 31) | ((x >> 33) & 0x7FFFFFFF)))
+        fi
+        posicao=$((posicao + 8))
+    done
+    echo "$soma"
+}
+
+# recusa "descrição" comando... : o comando precisa terminar com erro
+recusa() {
+    descricao=$1
+    shift
+    verificacoes=$((verificacoes + 1))
+    if "$@" >/dev/null 2>&1; then
+        falhar "$descricao foi aceito"
+    fi
+}
+
+# Cópias truncadas em vários pontos e com cada byte alterado são recusadas.
+# 'X' nos argumentos é trocado pelo arquivo alterado.
+recusaAlterados() {
+    original=$1
+    shift
+    tamanho=$(wc -c < "$original")
+    for corte in 0 1 8 31 $((tamanho / 2)) $((tamanho - 1)); do
+        head -c "$corte" "$original" > "$DIR/alterado"
+        recusa "$original truncado em $corte bytes" $(printf '%s\n' "$@" | sed "s|^X$|$DIR/alterado|")
+    done
+    posicao=0
+    while [ "$posicao" -lt "$tamanho" ]; do
+        alterarByte "$original" "$DIR/alterado" "$posicao"
+        recusa "$original com o byte $posicao alterado" $(printf '%s\n' "$@" | sed "s|^X$|$DIR/alterado|")
+        posicao=$((posicao + 1))
+    done
+}
+
+# ---------------------------------------------------------------------------
+# Registro de eventos: gravar, refazer e comparar com o lote
+# ---------------------------------------------------------------------------
+
+# O último campo de cada caso é o K de --troca (as ações 5 precisam usá-lo)
+for caso in "7 aleatorio 5 3 10x20 3" "8 sacola7 2 40 6x8 2" "9 sacola4 17 1 - 1" "10 aleatorio 17 40 10x20 9"; do
+    set -- $caso
+    gerarComandos 400 "$1" > "$DIR/comandos"
+    opcoes="--semente $1 --gerador $2 --fila $3 --pilha $4 --troca $6"
+    [ "$5" != "-" ] && opcoes="$opcoes --tabuleiro $5"
+
+    lote=$($MESTRE $opcoes --lote "$DIR/comandos" --registro "$DIR/partida.log" 2>/dev/null)
+    replay=$($MESTRE --replay "$DIR/partida.log")
+    confere "replay ($caso)" "$(campo "$replay" replay)" ok
+    confere "ações do replay ($caso)" "$(campo "$replay" acoes)" "$(campo "$lote" comandos)"
+    confere "resumo do replay ($caso)" "$(campo "$replay" resumo)" "$(campo "$lote" resumo)"
+done
+
+gerarComandos 120 11 > "$DIR/comandos"
+$MESTRE --semente 11 --tabuleiro 10x20 --lote "$DIR/comandos" --registro "$DIR/curto.log" >/dev/null 2>&1
+recusaAlterados "$DIR/curto.log" "$MESTRE" --replay X
+
+# ---------------------------------------------------------------------------
+# Arquivo de replay: buscar a ação N é igual a refazer as N primeiras ações
+# ---------------------------------------------------------------------------
+
+gerarComandos 500 21 > "$DIR/comandos"
+opcoes="--semente 21 --gerador sacola7 --fila 4 --pilha 3 --troca 2 --tabuleiro 8x12"
+$MESTRE $opcoes --lote "$DIR/comandos" --registro "$DIR/partida.log" >/dev/null 2>&1
+
+for intervalo in 1 7 64 100000; do
+    $MESTRE --arquivar "$DIR/partida.log" "$DIR/partida.arq" --intervalo $intervalo >/dev/null
+    for n in 0 1 6 7 8 63 64 65 250 499 500; do
+        head -n $n "$DIR/comandos" > "$DIR/prefixo"
+        linear=$($MESTRE $opcoes --lote "$DIR/prefixo" 2>/dev/null)
+        busca=$($MESTRE --buscar "$DIR/partida.arq" $n 2>/dev/null)
+        for chave in fila_tamanho pilha_tamanho proximo_id resumo_tabuleiro hash; do
+            confere "busca da ação $n, intervalo $intervalo: $chave" \
+                "$(campo "$busca" $chave)" "$(campo "$linear" $chave)"
+        done
+    done
+done
+recusa "busca além do fim" $MESTRE --buscar "$DIR/partida.arq" 501
+
+# Um arquivo alterado pode ser recusado ou, se o byte alterado não é lido
+# pela busca, dar a mesma resposta; nunca uma resposta diferente
+gerarComandos 60 22 > "$DIR/comandos"
+$MESTRE --semente 22 --fila 2 --pilha 1 --lote "$DIR/comandos" --registro "$DIR/curto.log" >/dev/null 2>&1
+$MESTRE --arquivar "$DIR/curto.log" "$DIR/curto.arq" --intervalo 16 >/dev/null
+tamanho=$(wc -c < "$DIR/curto.arq")
+for corte in 0 64 127 $((tamanho / 2)) $((tamanho - 1)); do
+    head -c "$corte" "$DIR/curto.arq" > "$DIR/alterado"
+    recusa "arquivo truncado em $corte bytes" $MESTRE --buscar "$DIR/alterado" 60
+done
+for n in 7 60; do
+    esperado=$($MESTRE --buscar "$DIR/curto.arq" $n 2>/dev/null)
+    posicao=0
+    while [ "$posicao" -lt "$tamanho" ]; do
+        alterarByte "$DIR/curto.arq" "$DIR/alterado" "$posicao"
+        verificacoes=$((verificacoes + 1))
+        if obtido=$($MESTRE --buscar "$DIR/alterado" $n 2>/dev/null) && [ "$obtido" != "$esperado" ]; then
+            falhar "arquivo com o byte $posicao alterado deu outra resposta para a ação $n"
+        fi
+        posicao=$((posicao + 1))
+    done
+done
+
+# Cabeçalho forjado com a soma refeita (posição 120, sobre os 120 bytes
+# anteriores): trechos cujo fim dá a volta em 64 bits e um índice fora de
+# ordem precisam ser recusados na abertura, qualquer que seja a ação pedida.
+# Campos: fotos em 24, tamanho dos eventos em 40 e início do índice em 48;
+# o índice tem 16 bytes por foto, com a ação da foto nos 8 primeiros.
+lerCampo() {
+    od -An -tu8 -j "$2" -N 8 "$1" | tr -d ' '
+}
+cp "$DIR/curto.arq" "$DIR/alterado"
+escreverLE "$DIR/alterado" 120 "$(somaPalavras "$DIR/alterado" 999 120)" 8
+verificacoes=$((verificacoes + 1))
+cmp -s "$DIR/curto.arq" "$DIR/alterado" || falhar "somaPalavras não reproduz a soma do cabeçalho"
+fotos=$(lerCampo "$DIR/curto.arq" 24)
+indice=$(lerCampo "$DIR/curto.arq" 48)
+for caso in "40 -8 eventos" "48 $((-16 * fotos)) índice" "$((indice + 32)) 100 índice-fora-de-ordem" \
+            "$((indice + 16 * fotos - 16)) 61 índice-além-do-fim" "$indice 1 índice-sem-a-ação-0"; do
+    set -- $caso
+    cp "$DIR/curto.arq" "$DIR/alterado"
+    escreverLE "$DIR/alterado" "$1" "$2" 8
+    escreverLE "$DIR/alterado" 120 "$(somaPalavras "$DIR/alterado" 999 120)" 8
+    recusa "arquivo com $3 forjado" $MESTRE --buscar "$DIR/alterado" 7
+done
+
+# ---------------------------------------------------------------------------
+# Estado salvo: salvar no meio e continuar depois de restaurar dá o mesmo
+# estado e o mesmo hash que jogar tudo de uma vez
+# ---------------------------------------------------------------------------
+
+for caso in "31 aleatorio 5 3 10x20 3" "32 sacola7 17 40 6x8 11" "33 sacola4 1 1 - 1"; do
+    set -- $caso
+    gerarComandos 600 "$1" > "$DIR/comandos"
+    head -n 250 "$DIR/comandos" > "$DIR/antes"
+    tail -n +251 "$DIR/comandos" > "$DIR/depois"
+    opcoes="--semente $1 --gerador $2 --fila $3 --pilha $4 --troca $6"
+    [ "$5" != "-" ] && opcoes="$opcoes --tabuleiro $5"
+
+    direto=$($MESTRE $opcoes --lote "$DIR/comandos" 2>/dev/null)
+    salvo=$($MESTRE $opcoes --lote "$DIR/antes" --salvar "$DIR/partida.sv" 2>/dev/null)
+    restaurado=$($MESTRE --restaurar "$DIR/partida.sv" --lote /dev/null 2>/dev/null)
+    continuado=$($MESTRE --restaurar "$DIR/partida.sv" --lote "$DIR/depois" 2>/dev/null)
+    for chave in fila_tamanho pilha_tamanho proximo_id resumo_tabuleiro hash resumo; do
+        confere "restaurado ($caso): $chave" "$(campo "$restaurado" $chave)" "$(campo "$salvo" $chave)"
+        confere "continuado ($caso): $chave" "$(campo "$continuado" $chave)" "$(campo "$direto" $chave)"
+    done
+done
+
+# Tabela de sessões: o fluxo traz pares "sessão ação"
+awk 'BEGIN { srand(41); for (i = 0; i < 2000; i++) print int(rand() * 8), 1 + int(rand() * 5) }' > "$DIR/comandos"
+head -n 900 "$DIR/comandos" > "$DIR/antes"
+tail -n +901 "$DIR/comandos" > "$DIR/depois"
+opcoes="--semente 41 --sessoes 8 --pilha 5 --troca 4 --tabuleiro 10x20"
+direto=$($MESTRE $opcoes --lote "$DIR/comandos" 2>/dev/null)
+salvo=$($MESTRE $opcoes --lote "$DIR/antes" --salvar "$DIR/tabela.sv" 2>/dev/null)
+restaurado=$($MESTRE --sessoes 8 --restaurar "$DIR/tabela.sv" --lote /dev/null 2>/dev/null)
+continuado=$($MESTRE --sessoes 8 --restaurar "$DIR/tabela.sv" --lote "$DIR/depois" 2>/dev/null)
+confere "tabela restaurada: resumo" "$(campo "$restaurado" resumo)" "$(campo "$salvo" resumo)"
+confere "tabela continuada: resumo" "$(campo "$continuado" resumo)" "$(campo "$direto" resumo)"
+
+gerarComandos 100 34 > "$DIR/comandos"
+$MESTRE --semente 34 --tabuleiro 10x20 --lote "$DIR/comandos" --salvar "$DIR/curto.sv" >/dev/null 2>&1
+recusaAlterados "$DIR/curto.sv" "$MESTRE" --restaurar X --lote /dev/null
+# Campos forjados com a soma refeita: só a validação dos campos pode recusar
+# o arquivo. A sessão começa na posição 64: frente, trás e tamanho da fila
+# estão em 72, 76 e 80, e o hash e a potência da fila em 88 e 96. Com o
+# hash da fila zerado, uma fila de tamanho <= 0 confere com o hash recalculado.
+$MESTRE --semente 36 --lote /dev/null --salvar "$DIR/negativo.sv" >/dev/null 2>&1
+cp "$DIR/negativo.sv" "$DIR/alterado"
+escreverLE "$DIR/alterado" 48 "$(somaPalavras "$DIR/alterado" 48)" 8
+verificacoes=$((verificacoes + 1))
+cmp -s "$DIR/negativo.sv" "$DIR/alterado" || falhar "somaPalavras não reproduz a soma gravada"
+for caso in "0 7 -1" "-1 7 0" "3 0 -3"; do
+    set -- $caso
+    cp "$DIR/negativo.sv" "$DIR/alterado"
+    escreverLE "$DIR/alterado" 72 "$1" 4
+    escreverLE "$DIR/alterado" 76 "$2" 4
+    escreverLE "$DIR/alterado" 80 "$3" 4
+    escreverLE "$DIR/alterado" 88 0 8
+    escreverLE "$DIR/alterado" 48 "$(somaPalavras "$DIR/alterado" 48)" 8
+    recusa "estado com frente=$1 trás=$2 tamanho=$3" $MESTRE --restaurar "$DIR/alterado" --lote /dev/null
+done
+cp "$DIR/negativo.sv" "$DIR/alterado"
+escreverLE "$DIR/alterado" 96 12345 8
+escreverLE "$DIR/alterado" 48 "$(somaPalavras "$DIR/alterado" 48)" 8
+recusa "estado com a potência da fila errada" $MESTRE --restaurar "$DIR/alterado" --lote /dev/null
+
+printf '0 1\n1 2\n2 1\n' > "$DIR/comandos"
+$MESTRE --semente 35 --sessoes 3 --lote "$DIR/comandos" --salvar "$DIR/curto.sv" >/dev/null 2>&1
+recusaAlterados "$DIR/curto.sv" "$MESTRE" --sessoes 3 --restaurar X --lote /dev/null
+
+echo "teste_arquivos: $verificacoes verificações, $falhas falhas"
+[ "$falhas" -eq 0 ]
@@ -0,0 +1,81 @@
+#!/bin/sh
+# Testes do bot do tetris_mestre: decisões em tabuleiros da largura mínima à
+# máxima (32 colunas, onde há mais jogadas por peça), com uma e várias
+# threads, e com a troca múltipla de mais peças que o padrão. Sem orçamento
+# (--orcamento 0), toda decisão precisa chegar à profundidade pedida. Em
+# tabuleiros montados com --linhas, o bot precisa achar a única colocação
+# que elimina linhas. Para pegar escritas fora dos arrays, rode sob o
+# AddressSanitizer:
+#   make clean test CFLAGS="-O1 -g -fsanitize=address -pthread"
+# Uso: testes/teste_bot.sh [caminho do tetris_mestre]
+
+MESTRE=${1:-./tetris_mestre}
+falhas=0
+verificacoes=0
+
+falhar() {
+    echo "FALHA: $*" >&2
+    falhas=$((falhas + 1))
+}
+
+# Valor de 'chave=' na saída (primeira ocorrência)
+campo() {
+    printf '%s\n' "$1" | tr ' ' '\n' | sed -n "s/^$2=//p" | head -n 1
+}
+
+# bot "descrição" decisões profundidade opções... : roda o bot e confere as
+# decisões tomadas e a profundidade média; a saída fica em $saida
+bot() {
+    descricao=$1
+    decisoes=$2
+    profundidade=$3
+    shift 3
+    verificacoes=$((verificacoes + 1))
+    if ! saida=$($MESTRE "$@" --bot "$decisoes" --profundidade "$profundidade" --orcamento 0 2>&1); then
+        falhar "bot $descricao terminou com erro"
+    elif [ "$(campo "$saida" decisoes)" != "$decisoes" ]; then
+        falhar "bot $descricao não tomou $decisoes decisões"
+    elif [ "$(campo "$saida" profundidade_media)" != "$profundidade.00" ]; then
+        falhar "bot $descricao: profundidade_media=$(campo "$saida" profundidade_media), pedida $profundidade"
+    fi
+}
+
+for caso in "4x20 20 1 2" "10x20 20 1 2" "10x20 5 2 3" "31x20 10 1 2" "32x20 20 1 2" "32x20 10 4 2" "32x64 10 2 2"; do
+    set -- $caso
+    bot "em $1 com $3 thread(s)" "$2" "$4" --semente 5 --tabuleiro "$1" --threads "$3"
+done
+bot "com --troca 16" 20 2 --semente 6 --fila 16 --pilha 16 --troca 16 --threads 2
+
+# Primeira semente em que a frente da fila é a peça 'tipo' (o estado inicial
+# sai no primeiro quadro do modo interativo)
+sementeComFrente() {
+    s=1
+    while [ "$s" -le 200 ]; do
+        if $MESTRE --semente "$s" </dev/null | grep -q "^Fila de peças: \[$1 "; then
+            echo "$s"
+            return
+        fi
+        s=$((s + 1))
+    done
+}
+
+# Tabuleiros de 4 colunas com um buraco que só a peça da frente, numa única
+# colocação, preenche: I em pé na coluna 0 (4 linhas) e O nas colunas 0-1
+# (2 linhas). Com profundidade 1, o bot precisa jogá-la ali.
+for caso in "I 14,14,14,14 4" "O 12,12 2"; do
+    set -- $caso
+    semente=$(sementeComFrente "$1")
+    if [ -z "$semente" ]; then
+        verificacoes=$((verificacoes + 1))
+        falhar "nenhuma semente começa com a peça $1"
+        continue
+    fi
+    bot "com $1 na frente e linhas $2" 1 1 --semente "$semente" --tabuleiro 4x8 --linhas "$2"
+    verificacoes=$((verificacoes + 1))
+    if [ "$(campo "$saida" linhas_eliminadas)" != "$3" ]; then
+        falhar "bot com $1 na frente e linhas $2 eliminou $(campo "$saida" linhas_eliminadas) linhas, esperadas $3"
+    fi
+done
+
+echo "teste_bot: $verificacoes verificações, $falhas falhas"
+[ "$falhas" -eq 0 ]
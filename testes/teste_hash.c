@@ -0,0 +1,143 @@
+// Teste do hash incremental: sequências aleatórias de ações (incluindo
+// desfazer, refazer e a troca de k peças) em todos os modos do gerador e em
+// vários tamanhos de fila e de pilha. Depois de cada passo, hashEstado
+// (atualizado em O(1)) deve ser igual a recalcularHashEstado (percorre tudo).
+#include <stdio.h>
+#include <stdlib.h>
+#include "tetris_nucleo.h"
+#include "tetris_jogo.h"
+
+#define PASSOS_POR_CASO 20000
+#define SESSOES_TABELA 4
+
+static const int TAMANHOS_FILA[] = {1, 2, 3, 5, 8, 17};
+static const int CAPACIDADES_PILHA[] = {1, 3, 4, 40};
+static const ModoGerador MODOS[] = {GERADOR_ALEATORIO, GERADOR_SACOLA_4, GERADOR_SACOLA_7};
+
+#define QUANTIDADE(v) ((int)(sizeof(v) / sizeof((v)[0])))
+
+static int falhas = 0;
+
+/**
+ * Confere o hash incremental contra o recalculado e relata a primeira
+ * divergência de cada caso
+ * @return int - 1 se os hashes são iguais
+ */
+static int conferirHash(const FilaPecas *fila, const PilhaReserva *pilha,
+                        const char *caso, long passo, int acao) {
+    uint64_t incremental = hashEstado(fila, pilha);
+    uint64_t recalculado = recalcularHashEstado(fila, pilha);
+    if (incremental == recalculado) {
+        return 1;
+    }
+    fprintf(stderr, "FALHA %s: passo %ld, ação %d: hash=%016llx recalculado=%016llx\n",
+            caso, passo, acao, (unsigned long long)incremental, (unsigned long long)recalculado);
+    falhas++;
+    return 0;
+}
+
+/**
+ * Uma partida isolada: ações 1 a 5, troca de k peças, desfazer e refazer
+ */
+static void testarPartida(ModoGerador modo, int limiteFila, int capacidadePilha,
+                          int comTabuleiro, uint64_t semente) {
+    char caso[96];
+    snprintf(caso, sizeof(caso), "partida modo=%d fila=%d pilha=%d tabuleiro=%d",
+             (int)modo, limiteFila, capacidadePilha, comTabuleiro);
+
+    GeradorPecas gerador, sorteio;
+    FilaPecas fila;
+    PilhaReserva pilha;
+    Arena arena;
+    Tabuleiro tabuleiro;
+    Historico historico;
+    Tabuleiro *ativo = comTabuleiro ? &tabuleiro : NULL;
+
+    inicializarGerador(&gerador, semente, modo);
+    inicializarGerador(&sorteio, semente ^ 0xA5A5A5A5ULL, GERADOR_ALEATORIO);
+    inicializarArena(&arena);
+    if (!inicializarPilhaNaArena(&pilha, &arena, capacidadePilha) ||
+        !inicializarFila(&fila, limiteFila, &gerador) ||
+        !criarHistorico(&historico, 64) ||
+        (comTabuleiro && !inicializarTabuleiro(&tabuleiro, 10, 20))) {
+        fprintf(stderr, "FALHA %s: memória insuficiente\n", caso);
+        exit(1);
+    }
+
+    conferirHash(&fila, &pilha, caso, 0, 0);
+    for (long passo = 1; passo <= PASSOS_POR_CASO; passo++) {
+        int acao = (int)aleatorioLimitado(&sorteio, 8);
+        if (acao >= 1 && acao <= 5) {
+            aplicarAcaoComHistorico(&historico, &fila, &pilha, ativo, acao);
+        } else if (acao == 6) {
+            int k = 1 + (int)aleatorioLimitado(&sorteio, (uint32_t)(limiteFila + 1));
+            operacaoTrocarPecas(&fila, &pilha, k);
+            esvaziarHistorico(&historico);
+        } else if (aleatorioLimitado(&sorteio, 2) == 0) {
+            desfazerAcao(&historico, &fila, &pilha, ativo);
+        } else {
+            refazerAcao(&historico, &fila, &pilha, ativo);
+        }
+        if (!conferirHash(&fila, &pilha, caso, passo, acao)) {
+            break;
+        }
+    }
+
+    liberarHistorico(&historico);
+    liberarFila(&fila);
+    liberarArena(&arena);
+}
+
+/**
+ * Uma tabela de sessões: as ações vão para sessões sorteadas e o hash de
+ * cada sessão é conferido depois de carregada nas estruturas de uma partida
+ */
+static void testarTabela(ModoGerador modo, int limiteFila, int capacidadePilha, uint64_t semente) {
+    char caso[96];
+    snprintf(caso, sizeof(caso), "tabela modo=%d fila=%d pilha=%d",
+             (int)modo, limiteFila, capacidadePilha);
+
+    // A ação 5 das sessões troca a pilha inteira (k = capacidade)
+    ConfiguracaoJogo config = {limiteFila, capacidadePilha, modo, semente, 10, 20, capacidadePilha};
+    TabelaSessoes tabela;
+    GeradorPecas sorteio;
+    if (!criarTabelaSessoes(&tabela, SESSOES_TABELA, &config)) {
+        fprintf(stderr, "FALHA %s: memória insuficiente\n", caso);
+        exit(1);
+    }
+    inicializarGerador(&sorteio, ~semente, GERADOR_ALEATORIO);
+
+    for (long passo = 1; passo <= PASSOS_POR_CASO; passo++) {
+        int sessao = (int)aleatorioLimitado(&sorteio, SESSOES_TABELA);
+        int acao = 1 + (int)aleatorioLimitado(&sorteio, 5);
+        aplicarAcaoSessao(&tabela, sessao, acao);
+
+        FilaPecas fila;
+        PilhaReserva pilha;
+        carregarSessao(&tabela, sessao, &fila, &pilha);
+        if (!conferirHash(&fila, &pilha, caso, passo, acao)) {
+            break;
+        }
+    }
+
+    liberarTabelaSessoes(&tabela);
+}
+
+int main(void) {
+    uint64_t semente = 1;
+    int casos = 0;
+
+    for (int m = 0; m < QUANTIDADE(MODOS); m++) {
+        for (int f = 0; f < QUANTIDADE(TAMANHOS_FILA); f++) {
+            for (int p = 0; p < QUANTIDADE(CAPACIDADES_PILHA); p++) {
+                testarPartida(MODOS[m], TAMANHOS_FILA[f], CAPACIDADES_PILHA[p], 0, semente++);
+                testarPartida(MODOS[m], TAMANHOS_FILA[f], CAPACIDADES_PILHA[p], 1, semente++);
+                testarTabela(MODOS[m], TAMANHOS_FILA[f], CAPACIDADES_PILHA[p], semente++);
+                casos += 3;
+            }
+        }
+    }
+
+    printf("teste_hash: %d casos, %d passos cada, %d falhas\n", casos, PASSOS_POR_CASO, falhas);
+    return falhas == 0 ? 0 : 1;
+}
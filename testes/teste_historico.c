@@ -0,0 +1,235 @@
+// Teste do histórico: antes de cada ação o estado inteiro da partida (fila,
+// pilha, gerador, tabuleiro e hashes) é fotografado. Desfazer deve devolver
+// exatamente a foto de antes da ação, e refazer exatamente a de depois.
+// O anel tem só 8 entradas, para que o descarte das mais antigas também
+// seja exercitado.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tetris_nucleo.h"
+#include "tetris_jogo.h"
+
+#define PASSOS_POR_CASO 20000
+#define CAPACIDADE_TESTE 8
+#define FILA_MAXIMA_TESTE 32
+#define PILHA_MAXIMA_TESTE 64
+
+static const int TAMANHOS_FILA[] = {1, 3, 5, 17};
+static const int CAPACIDADES_PILHA[] = {1, 3, 40};
+static const ModoGerador MODOS[] = {GERADOR_ALEATORIO, GERADOR_SACOLA_4, GERADOR_SACOLA_7};
+
+#define QUANTIDADE(v) ((int)(sizeof(v) / sizeof((v)[0])))
+
+// Estado completo de uma partida. A struct (e a Peca, sem PECA_COMPACTA) tem
+// bytes de preenchimento, então as fotos são comparadas campo a campo
+typedef struct {
+    Peca fila[FILA_MAXIMA_TESTE];
+    int frente, tras, tamanho;
+    IdPeca proximoId;
+    uint64_t hashFila, potenciaFila;
+    Peca pilha[PILHA_MAXIMA_TESTE];
+    int topo;
+    uint64_t hashPilha, potenciaPilha;
+    uint64_t estadoGerador[4];
+    uint8_t tiposPendentes[TAMANHO_BUFFER_TIPOS];
+    uint32_t leitura, escrita;
+    uint32_t linhas[ALTURA_MAXIMA_TABULEIRO + LINHAS_EXTRAS_TABULEIRO];
+    int alturaOcupada;
+    long long pecasColocadas, linhasEliminadas, finsDeJogo;
+} FotoPartida;
+
+static int falhas = 0;
+
+/**
+ * Copia o estado da partida para 'foto'. Da fila e do gerador entram só as
+ * posições em uso, porque as outras guardam restos sem significado; as
+ * demais ficam zeradas.
+ */
+static void fotografar(FotoPartida *foto, const FilaPecas *fila, const PilhaReserva *pilha,
+                       const Tabuleiro *tabuleiro) {
+    const GeradorPecas *gerador = fila->gerador;
+    memset(foto, 0, sizeof(*foto));
+
+    for (int i = 0; i < fila->tamanho; i++) {
+        foto->fila[i] = fila->pecas[(fila->frente + i) & fila->mascara];
+    }
+    foto->frente = fila->frente;
+    foto->tras = fila->tras;
+    foto->tamanho = fila->tamanho;
+    foto->proximoId = fila->proximoId;
+    foto->hashFila = fila->hash;
+    foto->potenciaFila = fila->potencia;
+
+    for (int i = 0; i <= pilha->topo; i++) {
+        foto->pilha[i] = pilha->pecas[i];
+    }
+    foto->topo = pilha->topo;
+    foto->hashPilha = pilha->hash;
+    foto->potenciaPilha = pilha->potencia;
+
+    memcpy(foto->estadoGerador, gerador->estado, sizeof(foto->estadoGerador));
+    for (uint32_t i = gerador->leitura; i != gerador->escrita; i++) {
+        foto->tiposPendentes[i - gerador->leitura] = gerador->tipos[i & (TAMANHO_BUFFER_TIPOS - 1)];
+    }
+    foto->leitura = gerador->leitura;
+    foto->escrita = gerador->escrita;
+
+    memcpy(foto->linhas, tabuleiro->linhas, sizeof(foto->linhas));
+    foto->alturaOcupada = tabuleiro->alturaOcupada;
+    foto->pecasColocadas = tabuleiro->pecasColocadas;
+    foto->linhasEliminadas = tabuleiro->linhasEliminadas;
+    foto->finsDeJogo = tabuleiro->finsDeJogo;
+}
+
+/**
+ * Compara dois arrays de peças pelo tipo e pelo id, sem olhar o preenchimento
+ * @return int - 1 se forem iguais
+ */
+static int pecasIguais(const Peca *a, const Peca *b, int quantidade) {
+    for (int i = 0; i < quantidade; i++) {
+        if (nomePeca(a[i]) != nomePeca(b[i]) || idPeca(a[i]) != idPeca(b[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Compara duas fotos campo a campo (os arrays de inteiros não têm
+ * preenchimento e podem ir por memcmp)
+ * @return int - 1 se forem iguais
+ */
+static int fotosIguais(const FotoPartida *a, const FotoPartida *b) {
+    return pecasIguais(a->fila, b->fila, FILA_MAXIMA_TESTE) &&
+           a->frente == b->frente && a->tras == b->tras && a->tamanho == b->tamanho &&
+           a->proximoId == b->proximoId &&
+           a->hashFila == b->hashFila && a->potenciaFila == b->potenciaFila &&
+           pecasIguais(a->pilha, b->pilha, PILHA_MAXIMA_TESTE) &&
+           a->topo == b->topo && a->hashPilha == b->hashPilha && a->potenciaPilha == b->potenciaPilha &&
+           memcmp(a->estadoGerador, b->estadoGerador, sizeof(a->estadoGerador)) == 0 &&
+           memcmp(a->tiposPendentes, b->tiposPendentes, sizeof(a->tiposPendentes)) == 0 &&
+           a->leitura == b->leitura && a->escrita == b->escrita &&
+           memcmp(a->linhas, b->linhas, sizeof(a->linhas)) == 0 &&
+           a->alturaOcupada == b->alturaOcupada &&
+           a->pecasColocadas == b->pecasColocadas && a->linhasEliminadas == b->linhasEliminadas &&
+           a->finsDeJogo == b->finsDeJogo;
+}
+
+/**
+ * Compara o estado atual com uma foto e relata a divergência
+ * @return int - 1 se forem idênticos
+ */
+static int conferirFoto(const FotoPartida *esperada, const FilaPecas *fila, const PilhaReserva *pilha,
+                        const Tabuleiro *tabuleiro, const char *caso, long passo, const char *operacao) {
+    FotoPartida atual;
+    fotografar(&atual, fila, pilha, tabuleiro);
+    if (fotosIguais(&atual, esperada)) {
+        return 1;
+    }
+    fprintf(stderr, "FALHA %s: passo %ld: %s não reproduziu o estado esperado\n", caso, passo, operacao);
+    falhas++;
+    return 0;
+}
+
+/**
+ * Passeio aleatório de ações, desfazer e refazer. As fotos ficam em anéis
+ * indexados pelo mesmo contador das entradas do histórico.
+ */
+static void testarHistorico(ModoGerador modo, int limiteFila, int capacidadePilha, uint64_t semente) {
+    char caso[96];
+    snprintf(caso, sizeof(caso), "modo=%d fila=%d pilha=%d", (int)modo, limiteFila, capacidadePilha);
+
+    GeradorPecas gerador, sorteio;
+    FilaPecas fila;
+    PilhaReserva pilha;
+    Arena arena;
+    Tabuleiro tabuleiro;
+    Historico historico;
+    FotoPartida antes[CAPACIDADE_TESTE], depois[CAPACIDADE_TESTE];
+    long desfeitas = 0, refeitas = 0;
+
+    inicializarGerador(&gerador, semente, modo);
+    inicializarGerador(&sorteio, semente * 31 + 7, GERADOR_ALEATORIO);
+    inicializarArena(&arena);
+    // Tabuleiro estreito e baixo: linhas completas e fins de jogo frequentes
+    if (!inicializarPilhaNaArena(&pilha, &arena, capacidadePilha) ||
+        !inicializarFila(&fila, limiteFila, &gerador) ||
+        !criarHistorico(&historico, CAPACIDADE_TESTE) ||
+        !inicializarTabuleiro(&tabuleiro, 6, 8)) {
+        fprintf(stderr, "FALHA %s: memória insuficiente\n", caso);
+        exit(1);
+    }
+
+    for (long passo = 1; passo <= PASSOS_POR_CASO; passo++) {
+        uint32_t sorteado = aleatorioLimitado(&sorteio, 20);
+
+        if (sorteado < 12) {
+            FotoPartida foto;
+            uint32_t indice = historico.atual;
+            fotografar(&foto, &fila, &pilha, &tabuleiro);
+            aplicarAcaoComHistorico(&historico, &fila, &pilha, &tabuleiro,
+                                    1 + (int)aleatorioLimitado(&sorteio, 5));
+            if (historico.atual == indice + 1) {
+                memcpy(&antes[indice % CAPACIDADE_TESTE], &foto, sizeof(foto));
+                fotografar(&depois[indice % CAPACIDADE_TESTE], &fila, &pilha, &tabuleiro);
+            }
+        } else if (sorteado < 17) {
+            uint32_t indice = historico.atual - 1;
+            if (desfazerAcao(&historico, &fila, &pilha, &tabuleiro) != 0) {
+                desfeitas++;
+                if (!conferirFoto(&antes[indice % CAPACIDADE_TESTE], &fila, &pilha, &tabuleiro,
+                                  caso, passo, "desfazer")) {
+                    break;
+                }
+            }
+        } else {
+            uint32_t indice = historico.atual;
+            if (refazerAcao(&historico, &fila, &pilha, &tabuleiro) != 0) {
+                refeitas++;
+                if (!conferirFoto(&depois[indice % CAPACIDADE_TESTE], &fila, &pilha, &tabuleiro,
+                                  caso, passo, "refazer")) {
+                    break;
+                }
+            }
+        }
+    }
+
+    // Desfaz tudo o que o anel ainda guarda e refaz até o fim
+    uint32_t fim = historico.atual;
+    while (historico.atual != historico.inicio) {
+        uint32_t indice = historico.atual - 1;
+        desfazerAcao(&historico, &fila, &pilha, &tabuleiro);
+        conferirFoto(&antes[indice % CAPACIDADE_TESTE], &fila, &pilha, &tabuleiro, caso, -1, "desfazer tudo");
+    }
+    while (historico.atual != fim) {
+        uint32_t indice = historico.atual;
+        refazerAcao(&historico, &fila, &pilha, &tabuleiro);
+        conferirFoto(&depois[indice % CAPACIDADE_TESTE], &fila, &pilha, &tabuleiro, caso, -1, "refazer tudo");
+    }
+
+    if (desfeitas == 0 || refeitas == 0) {
+        fprintf(stderr, "FALHA %s: o passeio não desfez ou não refez nada\n", caso);
+        falhas++;
+    }
+
+    liberarHistorico(&historico);
+    liberarFila(&fila);
+    liberarArena(&arena);
+}
+
+int main(void) {
+    uint64_t semente = 1;
+    int casos = 0;
+
+    for (int m = 0; m < QUANTIDADE(MODOS); m++) {
+        for (int f = 0; f < QUANTIDADE(TAMANHOS_FILA); f++) {
+            for (int p = 0; p < QUANTIDADE(CAPACIDADES_PILHA); p++) {
+                testarHistorico(MODOS[m], TAMANHOS_FILA[f], CAPACIDADES_PILHA[p], semente++);
+                casos++;
+            }
+        }
+    }
+
+    printf("teste_historico: %d casos, %d passos cada, %d falhas\n", casos, PASSOS_POR_CASO, falhas);
+    return falhas == 0 ? 0 : 1;
+}
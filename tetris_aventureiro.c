@@ -1,139 +1,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include "tetris_nucleo.h"
 
 #define TAMANHO_FILA 5
 #define TAMANHO_PILHA 3
 
-// Estrutura que representa uma peça do Tetris
-typedef struct {
-    char nome;  // Tipo da peça: 'I', 'O', 'T', 'L'
-    int id;     // Identificador único da peça
-} Peca;
-
-// Estrutura que representa a fila circular de peças
-typedef struct {
-    Peca pecas[TAMANHO_FILA];  // Array de peças
-    int frente;                 // Índice da frente da fila
-    int tras;                   // Índice do final da fila
-    int tamanho;                // Quantidade atual de peças na fila
-    int proximoId;              // Próximo ID a ser atribuído
-} FilaPecas;
-
-// Estrutura que representa a pilha de peças reservadas
-typedef struct {
-    Peca pecas[TAMANHO_PILHA];  // Array de peças reservadas
-    int topo;                    // Índice do topo da pilha (-1 = vazia)
-} PilhaReserva;
-
-/**
- * Gera uma peça aleatória com um ID único
- * @param id - Identificador único para a peça
- * @return Peca - Nova peça gerada
- */
-Peca gerarPeca(int id) {
-    Peca novaPeca;
-    char tipos[] = {'I', 'O', 'T', 'L'};
-    
-    // Seleciona um tipo aleatório
-    novaPeca.nome = tipos[rand() % 4];
-    novaPeca.id = id;
-    
-    return novaPeca;
-}
-
-/**
- * Inicializa a fila de peças com elementos iniciais
- * @param fila - Ponteiro para a estrutura da fila
- */
-void inicializarFila(FilaPecas *fila) {
-    fila->frente = 0;
-    fila->tras = 0;
-    fila->tamanho = 0;
-    fila->proximoId = 0;
-    
-    // Preenche a fila com peças iniciais
-    for (int i = 0; i < TAMANHO_FILA; i++) {
-        fila->pecas[i] = gerarPeca(fila->proximoId);
-        fila->proximoId++;
-        fila->tamanho++;
-        fila->tras = (fila->tras + 1) % TAMANHO_FILA;
-    }
-}
-
-/**
- * Inicializa a pilha de reserva vazia
- * @param pilha - Ponteiro para a estrutura da pilha
- */
-void inicializarPilha(PilhaReserva *pilha) {
-    pilha->topo = -1;  // Pilha começa vazia
-}
-
-/**
- * Verifica se a fila está vazia
- * @param fila - Ponteiro para a estrutura da fila
- * @return int - 1 se vazia, 0 caso contrário
- */
-int filaVazia(FilaPecas *fila) {
-    return fila->tamanho == 0;
-}
-
-/**
- * Verifica se a fila está cheia
- * @param fila - Ponteiro para a estrutura da fila
- * @return int - 1 se cheia, 0 caso contrário
- */
-int filaCheia(FilaPecas *fila) {
-    return fila->tamanho == TAMANHO_FILA;
-}
-
-/**
- * Verifica se a pilha está vazia
- * @param pilha - Ponteiro para a estrutura da pilha
- * @return int - 1 se vazia, 0 caso contrário
- */
-int pilhaVazia(PilhaReserva *pilha) {
-    return pilha->topo == -1;
-}
-
-/**
- * Verifica se a pilha está cheia
- * @param pilha - Ponteiro para a estrutura da pilha
- * @return int - 1 se cheia, 0 caso contrário
- */
-int pilhaCheia(PilhaReserva *pilha) {
-    return pilha->topo == TAMANHO_PILHA - 1;
-}
-
-/**
- * Adiciona uma nova peça gerada ao final da fila
- * @param fila - Ponteiro para a estrutura da fila
- */
-void adicionarPecaNaFila(FilaPecas *fila) {
-    if (filaCheia(fila)) {
-        return;  // Não adiciona se já está cheia
-    }
-    
-    // Gera e insere nova peça no final
-    Peca novaPeca = gerarPeca(fila->proximoId);
-    fila->pecas[fila->tras] = novaPeca;
-    fila->tras = (fila->tras + 1) % TAMANHO_FILA;
-    fila->tamanho++;
-    fila->proximoId++;
-}
-
-/**
- * Remove e retorna a peça da frente da fila
- * @param fila - Ponteiro para a estrutura da fila
- * @return Peca - Peça removida
- */
-Peca removerDaFila(FilaPecas *fila) {
-    Peca pecaRemovida = fila->pecas[fila->frente];
-    fila->frente = (fila->frente + 1) % TAMANHO_FILA;
-    fila->tamanho--;
-    return pecaRemovida;
-}
-
 /**
  * Joga uma peça (remove da fila e adiciona nova)
  * @param fila - Ponteiro para a estrutura da fila
@@ -146,13 +18,11 @@ void jogarPeca(FilaPecas *fila) {
     
     // Remove a peça da frente
     Peca pecaJogada = removerDaFila(fila);
-    printf("\n✓ Peça [%c %d] jogada com sucesso!\n", pecaJogada.nome, pecaJogada.id);
+    printf("\n✓ Peça " FORMATO_PECA " jogada com sucesso!\n", ARGS_PECA(pecaJogada));
     
     // Adiciona uma nova peça no final da fila
     adicionarPecaNaFila(fila);
-    printf("✓ Nova peça [%c %d] adicionada à fila.\n", 
-           fila->pecas[(fila->tras - 1 + TAMANHO_FILA) % TAMANHO_FILA].nome,
-           fila->pecas[(fila->tras - 1 + TAMANHO_FILA) % TAMANHO_FILA].id);
+    printf("✓ Nova peça " FORMATO_PECA " adicionada à fila.\n", ARGS_PECA(ultimaPecaDaFila(fila)));
 }
 
 /**
@@ -173,17 +43,14 @@ void reservarPeca(FilaPecas *fila, PilhaReserva *pilha) {
     
     // Remove da fila e adiciona na pilha
     Peca pecaReservada = removerDaFila(fila);
-    pilha->topo++;
-    pilha->pecas[pilha->topo] = pecaReservada;
+    empilharPeca(pilha, pecaReservada);
     
-    printf("\n✓ Peça [%c %d] movida para a pilha de reserva!\n", 
-           pecaReservada.nome, pecaReservada.id);
+    printf("\n✓ Peça " FORMATO_PECA " movida para a pilha de reserva!\n", 
+           ARGS_PECA(pecaReservada));
     
     // Adiciona uma nova peça no final da fila
     adicionarPecaNaFila(fila);
-    printf("✓ Nova peça [%c %d] adicionada à fila.\n", 
-           fila->pecas[(fila->tras - 1 + TAMANHO_FILA) % TAMANHO_FILA].nome,
-           fila->pecas[(fila->tras - 1 + TAMANHO_FILA) % TAMANHO_FILA].id);
+    printf("✓ Nova peça " FORMATO_PECA " adicionada à fila.\n", ARGS_PECA(ultimaPecaDaFila(fila)));
 }
 
 /**
@@ -197,11 +64,10 @@ void usarPecaReservada(PilhaReserva *pilha) {
     }
     
     // Remove do topo da pilha
-    Peca pecaUsada = pilha->pecas[pilha->topo];
-    pilha->topo--;
+    Peca pecaUsada = desempilharPeca(pilha);
     
-    printf("\n✓ Peça reservada [%c %d] usada com sucesso!\n", 
-           pecaUsada.nome, pecaUsada.id);
+    printf("\n✓ Peça reservada " FORMATO_PECA " usada com sucesso!\n", 
+           ARGS_PECA(pecaUsada));
 }
 
 /**
@@ -221,8 +87,8 @@ void exibirEstado(FilaPecas *fila, PilhaReserva *pilha) {
     } else {
         int indice = fila->frente;
         for (int i = 0; i < fila->tamanho; i++) {
-            printf("[%c %d] ", fila->pecas[indice].nome, fila->pecas[indice].id);
-            indice = (indice + 1) % TAMANHO_FILA;
+            printf(FORMATO_PECA " ", ARGS_PECA(fila->pecas[indice]));
+            indice = (indice + 1) & fila->mascara;
         }
     }
     printf("\n");
@@ -233,7 +99,7 @@ void exibirEstado(FilaPecas *fila, PilhaReserva *pilha) {
         printf("[VAZIA]");
     } else {
         for (int i = pilha->topo; i >= 0; i--) {
-            printf("[%c %d] ", pilha->pecas[i].nome, pilha->pecas[i].id);
+            printf(FORMATO_PECA " ", ARGS_PECA(pilha->pecas[i]));
         }
     }
     printf("\n========================================\n");
@@ -257,17 +123,23 @@ void exibirMenu() {
 /**
  * Função principal do programa
  */
-int main() {
+int main(int argc, char *argv[]) {
+    GeradorPecas gerador;
     FilaPecas fila;
     PilhaReserva pilha;
+    Peca reservas[TAMANHO_PILHA];
     int opcao;
     
-    // Inicializa gerador de números aleatórios
-    srand(time(NULL));
+    // Semente do gerador: argumento opcional, ou o relógio se omitida
+    uint64_t semente = (argc >= 2) ? strtoull(argv[1], NULL, 10) : (uint64_t)time(NULL);
     
     // Inicializa a fila com peças e a pilha vazia
-    inicializarFila(&fila);
-    inicializarPilha(&pilha);
+    inicializarGerador(&gerador, semente, GERADOR_ALEATORIO);
+    if (!inicializarFila(&fila, TAMANHO_FILA, &gerador)) {
+        fprintf(stderr, "❌ Erro: memória insuficiente para a fila.\n");
+        return 1;
+    }
+    inicializarPilha(&pilha, reservas, TAMANHO_PILHA);
     
     printf("╔════════════════════════════════════════╗\n");
     printf("║   BEM-VINDO AO TETRIS STACK!          ║\n");
@@ -314,5 +186,6 @@ int main() {
         
     } while(opcao != 0);
     
+    liberarFila(&fila);
     return 0;
 }
\ No newline at end of file
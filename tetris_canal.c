@@ -0,0 +1,87 @@
+// Canal de peças com thread produtora. Único objeto da biblioteca que usa
+// threads; ver tetris_canal.h.
+#include <time.h>
+#include <sched.h>
+#include "tetris_canal.h"
+
+/**
+ * Espera do canal: cede o processador nas primeiras tentativas e depois
+ * dorme um pouco, para que um produtor com o anel cheio (jogo parado
+ * esperando o jogador) não ocupe um núcleo inteiro
+ * @param tentativas - Quantas vezes seguidas o canal já esperou
+ */
+void aguardarCanal(int tentativas) {
+    if (tentativas < 64) {
+        sched_yield();
+    } else {
+        struct timespec pausa = {0, 200000};  // 200 us
+        nanosleep(&pausa, NULL);
+    }
+}
+
+/**
+ * Laço da thread produtora: sorteia tipos em lotes e publica cada lote com
+ * uma única escrita atômica (release)
+ */
+static void *executarProdutor(void *argumento) {
+    CanalPecas *canal = argumento;
+    uint32_t escrita = atomic_load_explicit(&canal->escrita, memory_order_relaxed);
+    int tentativas = 0;
+    
+    while (!atomic_load_explicit(&canal->encerrar, memory_order_relaxed)) {
+        uint32_t leitura = atomic_load_explicit(&canal->leitura, memory_order_acquire);
+        uint32_t livres = TAMANHO_CANAL_PECAS - (escrita - leitura);
+        
+        if (livres == 0) {
+            aguardarCanal(tentativas++);
+            continue;
+        }
+        tentativas = 0;
+        
+        if (livres > LOTE_PRODUTOR) {
+            livres = LOTE_PRODUTOR;
+        }
+        for (uint32_t i = 0; i < livres; i++) {
+            canal->tipos[(escrita + i) & (TAMANHO_CANAL_PECAS - 1)] = (uint8_t)sortearTipo(&canal->gerador);
+        }
+        escrita += livres;
+        atomic_store_explicit(&canal->escrita, escrita, memory_order_release);
+    }
+    return NULL;
+}
+
+/**
+ * Cria o canal e inicia a thread produtora. Daí em diante 'consumidor'
+ * passa a receber os tipos pelo canal. O produtor usa a mesma semente e o
+ * mesmo modo do consumidor, então a sequência de peças não muda.
+ * @param canal - Canal a inicializar (deve viver até encerrarCanalPecas)
+ * @param consumidor - Gerador da thread do jogo, já inicializado
+ * @return int - 1 em caso de sucesso, 0 se a thread não pôde ser criada
+ */
+int iniciarCanalPecas(CanalPecas *canal, GeradorPecas *consumidor) {
+    canal->gerador = *consumidor;
+    canal->gerador.receberTipo = NULL;
+    canal->gerador.fonte = NULL;
+    atomic_init(&canal->escrita, 0);
+    atomic_init(&canal->leitura, 0);
+    atomic_init(&canal->encerrar, 0);
+    canal->leituraLocal = 0;
+    canal->escritaConhecida = 0;
+    
+    if (pthread_create(&canal->thread, NULL, executarProdutor, canal) != 0) {
+        return 0;
+    }
+    consumidor->receberTipo = receberTipo;
+    consumidor->fonte = canal;
+    return 1;
+}
+
+/**
+ * Para a thread produtora e desliga o canal do gerador consumidor
+ */
+void encerrarCanalPecas(CanalPecas *canal, GeradorPecas *consumidor) {
+    atomic_store_explicit(&canal->encerrar, 1, memory_order_relaxed);
+    pthread_join(canal->thread, NULL);
+    consumidor->receberTipo = NULL;
+    consumidor->fonte = NULL;
+}
@@ -0,0 +1,59 @@
+#ifndef TETRIS_CANAL_H
+#define TETRIS_CANAL_H
+
+// ---------------------------------------------------------------------------
+// Canal de peças com thread produtora (opção --produtor do tetris_mestre)
+// ---------------------------------------------------------------------------
+// Fica fora do núcleo para que tetris_nucleo.o e tetris_jogo.o não dependam
+// de threads: só quem liga o canal precisa de tetris_canal.o e -pthread.
+// O gerador recebe os tipos pelo gancho receberTipo/fonte de GeradorPecas.
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "tetris_nucleo.h"
+
+#define TAMANHO_CANAL_PECAS 4096   // Tipos que o produtor pode adiantar (potência de 2)
+#define LOTE_PRODUTOR 64           // Tipos publicados de cada vez pelo produtor
+
+// Canal sem travas de um produtor e um consumidor (SPSC): uma thread sorteia
+// os tipos das peças com antecedência e a thread do jogo só os retira.
+// Os índices são contadores livres; a posição no anel é contador & máscara.
+// Cada lado fica em uma linha de cache própria para não disputar a mesma linha.
+typedef struct CanalPecas {
+    _Alignas(64) atomic_uint escrita;   // Tipos publicados pelo produtor
+    _Alignas(64) atomic_uint leitura;   // Tipos consumidos pelo jogo
+    uint32_t leituraLocal;              // Cópia de 'leitura' mantida só pelo consumidor
+    uint32_t escritaConhecida;          // Último valor de 'escrita' visto pelo consumidor
+    _Alignas(64) uint8_t tipos[TAMANHO_CANAL_PECAS];
+    GeradorPecas gerador;               // Gerador usado apenas pela thread produtora
+    atomic_int encerrar;                // Pedido de parada para o produtor
+    pthread_t thread;
+} CanalPecas;
+
+// Canal com thread produtora
+void aguardarCanal(int tentativas);
+int iniciarCanalPecas(CanalPecas *canal, GeradorPecas *consumidor);
+void encerrarCanalPecas(CanalPecas *canal, GeradorPecas *consumidor);
+
+/**
+ * Retira um tipo publicado pelo produtor (lado consumidor, sem travas).
+ * Só espera se o produtor ainda não adiantou nenhuma peça.
+ */
+static inline int receberTipo(void *fonte) {
+    CanalPecas *canal = fonte;
+    if (canal->leituraLocal == canal->escritaConhecida) {
+        int tentativas = 0;
+        while ((canal->escritaConhecida = atomic_load_explicit(&canal->escrita, memory_order_acquire))
+               == canal->leituraLocal) {
+            aguardarCanal(tentativas++);
+        }
+    }
+    
+    int tipo = canal->tipos[canal->leituraLocal & (TAMANHO_CANAL_PECAS - 1)];
+    canal->leituraLocal++;
+    atomic_store_explicit(&canal->leitura, canal->leituraLocal, memory_order_release);
+    return tipo;
+}
+
+#endif
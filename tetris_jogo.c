@@ -0,0 +1,1064 @@
+// Regras do nível Mestre: tabuleiro, ações, histórico e tabela de sessões.
+// Sem E/S; ver tetris_jogo.h.
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "tetris_jogo.h"
+
+// ---------------------------------------------------------------------------
+// Tabuleiro com linhas em máscaras de bits
+// ---------------------------------------------------------------------------
+
+#define NUM_KICKS 5  // Deslocamentos tentados a cada rotação (o primeiro é (0, 0))
+
+// Tabelas de formas, rotações e kicks: todas constantes, montadas a partir
+// das orientações do sistema de rotação padrão (SRS). Rotação 0 é a de
+// entrada, 1 = horário, 2 = 180°, 3 = anti-horário. Indexadas por tipoPeca().
+
+// Forma de cada tipo em cada rotação: 4 linhas de baixo para cima, bit c =
+// coluna (borda esquerda da peça + c). Já no formato usado no tabuleiro.
+static const uint8_t FORMAS_PECA[7][NUM_ROTACOES][4] = {
+    {  // I
+        {0x0F, 0x00, 0x00, 0x00},
+        {0x01, 0x01, 0x01, 0x01},
+        {0x0F, 0x00, 0x00, 0x00},
+        {0x01, 0x01, 0x01, 0x01}
+    },
+    {  // O
+        {0x03, 0x03, 0x00, 0x00},
+        {0x03, 0x03, 0x00, 0x00},
+        {0x03, 0x03, 0x00, 0x00},
+        {0x03, 0x03, 0x00, 0x00}
+    },
+    {  // T
+        {0x07, 0x02, 0x00, 0x00},
+        {0x01, 0x03, 0x01, 0x00},
+        {0x02, 0x07, 0x00, 0x00},
+        {0x02, 0x03, 0x02, 0x00}
+    },
+    {  // L
+        {0x07, 0x04, 0x00, 0x00},
+        {0x03, 0x01, 0x01, 0x00},
+        {0x01, 0x07, 0x00, 0x00},
+        {0x02, 0x02, 0x03, 0x00}
+    },
+    {  // J
+        {0x07, 0x01, 0x00, 0x00},
+        {0x01, 0x01, 0x03, 0x00},
+        {0x04, 0x07, 0x00, 0x00},
+        {0x03, 0x02, 0x02, 0x00}
+    },
+    {  // S
+        {0x03, 0x06, 0x00, 0x00},
+        {0x02, 0x03, 0x01, 0x00},
+        {0x03, 0x06, 0x00, 0x00},
+        {0x02, 0x03, 0x01, 0x00}
+    },
+    {  // Z
+        {0x06, 0x03, 0x00, 0x00},
+        {0x01, 0x03, 0x02, 0x00},
+        {0x06, 0x03, 0x00, 0x00},
+        {0x01, 0x03, 0x02, 0x00}
+    }
+};
+
+const uint8_t LARGURA_FORMA[7][NUM_ROTACOES] = {
+    {4, 1, 4, 1}, {2, 2, 2, 2}, {3, 2, 3, 2}, {3, 2, 3, 2}, {3, 2, 3, 2}, {3, 2, 3, 2}, {3, 2, 3, 2}
+};
+static const uint8_t ALTURA_FORMA[7][NUM_ROTACOES] = {
+    {1, 4, 1, 4}, {2, 2, 2, 2}, {2, 3, 2, 3}, {2, 3, 2, 3}, {2, 3, 2, 3}, {2, 3, 2, 3}, {2, 3, 2, 3}
+};
+
+// Rotações com formas diferentes (I, S e Z repetem a partir da 2; O não muda)
+const uint8_t ROTACOES_DISTINTAS[7] = {2, 1, 4, 4, 4, 2, 2};
+
+// Posição {x, y} da forma dentro da caixa de rotação do SRS (4x4 para I,
+// 2x2 para O, 3x3 para as demais), medida a partir do canto inferior esquerdo
+static const int8_t DESLOCAMENTO_CAIXA[7][NUM_ROTACOES][2] = {
+    {{0, 2}, {2, 0}, {0, 1}, {1, 0}},
+    {{0, 0}, {0, 0}, {0, 0}, {0, 0}},
+    {{0, 1}, {1, 0}, {0, 0}, {0, 0}},
+    {{0, 1}, {1, 0}, {0, 0}, {0, 0}},
+    {{0, 1}, {1, 0}, {0, 0}, {0, 0}},
+    {{0, 1}, {1, 0}, {0, 0}, {0, 0}},
+    {{0, 1}, {1, 0}, {0, 0}, {0, 0}}
+};
+
+// Famílias de kicks: J, L, S, T e Z usam a mesma tabela; I tem a sua; O não desloca
+enum { KICKS_JLSTZ = 0, KICKS_I, KICKS_O };
+static const uint8_t FAMILIA_KICKS[7] = {KICKS_I, KICKS_O, KICKS_JLSTZ, KICKS_JLSTZ,
+                                         KICKS_JLSTZ, KICKS_JLSTZ, KICKS_JLSTZ};
+
+// Deslocamentos {x, y} (y para cima) tentados em ordem ao girar a partir de
+// cada rotação: [família][rotação de origem][0 = horário, 1 = anti-horário]
+static const int8_t KICKS[3][NUM_ROTACOES][2][NUM_KICKS][2] = {
+    {  // J, L, S, T, Z
+        {{{0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2}}, {{0, 0}, {1, 0}, {1, 1}, {0, -2}, {1, -2}}},
+        {{{0, 0}, {1, 0}, {1, -1}, {0, 2}, {1, 2}},     {{0, 0}, {1, 0}, {1, -1}, {0, 2}, {1, 2}}},
+        {{{0, 0}, {1, 0}, {1, 1}, {0, -2}, {1, -2}},    {{0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2}}},
+        {{{0, 0}, {-1, 0}, {-1, -1}, {0, 2}, {-1, 2}},  {{0, 0}, {-1, 0}, {-1, -1}, {0, 2}, {-1, 2}}}
+    },
+    {  // I
+        {{{0, 0}, {-2, 0}, {1, 0}, {-2, -1}, {1, 2}},   {{0, 0}, {-1, 0}, {2, 0}, {-1, 2}, {2, -1}}},
+        {{{0, 0}, {-1, 0}, {2, 0}, {-1, 2}, {2, -1}},   {{0, 0}, {2, 0}, {-1, 0}, {2, 1}, {-1, -2}}},
+        {{{0, 0}, {2, 0}, {-1, 0}, {2, 1}, {-1, -2}},   {{0, 0}, {1, 0}, {-2, 0}, {1, -2}, {-2, 1}}},
+        {{{0, 0}, {1, 0}, {-2, 0}, {1, -2}, {-2, 1}},   {{0, 0}, {-2, 0}, {1, 0}, {-2, -1}, {1, 2}}}
+    },
+    {  // O
+        {{{0, 0}}, {{0, 0}}}, {{{0, 0}}, {{0, 0}}}, {{{0, 0}}, {{0, 0}}}, {{{0, 0}}, {{0, 0}}}
+    }
+};
+
+/**
+ * Inicializa um tabuleiro vazio
+ * @param largura - Colunas (4 a LARGURA_MAXIMA_TABULEIRO)
+ * @param altura - Linhas (4 a ALTURA_MAXIMA_TABULEIRO)
+ * @return int - 1 em caso de sucesso, 0 se as dimensões forem inválidas
+ */
+int inicializarTabuleiro(Tabuleiro *tabuleiro, int largura, int altura) {
+    if (largura < 4 || largura > LARGURA_MAXIMA_TABULEIRO ||
+        altura < 4 || altura > ALTURA_MAXIMA_TABULEIRO) {
+        return 0;
+    }
+    
+    memset(tabuleiro, 0, sizeof(*tabuleiro));
+    tabuleiro->largura = largura;
+    tabuleiro->altura = altura;
+    tabuleiro->linhaCheia = (largura == 32) ? 0xFFFFFFFFu : ((1u << largura) - 1);
+    return 1;
+}
+
+/**
+ * Esvazia as linhas do tabuleiro (mantém os contadores)
+ */
+void limparTabuleiro(Tabuleiro *tabuleiro) {
+    memset(tabuleiro->linhas, 0, sizeof(tabuleiro->linhas));
+    tabuleiro->alturaOcupada = 0;
+}
+
+/**
+ * Testa se a forma, com a borda esquerda na coluna x e a base na linha y,
+ * sobrepõe algum bloco do tabuleiro (4 ANDs, um por linha da forma)
+ */
+static inline int formaColide(const Tabuleiro *tabuleiro, const uint8_t forma[4], int x, int y) {
+    const uint32_t *linhas = tabuleiro->linhas + y;
+    return ((linhas[0] & ((uint32_t)forma[0] << x)) |
+            (linhas[1] & ((uint32_t)forma[1] << x)) |
+            (linhas[2] & ((uint32_t)forma[2] << x)) |
+            (linhas[3] & ((uint32_t)forma[3] << x))) != 0;
+}
+
+/**
+ * Testa se a peça cabe na posição (dentro do tabuleiro e sem sobreposição)
+ * @param x - Coluna da borda esquerda da peça
+ * @param y - Linha da base da peça
+ */
+int posicaoLivre(const Tabuleiro *tabuleiro, int tipo, int rotacao, int x, int y) {
+    if (x < 0 || x + LARGURA_FORMA[tipo][rotacao] > tabuleiro->largura ||
+        y < 0 || y + 4 > ALTURA_MAXIMA_TABULEIRO + LINHAS_EXTRAS_TABULEIRO) {
+        return 0;
+    }
+    return !formaColide(tabuleiro, FORMAS_PECA[tipo][rotacao], x, y);
+}
+
+/**
+ * Gira a peça 90° com os kicks do SRS: tenta cada deslocamento da tabela e
+ * fica com o primeiro que cabe
+ * @param rotacao - Rotação atual; recebe a nova
+ * @param x - Coluna da borda esquerda; recebe a nova
+ * @param y - Linha da base; recebe a nova
+ * @param antiHorario - 0 gira no sentido horário, 1 no anti-horário
+ * @return int - 1 se girou, 0 se nenhum kick coube (nada muda)
+ */
+int girarPeca(const Tabuleiro *tabuleiro, int tipo, int *rotacao, int *x, int *y, int antiHorario) {
+    int origem = *rotacao;
+    int destino = (origem + (antiHorario ? 3 : 1)) & 3;
+    const int8_t (*kicks)[2] = KICKS[FAMILIA_KICKS[tipo]][origem][antiHorario];
+    int numKicks = FAMILIA_KICKS[tipo] == KICKS_O ? 1 : NUM_KICKS;
+    
+    // Canto da caixa de rotação, que fica parado durante o giro
+    int caixaX = *x - DESLOCAMENTO_CAIXA[tipo][origem][0];
+    int caixaY = *y - DESLOCAMENTO_CAIXA[tipo][origem][1];
+    
+    for (int k = 0; k < numKicks; k++) {
+        int novoX = caixaX + kicks[k][0] + DESLOCAMENTO_CAIXA[tipo][destino][0];
+        int novoY = caixaY + kicks[k][1] + DESLOCAMENTO_CAIXA[tipo][destino][1];
+        if (posicaoLivre(tabuleiro, tipo, destino, novoX, novoY)) {
+            *rotacao = destino;
+            *x = novoX;
+            *y = novoY;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Linha em que a peça para ao cair na coluna x (queda direta)
+ * @return int - Linha da base da peça, ou -1 se a coluna não comporta a peça
+ */
+int linhaDeQueda(const Tabuleiro *tabuleiro, int tipo, int rotacao, int x) {
+    if (x < 0 || x + LARGURA_FORMA[tipo][rotacao] > tabuleiro->largura) {
+        return -1;
+    }
+    
+    // Acima de alturaOcupada não há blocos: a busca começa ali
+    const uint8_t *forma = FORMAS_PECA[tipo][rotacao];
+    int y = tabuleiro->alturaOcupada;
+    while (y > 0 && !formaColide(tabuleiro, forma, x, y - 1)) {
+        y--;
+    }
+    return y;
+}
+
+/**
+ * Máscara (4 bits) das linhas completas entre y e y + 3. Com SSE2 as quatro
+ * linhas são comparadas com a linha cheia em uma única instrução.
+ */
+static inline int linhasCompletasEm(const Tabuleiro *tabuleiro, int y) {
+#ifdef __SSE2__
+    __m128i linhas = _mm_loadu_si128((const __m128i *)(tabuleiro->linhas + y));
+    __m128i cheias = _mm_cmpeq_epi32(linhas, _mm_set1_epi32((int)tabuleiro->linhaCheia));
+    return _mm_movemask_ps(_mm_castsi128_ps(cheias));
+#else
+    int mascara = 0;
+    for (int r = 0; r < 4; r++) {
+        if (tabuleiro->linhas[y + r] == tabuleiro->linhaCheia) {
+            mascara |= 1 << r;
+        }
+    }
+    return mascara;
+#endif
+}
+
+/**
+ * Remove as linhas completas entre y e y + 3 (as únicas que a última peça
+ * pode ter completado) e desce as de cima com um memmove por linha removida
+ * @param mascara - Linhas completas, como retornado por linhasCompletasEm
+ * @return int - Quantidade de linhas removidas
+ */
+static int eliminarLinhasCompletas(Tabuleiro *tabuleiro, int y, int mascara) {
+    int eliminadas = 0;
+    
+    // De cima para baixo, para que os índices abaixo não mudem
+    for (int r = 3; r >= 0; r--) {
+        if (mascara & (1 << r)) {
+            int linha = y + r;
+            memmove(&tabuleiro->linhas[linha], &tabuleiro->linhas[linha + 1],
+                    (size_t)(tabuleiro->alturaOcupada - linha - 1) * sizeof(uint32_t));
+            tabuleiro->alturaOcupada--;
+            tabuleiro->linhas[tabuleiro->alturaOcupada] = 0;
+            eliminadas++;
+        }
+    }
+    return eliminadas;
+}
+
+/**
+ * Deixa a peça cair na coluna x e a fixa no tabuleiro, removendo as linhas
+ * completas. Se a peça passar do topo, o jogo termina e o tabuleiro é
+ * esvaziado para a partida continuar.
+ * @param tipo - Índice do tipo da peça em TIPOS_PECA
+ * @param rotacao - Rotação da peça (0 a 3)
+ * @param x - Coluna da borda esquerda da peça
+ * @param colocacao - Recebe o resultado (pode ser NULL)
+ * @return int - 1 se a peça foi colocada, 0 se a coluna for inválida
+ */
+int colocarPeca(Tabuleiro *tabuleiro, int tipo, int rotacao, int x, Colocacao *colocacao) {
+    int y = linhaDeQueda(tabuleiro, tipo, rotacao, x);
+    if (y < 0) {
+        return 0;
+    }
+    
+    const uint8_t *forma = FORMAS_PECA[tipo][rotacao];
+    for (int r = 0; r < 4; r++) {
+        tabuleiro->linhas[y + r] |= (uint32_t)forma[r] << x;
+    }
+    
+    int topo = y + ALTURA_FORMA[tipo][rotacao];
+    if (topo > tabuleiro->alturaOcupada) {
+        tabuleiro->alturaOcupada = topo;
+    }
+    
+    int mascara = linhasCompletasEm(tabuleiro, y);
+    int eliminadas = eliminarLinhasCompletas(tabuleiro, y, mascara);
+    int fimDeJogo = tabuleiro->alturaOcupada > tabuleiro->altura;
+    
+    tabuleiro->pecasColocadas++;
+    tabuleiro->linhasEliminadas += eliminadas;
+    if (fimDeJogo) {
+        tabuleiro->finsDeJogo++;
+        limparTabuleiro(tabuleiro);
+    }
+    
+    if (colocacao) {
+        colocacao->rotacao = rotacao;
+        colocacao->coluna = x;
+        colocacao->linha = y;
+        colocacao->linhasEliminadas = eliminadas;
+        colocacao->mascaraEliminadas = mascara;
+        colocacao->fimDeJogo = fimDeJogo;
+    }
+    return 1;
+}
+
+/**
+ * Desfaz uma colocação que não terminou o jogo: devolve as linhas
+ * eliminadas (que estavam cheias) e apaga os blocos da peça
+ * @param tipo - Tipo da peça colocada
+ * @param colocacao - Resultado de colocarPeca para essa peça
+ * @param alturaAnterior - alturaOcupada antes da colocação
+ */
+void desfazerColocacao(Tabuleiro *tabuleiro, int tipo, const Colocacao *colocacao, int alturaAnterior) {
+    int y = colocacao->linha;
+    
+    // De baixo para cima, na ordem inversa da remoção
+    for (int r = 0; r < 4; r++) {
+        if (colocacao->mascaraEliminadas & (1 << r)) {
+            int linha = y + r;
+            memmove(&tabuleiro->linhas[linha + 1], &tabuleiro->linhas[linha],
+                    (size_t)(tabuleiro->alturaOcupada - linha) * sizeof(uint32_t));
+            tabuleiro->linhas[linha] = tabuleiro->linhaCheia;
+            tabuleiro->alturaOcupada++;
+        }
+    }
+    
+    const uint8_t *forma = FORMAS_PECA[tipo][colocacao->rotacao];
+    for (int r = 0; r < 4; r++) {
+        tabuleiro->linhas[y + r] &= ~((uint32_t)forma[r] << colocacao->coluna);
+    }
+    
+    tabuleiro->alturaOcupada = alturaAnterior;
+    tabuleiro->pecasColocadas--;
+    tabuleiro->linhasEliminadas -= colocacao->linhasEliminadas;
+}
+
+/**
+ * Escolha padrão para a ação "jogar": entre todas as rotações distintas e
+ * colunas, a que deixa o topo da peça mais baixo (em caso de empate, a
+ * primeira rotação e a coluna mais à esquerda)
+ * @param rotacao - Recebe a rotação escolhida
+ * @return int - Coluna escolhida
+ */
+int escolherColocacaoPadrao(const Tabuleiro *tabuleiro, int tipo, int *rotacao) {
+    int melhorColuna = 0;
+    int melhorTopo = 1 << 30;
+    
+    *rotacao = 0;
+    for (int r = 0; r < ROTACOES_DISTINTAS[tipo]; r++) {
+        for (int x = 0; x + LARGURA_FORMA[tipo][r] <= tabuleiro->largura; x++) {
+            int topo = linhaDeQueda(tabuleiro, tipo, r, x) + ALTURA_FORMA[tipo][r];
+            if (topo < melhorTopo) {
+                melhorTopo = topo;
+                melhorColuna = x;
+                *rotacao = r;
+            }
+        }
+    }
+    return melhorColuna;
+}
+
+/**
+ * Resumo (FNV-1a) das linhas visíveis do tabuleiro
+ */
+uint64_t calcularResumoTabuleiro(const Tabuleiro *tabuleiro) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (int y = 0; y < tabuleiro->altura; y++) {
+        hash = (hash ^ tabuleiro->linhas[y]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * Ação 1 sem impressão: remove a peça da frente, coloca-a no tabuleiro (se
+ * houver) na coluna padrão e repõe uma nova peça no final da fila
+ * @param tabuleiro - Tabuleiro da partida (NULL = a peça só sai da fila)
+ * @param jogada - Recebe a peça jogada (pode ser NULL)
+ * @param nova - Recebe a peça gerada para a fila (pode ser NULL)
+ * @param colocacao - Recebe onde a peça caiu (pode ser NULL)
+ * @return ResultadoOperacao - OP_SUCESSO ou o motivo da falha
+ */
+ResultadoOperacao operacaoJogar(FilaPecas *fila, Tabuleiro *tabuleiro,
+                                Peca *jogada, Peca *nova, Colocacao *colocacao) {
+    if (filaVazia(fila)) {
+        return OP_FILA_VAZIA;
+    }
+    
+    Peca pecaJogada = removerDaFila(fila);
+    if (tabuleiro != NULL) {
+        int tipo = tipoPeca(pecaJogada);
+        int rotacao;
+        int coluna = escolherColocacaoPadrao(tabuleiro, tipo, &rotacao);
+        colocarPeca(tabuleiro, tipo, rotacao, coluna, colocacao);
+    }
+    adicionarPecaNaFila(fila);
+    
+    if (jogada) *jogada = pecaJogada;
+    if (nova) *nova = ultimaPecaDaFila(fila);
+    return OP_SUCESSO;
+}
+
+/**
+ * Ação 2 sem impressão: move a peça da frente da fila para a pilha
+ * @param reservada - Recebe a peça reservada (pode ser NULL)
+ * @param nova - Recebe a peça gerada para a fila (pode ser NULL)
+ */
+ResultadoOperacao operacaoEnviarParaPilha(FilaPecas *fila, PilhaReserva *pilha,
+                                          Peca *reservada, Peca *nova) {
+    if (filaVazia(fila)) {
+        return OP_FILA_VAZIA;
+    }
+    
+    // Uma pilha na arena pode precisar crescer antes do push
+    if (pilhaCheia(pilha) || !reservarNaPilha(pilha, pilha->topo + 2)) {
+        return OP_PILHA_CHEIA;
+    }
+    
+    Peca pecaReservada = removerDaFila(fila);
+    empilharPeca(pilha, pecaReservada);
+    adicionarPecaNaFila(fila);
+    
+    if (reservada) *reservada = pecaReservada;
+    if (nova) *nova = ultimaPecaDaFila(fila);
+    return OP_SUCESSO;
+}
+
+/**
+ * Ação 3 sem impressão: remove a peça do topo da pilha e a coloca no
+ * tabuleiro (se houver) na colocação padrão
+ * @param tabuleiro - Tabuleiro da partida (NULL = a peça só sai da pilha)
+ * @param usada - Recebe a peça usada (pode ser NULL)
+ * @param colocacao - Recebe onde a peça caiu (pode ser NULL)
+ */
+ResultadoOperacao operacaoUsarDaPilha(PilhaReserva *pilha, Tabuleiro *tabuleiro,
+                                      Peca *usada, Colocacao *colocacao) {
+    if (pilhaVazia(pilha)) {
+        return OP_PILHA_VAZIA;
+    }
+    
+    Peca pecaUsada = desempilharPeca(pilha);
+    if (tabuleiro != NULL) {
+        int tipo = tipoPeca(pecaUsada);
+        int rotacao;
+        int coluna = escolherColocacaoPadrao(tabuleiro, tipo, &rotacao);
+        colocarPeca(tabuleiro, tipo, rotacao, coluna, colocacao);
+    }
+    
+    if (usada) *usada = pecaUsada;
+    return OP_SUCESSO;
+}
+
+/**
+ * Ação 4 sem impressão: troca a frente da fila com o topo da pilha
+ */
+ResultadoOperacao operacaoTrocarAtual(FilaPecas *fila, PilhaReserva *pilha) {
+    if (filaVazia(fila)) {
+        return OP_FILA_VAZIA;
+    }
+    
+    if (pilhaVazia(pilha)) {
+        return OP_PILHA_VAZIA;
+    }
+    
+    Peca pecaFila = fila->pecas[fila->frente];
+    Peca pecaPilha = pilha->pecas[pilha->topo];
+    fila->pecas[fila->frente] = pecaPilha;
+    pilha->pecas[pilha->topo] = pecaFila;
+    
+    // Frente da fila tem peso 1; o topo da pilha, potencia / BASE
+    uint64_t diferenca = chavePeca(pecaPilha) - chavePeca(pecaFila);
+    fila->hash += diferenca;
+    pilha->hash -= diferenca * (pilha->potencia * INVERSO_BASE_PILHA);
+    return OP_SUCESSO;
+}
+
+/**
+ * Eleva 'base' a 'expoente' (módulo 2^64), por quadrados sucessivos
+ */
+static inline uint64_t potenciaModular(uint64_t base, uint64_t expoente) {
+    uint64_t resultado = 1;
+    while (expoente) {
+        if (expoente & 1) {
+            resultado *= base;
+        }
+        base *= base;
+        expoente >>= 1;
+    }
+    return resultado;
+}
+
+/**
+ * Troca dois trechos contíguos, elemento a elemento, e acumula a variação
+ * dos hashes: a posição i do trecho da fila tem peso *pesoFila * BASE^i
+ */
+static inline void trocarTrecho(Peca *restrict fila, Peca *restrict pilha, int n,
+                                uint64_t *pesoFila, uint64_t *pesoPilha,
+                                uint64_t *variacaoFila, uint64_t *variacaoPilha) {
+    uint64_t pf = *pesoFila, pp = *pesoPilha;
+    uint64_t vf = 0, vp = 0;
+    
+    for (int i = 0; i < n; i++) {
+        Peca daFila = fila[i];
+        Peca daPilha = pilha[i];
+        fila[i] = daPilha;
+        pilha[i] = daFila;
+        
+        uint64_t diferenca = chavePeca(daPilha) - chavePeca(daFila);
+        vf += diferenca * pf;
+        vp += diferenca * pp;
+        pf *= BASE_HASH_FILA;
+        pp *= BASE_HASH_PILHA;
+    }
+    
+    *pesoFila = pf;
+    *pesoPilha = pp;
+    *variacaoFila += vf;
+    *variacaoPilha += vp;
+}
+
+/**
+ * Troca as k primeiras peças da fila com as k do topo da pilha, no lugar:
+ * a posição i da fila troca com a posição topo - k + 1 + i da pilha, então
+ * trocar de novo desfaz a troca. A faixa da fila dá a volta no anel no
+ * máximo uma vez, e a troca é feita em no máximo dois trechos contíguos.
+ * @param k - Peças trocadas (1 até o tamanho da fila e da pilha)
+ * @return ResultadoOperacao - OP_SUCESSO ou o motivo da falha
+ */
+ResultadoOperacao operacaoTrocarPecas(FilaPecas *fila, PilhaReserva *pilha, int k) {
+    if (k < 1) {
+        return OP_OPCAO_INVALIDA;
+    }
+    if (fila->tamanho < k) {
+        return OP_FILA_INSUFICIENTE;
+    }
+    if (pilha->topo + 1 < k) {
+        return OP_PILHA_INSUFICIENTE;
+    }
+    
+    Peca *trechoPilha = pilha->pecas + (pilha->topo + 1 - k);
+    int primeiro = fila->mascara + 1 - fila->frente;  // Posições até o fim do anel
+    if (primeiro > k) {
+        primeiro = k;
+    }
+    
+    // O trecho da pilha começa na posição topo + 1 - k: peso potencia / BASE^k
+    uint64_t pesoFila = 1;
+    uint64_t pesoPilha = pilha->potencia * potenciaModular(INVERSO_BASE_PILHA, (uint64_t)k);
+    uint64_t variacaoFila = 0, variacaoPilha = 0;
+    
+    trocarTrecho(fila->pecas + fila->frente, trechoPilha, primeiro,
+                 &pesoFila, &pesoPilha, &variacaoFila, &variacaoPilha);
+    trocarTrecho(fila->pecas, trechoPilha + primeiro, k - primeiro,
+                 &pesoFila, &pesoPilha, &variacaoFila, &variacaoPilha);
+    
+    fila->hash += variacaoFila;
+    pilha->hash -= variacaoPilha;
+    return OP_SUCESSO;
+}
+
+/**
+ * Peças trocadas pela ação 5 nesta pilha
+ * @return int - pilha->pecasTroca, ou PECAS_TROCA_MULTIPLA se não foi definido
+ */
+int pecasTrocaMultipla(const PilhaReserva *pilha) {
+    return pilha->pecasTroca > 0 ? pilha->pecasTroca : PECAS_TROCA_MULTIPLA;
+}
+
+/**
+ * Ação 5 sem impressão: troca as k primeiras peças da fila com as k da
+ * pilha, com k = pecasTrocaMultipla(pilha)
+ */
+ResultadoOperacao operacaoTrocarMultipla(FilaPecas *fila, PilhaReserva *pilha) {
+    return operacaoTrocarPecas(fila, pilha, pecasTrocaMultipla(pilha));
+}
+
+/**
+ * Aplica uma ação do menu (1 a 5) sem nenhuma impressão
+ * @param tabuleiro - Tabuleiro da partida (pode ser NULL)
+ * @param opcao - Código da ação, igual ao do menu
+ * @return ResultadoOperacao - OP_SUCESSO ou o motivo da falha
+ */
+ResultadoOperacao aplicarAcao(FilaPecas *fila, PilhaReserva *pilha, Tabuleiro *tabuleiro,
+                              int opcao) {
+    switch (opcao) {
+        case 1: return operacaoJogar(fila, tabuleiro, NULL, NULL, NULL);
+        case 2: return operacaoEnviarParaPilha(fila, pilha, NULL, NULL);
+        case 3: return operacaoUsarDaPilha(pilha, tabuleiro, NULL, NULL);
+        case 4: return operacaoTrocarAtual(fila, pilha);
+        case 5: return operacaoTrocarMultipla(fila, pilha);
+        default: return OP_OPCAO_INVALIDA;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Histórico para desfazer e refazer (formato e regras em tetris_jogo.h)
+// ---------------------------------------------------------------------------
+
+/**
+ * Cria um histórico vazio
+ * @param capacidade - Ações guardadas (arredondada para a potência de 2 seguinte)
+ * @return int - 1 em caso de sucesso, 0 se a capacidade for inválida ou faltar memória
+ */
+int criarHistorico(Historico *historico, int capacidade) {
+    if (capacidade < 1 || capacidade > HISTORICO_MAXIMO) {
+        return 0;
+    }
+    
+    // Um reabastecimento escreve pelo menos TAMANHO_BUFFER_TIPOS - 7 tipos,
+    // então há bem menos fotos que entradas
+    int capacidadeEntradas = capacidadeFila(capacidade);
+    int capacidadeFotos = capacidadeFila(capacidadeEntradas / 32 + 2);
+    memset(historico, 0, sizeof(*historico));
+    historico->entradas = malloc((size_t)capacidadeEntradas * sizeof(EntradaHistorico));
+    historico->fotos = malloc((size_t)capacidadeFotos * sizeof(FotoGerador));
+    if (historico->entradas == NULL || historico->fotos == NULL) {
+        free(historico->entradas);
+        free(historico->fotos);
+        return 0;
+    }
+    historico->mascara = (uint32_t)capacidadeEntradas - 1;
+    historico->mascaraFotos = (uint32_t)capacidadeFotos - 1;
+    return 1;
+}
+
+/**
+ * Libera a memória do histórico
+ */
+void liberarHistorico(Historico *historico) {
+    free(historico->entradas);
+    free(historico->fotos);
+    historico->entradas = NULL;
+    historico->fotos = NULL;
+}
+
+/**
+ * Esquece todas as ações (desfazer e refazer)
+ */
+void esvaziarHistorico(Historico *historico) {
+    historico->inicio = historico->atual = historico->fim = 0;
+    historico->inicioFotos = historico->atualFotos = historico->fimFotos = 0;
+}
+
+/**
+ * Descarta a entrada mais antiga (e a foto do gerador dela, se houver)
+ */
+static void descartarMaisAntiga(Historico *historico) {
+    if (historico->entradas[historico->inicio & historico->mascara].reabasteceu) {
+        historico->inicioFotos++;
+    }
+    historico->inicio++;
+}
+
+/**
+ * Captura o que a ação vai mudar e que não pode ser deduzido depois dela
+ */
+void marcarAntesDaAcao(MarcaHistorico *marca, const FilaPecas *fila, const PilhaReserva *pilha,
+                       const Tabuleiro *tabuleiro) {
+    const GeradorPecas *gerador = fila->gerador;
+    memcpy(marca->gerador.estado, gerador->estado, sizeof(gerador->estado));
+    marca->gerador.escrita = gerador->escrita;
+    marca->leitura = gerador->leitura;
+    marca->alturaOcupada = tabuleiro ? tabuleiro->alturaOcupada : 0;
+    if (fila->tamanho > 0) {
+        marca->frente = fila->pecas[fila->frente];
+    }
+    if (pilha->topo >= 0) {
+        marca->topo = pilha->pecas[pilha->topo];
+    }
+}
+
+/**
+ * Guarda o delta inverso de uma ação já aplicada. Ações que falharam não
+ * entram no histórico; uma ação nova descarta o que havia para refazer.
+ * @param marca - Capturada por marcarAntesDaAcao logo antes da ação
+ * @param colocacao - Colocação das ações 1 e 3 quando há tabuleiro, senão NULL
+ */
+void registrarNoHistorico(Historico *historico, const MarcaHistorico *marca, int acao,
+                          ResultadoOperacao resultado, const Colocacao *colocacao) {
+    if (resultado != OP_SUCESSO) {
+        return;
+    }
+    if (colocacao != NULL && colocacao->fimDeJogo) {
+        esvaziarHistorico(historico);
+        return;
+    }
+    
+    historico->fim = historico->atual;
+    historico->fimFotos = historico->atualFotos;
+    
+    EntradaHistorico entrada = {0};
+    entrada.acao = (uint8_t)acao;
+    entrada.peca = acao == 3 ? marca->topo : marca->frente;
+    entrada.reabasteceu = (acao == 1 || acao == 2) && marca->leitura == marca->gerador.escrita;
+    if (colocacao != NULL) {
+        entrada.colocou = 1;
+        entrada.alturaAnterior = (uint8_t)marca->alturaOcupada;
+        entrada.rotacao = (uint8_t)colocacao->rotacao;
+        entrada.coluna = (uint8_t)colocacao->coluna;
+        entrada.linha = (uint8_t)colocacao->linha;
+        entrada.mascaraEliminadas = (uint8_t)colocacao->mascaraEliminadas;
+    }
+    
+    if (entrada.reabasteceu) {
+        while (historico->atualFotos - historico->inicioFotos > historico->mascaraFotos) {
+            descartarMaisAntiga(historico);
+        }
+        historico->fotos[historico->atualFotos++ & historico->mascaraFotos] = marca->gerador;
+        historico->fimFotos = historico->atualFotos;
+    }
+    if (historico->atual - historico->inicio > historico->mascara) {
+        descartarMaisAntiga(historico);
+    }
+    historico->entradas[historico->atual++ & historico->mascara] = entrada;
+    historico->fim = historico->atual;
+}
+
+/**
+ * Aplica uma ação (1 a 5) sem impressão, guardando-a no histórico
+ * @return ResultadoOperacao - OP_SUCESSO ou o motivo da falha
+ */
+ResultadoOperacao aplicarAcaoComHistorico(Historico *historico, FilaPecas *fila, PilhaReserva *pilha,
+                                          Tabuleiro *tabuleiro, int opcao) {
+    MarcaHistorico marca;
+    Colocacao colocacao;
+    ResultadoOperacao resultado;
+    
+    marcarAntesDaAcao(&marca, fila, pilha, tabuleiro);
+    switch (opcao) {
+        case 1: resultado = operacaoJogar(fila, tabuleiro, NULL, NULL, &colocacao); break;
+        case 3: resultado = operacaoUsarDaPilha(pilha, tabuleiro, NULL, &colocacao); break;
+        default: resultado = aplicarAcao(fila, pilha, tabuleiro, opcao); break;
+    }
+    registrarNoHistorico(historico, &marca, opcao, resultado,
+                         tabuleiro != NULL && (opcao == 1 || opcao == 3) ? &colocacao : NULL);
+    return resultado;
+}
+
+/**
+ * Tira do fim da fila a peça gerada pela ação e devolve o tipo e, se a
+ * ação reabasteceu o anel, o estado anterior ao gerador
+ */
+static void devolverPecaNova(Historico *historico, const EntradaHistorico *entrada, FilaPecas *fila) {
+    GeradorPecas *gerador = fila->gerador;
+    Peca nova = removerDoFinalDaFila(fila);
+    
+    if (entrada->reabasteceu) {
+        const FotoGerador *foto = &historico->fotos[--historico->atualFotos & historico->mascaraFotos];
+        memcpy(gerador->estado, foto->estado, sizeof(gerador->estado));
+        gerador->escrita = foto->escrita;
+    }
+    devolverTipo(gerador, tipoPeca(nova));
+    fila->proximoId--;
+}
+
+/**
+ * Desfaz a última ação do histórico
+ * @return int - Código da ação desfeita, ou 0 se não havia o que desfazer
+ */
+int desfazerAcao(Historico *historico, FilaPecas *fila, PilhaReserva *pilha, Tabuleiro *tabuleiro) {
+    if (historico->atual == historico->inicio) {
+        return 0;
+    }
+    
+    const EntradaHistorico *entrada = &historico->entradas[--historico->atual & historico->mascara];
+    Colocacao colocacao = {entrada->rotacao, entrada->coluna, entrada->linha,
+                           __builtin_popcount(entrada->mascaraEliminadas), entrada->mascaraEliminadas, 0};
+    
+    switch (entrada->acao) {
+        case 1:
+            devolverPecaNova(historico, entrada, fila);
+            if (entrada->colocou) {
+                desfazerColocacao(tabuleiro, tipoPeca(entrada->peca), &colocacao, entrada->alturaAnterior);
+            }
+            devolverAFrenteDaFila(fila, entrada->peca);
+            break;
+        case 2:
+            devolverPecaNova(historico, entrada, fila);
+            devolverAFrenteDaFila(fila, desempilharPeca(pilha));
+            break;
+        case 3:
+            if (entrada->colocou) {
+                desfazerColocacao(tabuleiro, tipoPeca(entrada->peca), &colocacao, entrada->alturaAnterior);
+            }
+            empilharPeca(pilha, entrada->peca);
+            break;
+        case 4:
+            operacaoTrocarAtual(fila, pilha);
+            break;
+        case 5:
+            operacaoTrocarMultipla(fila, pilha);
+            break;
+    }
+    return entrada->acao;
+}
+
+/**
+ * Refaz a última ação desfeita
+ * @return int - Código da ação refeita, ou 0 se não havia o que refazer
+ */
+int refazerAcao(Historico *historico, FilaPecas *fila, PilhaReserva *pilha, Tabuleiro *tabuleiro) {
+    if (historico->atual == historico->fim) {
+        return 0;
+    }
+    
+    const EntradaHistorico *entrada = &historico->entradas[historico->atual++ & historico->mascara];
+    if (entrada->reabasteceu) {
+        historico->atualFotos++;
+    }
+    aplicarAcao(fila, pilha, tabuleiro, entrada->acao);
+    return entrada->acao;
+}
+
+// ---------------------------------------------------------------------------
+// Tabela de sessões (estrutura de arrays; ver tetris_jogo.h)
+// ---------------------------------------------------------------------------
+
+#define ALINHAMENTO_TABELA 64  // Cada array começa em uma linha de cache própria
+
+/**
+ * Reserva 'tamanho' bytes alinhados dentro do bloco da tabela
+ */
+static size_t reservarNoBloco(size_t *deslocamento, size_t tamanho) {
+    size_t inicio = (*deslocamento + ALINHAMENTO_TABELA - 1) & ~(size_t)(ALINHAMENTO_TABELA - 1);
+    *deslocamento = inicio + tamanho;
+    return inicio;
+}
+
+/**
+ * Enche a fila da sessão com o gerador dela e esvazia a pilha, na faixa fixa
+ */
+static void iniciarSessao(TabelaSessoes *tabela, int sessao) {
+    FilaPecas fila;
+    inicializarFilaEm(&fila, tabela->pecasFila + (size_t)sessao * tabela->capacidadeFila,
+                      tabela->limiteFila, &tabela->geradores[sessao]);
+    tabela->frente[sessao] = fila.frente;
+    tabela->tras[sessao] = fila.tras;
+    tabela->tamanho[sessao] = fila.tamanho;
+    tabela->proximoId[sessao] = fila.proximoId;
+    tabela->topo[sessao] = -1;
+    tabela->pilhas[sessao] = tabela->pecasPilha + (size_t)sessao * tabela->alocacaoInicialPilha;
+    tabela->alocadasPilha[sessao] = tabela->alocacaoInicialPilha;
+    tabela->hashes[sessao] = (HashSessao){fila.hash, fila.potencia, 0, 1};
+}
+
+/**
+ * Cria a tabela com todas as sessões já inicializadas (fila cheia, pilha
+ * vazia, tabuleiro vazio). A sessão i recebe a semente config->semente + i.
+ * @param tabela - Tabela a preencher
+ * @param quantidade - Número de sessões
+ * @param config - Parâmetros de todas as sessões
+ * @return int - 1 em caso de sucesso, 0 se os parâmetros forem inválidos ou faltar memória
+ */
+int criarTabelaSessoes(TabelaSessoes *tabela, int quantidade, const ConfiguracaoJogo *config) {
+    int limiteFila = config->limiteFila;
+    int capacidadePilha = config->capacidadePilha;
+    int usarTabuleiro = config->larguraTabuleiro > 0;
+    Tabuleiro modelo;
+    
+    if (quantidade < 1 || limiteFila < 1 || limiteFila > TAMANHO_MAXIMO_FILA ||
+        capacidadePilha < 1 || capacidadePilha > CAPACIDADE_MAXIMA_PILHA ||
+        config->pecasTroca < 0 || config->pecasTroca > CAPACIDADE_MAXIMA_PILHA) {
+        return 0;
+    }
+    if (usarTabuleiro && !inicializarTabuleiro(&modelo, config->larguraTabuleiro,
+                                               config->alturaTabuleiro)) {
+        return 0;
+    }
+    
+    size_t n = (size_t)quantidade;
+    int capacidade = capacidadeFila(limiteFila);
+    int alocacaoPilha = capacidadePilha < PILHA_INICIAL_ARENA ? capacidadePilha : PILHA_INICIAL_ARENA;
+    
+    // Calcula o deslocamento de cada array dentro do bloco único
+    size_t total = 0;
+    size_t offFrente = reservarNoBloco(&total, n * sizeof(int));
+    size_t offTras = reservarNoBloco(&total, n * sizeof(int));
+    size_t offTamanho = reservarNoBloco(&total, n * sizeof(int));
+    size_t offTopo = reservarNoBloco(&total, n * sizeof(int));
+    size_t offProximoId = reservarNoBloco(&total, n * sizeof(IdPeca));
+    size_t offGeradores = reservarNoBloco(&total, n * sizeof(GeradorPecas));
+    size_t offFila = reservarNoBloco(&total, n * (size_t)capacidade * sizeof(Peca));
+    size_t offPilha = reservarNoBloco(&total, n * (size_t)alocacaoPilha * sizeof(Peca));
+    size_t offPilhas = reservarNoBloco(&total, n * sizeof(Peca *));
+    size_t offAlocadas = reservarNoBloco(&total, n * sizeof(int));
+    size_t offArenas = reservarNoBloco(&total, n * sizeof(Arena));
+    size_t offHashes = reservarNoBloco(&total, n * sizeof(HashSessao));
+    size_t offTabuleiros = reservarNoBloco(&total, usarTabuleiro ? n * sizeof(Tabuleiro) : 0);
+    
+    char *bloco = aligned_alloc(ALINHAMENTO_TABELA,
+                                (total + ALINHAMENTO_TABELA - 1) & ~(size_t)(ALINHAMENTO_TABELA - 1));
+    if (bloco == NULL) {
+        return 0;
+    }
+    
+    tabela->quantidade = quantidade;
+    tabela->limiteFila = limiteFila;
+    tabela->capacidadeFila = capacidade;
+    tabela->capacidadePilha = capacidadePilha;
+    tabela->alocacaoInicialPilha = alocacaoPilha;
+    tabela->pecasTroca = config->pecasTroca;
+    tabela->bloco = bloco;
+    tabela->frente = (int *)(bloco + offFrente);
+    tabela->tras = (int *)(bloco + offTras);
+    tabela->tamanho = (int *)(bloco + offTamanho);
+    tabela->topo = (int *)(bloco + offTopo);
+    tabela->proximoId = (IdPeca *)(bloco + offProximoId);
+    tabela->geradores = (GeradorPecas *)(bloco + offGeradores);
+    tabela->pecasFila = (Peca *)(bloco + offFila);
+    tabela->pecasPilha = (Peca *)(bloco + offPilha);
+    tabela->pilhas = (Peca **)(bloco + offPilhas);
+    tabela->alocadasPilha = (int *)(bloco + offAlocadas);
+    tabela->arenas = (Arena *)(bloco + offArenas);
+    tabela->hashes = (HashSessao *)(bloco + offHashes);
+    tabela->tabuleiros = usarTabuleiro ? (Tabuleiro *)(bloco + offTabuleiros) : NULL;
+    
+    for (int i = 0; i < quantidade; i++) {
+        inicializarArena(&tabela->arenas[i]);
+        inicializarGerador(&tabela->geradores[i], config->semente + (uint64_t)i, config->modoGerador);
+        iniciarSessao(tabela, i);
+        if (usarTabuleiro) {
+            tabela->tabuleiros[i] = modelo;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Reinicia uma sessão que terminou: a arena dela é liberada inteira, a
+ * pilha volta à faixa fixa e a fila é refeita com uma semente nova
+ * @param semente - Semente do gerador da nova partida (mesmo modo de antes)
+ */
+void reiniciarSessao(TabelaSessoes *tabela, int sessao, uint64_t semente) {
+    liberarArena(&tabela->arenas[sessao]);
+    inicializarGerador(&tabela->geradores[sessao], semente, tabela->geradores[sessao].modo);
+    iniciarSessao(tabela, sessao);
+    if (tabela->tabuleiros) {
+        Tabuleiro *tabuleiro = &tabela->tabuleiros[sessao];
+        inicializarTabuleiro(tabuleiro, tabuleiro->largura, tabuleiro->altura);
+    }
+}
+
+/**
+ * Libera de uma vez a memória de todas as sessões
+ */
+void liberarTabelaSessoes(TabelaSessoes *tabela) {
+    for (int i = 0; i < tabela->quantidade; i++) {
+        liberarArena(&tabela->arenas[i]);
+    }
+    free(tabela->bloco);
+    tabela->bloco = NULL;
+    tabela->quantidade = 0;
+}
+
+/**
+ * Monta a fila e a pilha de uma sessão apontando para os arrays da tabela.
+ * As peças não são copiadas; só os campos de controle.
+ */
+void carregarSessao(TabelaSessoes *tabela, int sessao, FilaPecas *fila, PilhaReserva *pilha) {
+    fila->pecas = tabela->pecasFila + (size_t)sessao * tabela->capacidadeFila;
+    fila->mascara = tabela->capacidadeFila - 1;
+    fila->limite = tabela->limiteFila;
+    fila->frente = tabela->frente[sessao];
+    fila->tras = tabela->tras[sessao];
+    fila->tamanho = tabela->tamanho[sessao];
+    fila->proximoId = tabela->proximoId[sessao];
+    fila->gerador = &tabela->geradores[sessao];
+    fila->hash = tabela->hashes[sessao].hashFila;
+    fila->potencia = tabela->hashes[sessao].potenciaFila;
+    
+    pilha->pecas = tabela->pilhas[sessao];
+    pilha->capacidade = tabela->capacidadePilha;
+    pilha->alocadas = tabela->alocadasPilha[sessao];
+    pilha->arena = &tabela->arenas[sessao];
+    pilha->topo = tabela->topo[sessao];
+    pilha->hash = tabela->hashes[sessao].hashPilha;
+    pilha->potencia = tabela->hashes[sessao].potenciaPilha;
+    pilha->pecasTroca = tabela->pecasTroca;
+}
+
+/**
+ * Grava de volta na tabela os campos de controle de uma sessão
+ */
+void guardarSessao(TabelaSessoes *tabela, int sessao, FilaPecas *fila, PilhaReserva *pilha) {
+    tabela->frente[sessao] = fila->frente;
+    tabela->tras[sessao] = fila->tras;
+    tabela->tamanho[sessao] = fila->tamanho;
+    tabela->proximoId[sessao] = fila->proximoId;
+    tabela->topo[sessao] = pilha->topo;
+    tabela->pilhas[sessao] = pilha->pecas;        // O array pode ter crescido na arena
+    tabela->alocadasPilha[sessao] = pilha->alocadas;
+    tabela->hashes[sessao] = (HashSessao){fila->hash, fila->potencia, pilha->hash, pilha->potencia};
+}
+
+/**
+ * Aplica uma ação do menu (1 a 5) a uma sessão da tabela
+ * @param sessao - Índice da sessão (0 a quantidade - 1)
+ * @param opcao - Código da ação, igual ao do menu
+ * @return ResultadoOperacao - OP_SUCESSO ou o motivo da falha
+ */
+ResultadoOperacao aplicarAcaoSessao(TabelaSessoes *tabela, int sessao, int opcao) {
+    FilaPecas fila;
+    PilhaReserva pilha;
+    
+    carregarSessao(tabela, sessao, &fila, &pilha);
+    ResultadoOperacao resultado = aplicarAcao(&fila, &pilha, tabuleiroDaSessao(tabela, sessao), opcao);
+    if (resultado == OP_SUCESSO) {
+        guardarSessao(tabela, sessao, &fila, &pilha);
+    }
+    return resultado;
+}
+
+
+/**
+ * Calcula um resumo (FNV-1a de 64 bits) do estado da fila e da pilha.
+ * A fila é percorrida a partir da frente e a pilha da base até o topo,
+ * então dois estados com as mesmas peças na mesma ordem têm o mesmo resumo.
+ */
+uint64_t calcularResumoEstado(FilaPecas *fila, PilhaReserva *pilha) {
+    uint64_t hash = 1469598103934665603ULL;
+    
+    #define MISTURAR_RESUMO(valor) do {                   \
+        uint32_t v_ = (uint32_t)(valor);                  \
+        for (int b_ = 0; b_ < 4; b_++) {                  \
+            hash ^= (v_ >> (8 * b_)) & 0xFF;              \
+            hash *= 1099511628211ULL;                     \
+        }                                                 \
+    } while (0)
+    
+    MISTURAR_RESUMO(fila->tamanho);
+    int indice = fila->frente;
+    for (int i = 0; i < fila->tamanho; i++) {
+        MISTURAR_RESUMO(nomePeca(fila->pecas[indice]));
+        MISTURAR_RESUMO(idPeca(fila->pecas[indice]));
+        indice = (indice + 1) & fila->mascara;
+    }
+    
+    MISTURAR_RESUMO(pilha->topo + 1);
+    for (int i = 0; i <= pilha->topo; i++) {
+        MISTURAR_RESUMO(nomePeca(pilha->pecas[i]));
+        MISTURAR_RESUMO(idPeca(pilha->pecas[i]));
+    }
+    
+    #undef MISTURAR_RESUMO
+    return hash;
+}
+
+/**
+ * Combina o resumo de todas as sessões da tabela, na ordem dos índices
+ */
+uint64_t calcularResumoTabela(TabelaSessoes *tabela) {
+    uint64_t resumo = 1469598103934665603ULL;
+    
+    for (int i = 0; i < tabela->quantidade; i++) {
+        FilaPecas fila;
+        PilhaReserva pilha;
+        carregarSessao(tabela, i, &fila, &pilha);
+        resumo = (resumo ^ calcularResumoEstado(&fila, &pilha)) * 1099511628211ULL;
+        if (tabela->tabuleiros) {
+            resumo = (resumo ^ calcularResumoTabuleiro(&tabela->tabuleiros[i])) * 1099511628211ULL;
+        }
+    }
+    return resumo;
+}
@@ -0,0 +1,226 @@
+#ifndef TETRIS_JOGO_H
+#define TETRIS_JOGO_H
+
+// ---------------------------------------------------------------------------
+// Regras do nível Mestre sobre o núcleo: tabuleiro, ações do menu sem
+// impressão, histórico para desfazer e tabela de sessões
+// ---------------------------------------------------------------------------
+// Parte da biblioteca libtetris_nucleo.a (tetris_jogo.c). Como no núcleo,
+// nada aqui lê, imprime ou cria threads: quem mostra as mensagens, grava
+// arquivos ou atende conexões é o programa.
+
+#include <stdint.h>
+#include "tetris_nucleo.h"
+
+// Resultado de uma operação sobre a fila e a pilha (sem impressão)
+typedef enum {
+    OP_SUCESSO = 0,
+    OP_FILA_VAZIA,           // A fila não tem peças
+    OP_PILHA_CHEIA,          // A pilha de reserva está cheia
+    OP_PILHA_VAZIA,          // A pilha de reserva não tem peças
+    OP_FILA_INSUFICIENTE,    // Troca múltipla: fila com menos de 3 peças
+    OP_PILHA_INSUFICIENTE,   // Troca múltipla: pilha com menos de 3 peças
+    OP_OPCAO_INVALIDA        // Código de ação desconhecido
+} ResultadoOperacao;
+
+#define NUM_ACOES 6  // Ações 0 (sair) a 5 (troca múltipla)
+
+#define LARGURA_TABULEIRO 10          // Largura padrão do tabuleiro
+#define ALTURA_TABULEIRO 20           // Altura padrão do tabuleiro
+#define LARGURA_MAXIMA_TABULEIRO 32   // Uma linha é uma palavra de 32 bits
+#define ALTURA_MAXIMA_TABULEIRO 64
+#define LINHAS_EXTRAS_TABULEIRO 8     // Folga acima do topo para a peça caindo
+
+// Tabuleiro em que as peças jogadas são colocadas. Cada linha é uma máscara
+// de bits (bit c = coluna c), então testar colisão é um AND por linha e uma
+// linha completa é uma comparação com 'linhaCheia'.
+typedef struct {
+    uint32_t linhas[ALTURA_MAXIMA_TABULEIRO + LINHAS_EXTRAS_TABULEIRO];  // Linha 0 = fundo
+    int largura;                  // Colunas (4 a LARGURA_MAXIMA_TABULEIRO)
+    int altura;                   // Linhas visíveis (4 a ALTURA_MAXIMA_TABULEIRO)
+    uint32_t linhaCheia;          // Máscara de uma linha completa
+    int alturaOcupada;            // Linhas a partir desta estão vazias
+    long long pecasColocadas;     // Peças colocadas desde o início
+    long long linhasEliminadas;   // Linhas completas removidas desde o início
+    long long finsDeJogo;         // Vezes que uma peça passou do topo
+} Tabuleiro;
+
+// Onde e com que efeito uma peça foi colocada no tabuleiro
+typedef struct {
+    int rotacao;           // Rotação da peça (0 a 3)
+    int coluna;            // Coluna da borda esquerda da peça
+    int linha;             // Linha da base da peça
+    int linhasEliminadas;  // Linhas completas removidas pela peça
+    int mascaraEliminadas; // Bit r = linha 'linha + r' removida (antes da remoção)
+    int fimDeJogo;         // 1 se a peça passou do topo (tabuleiro reiniciado)
+} Colocacao;
+
+// Parâmetros de uma partida (os mesmos para todas as sessões de uma tabela)
+typedef struct {
+    int limiteFila;          // Peças na fila
+    int capacidadePilha;     // Capacidade da pilha de reserva
+    ModoGerador modoGerador; // Modo de sorteio dos tipos
+    uint64_t semente;        // Semente do gerador (da sessão 0, numa tabela)
+    int larguraTabuleiro;    // 0 = partida sem tabuleiro
+    int alturaTabuleiro;
+    int pecasTroca;          // Peças trocadas pela ação 5 (0 = PECAS_TROCA_MULTIPLA)
+} ConfiguracaoJogo;
+
+#define NUM_ROTACOES 4
+#define PECAS_TROCA_MULTIPLA 3  // Peças trocadas pela ação 5, se a pilha não pedir outro número
+
+// Tabelas de formas (tetris_jogo.c), indexadas por tipoPeca() e pela rotação
+extern const uint8_t LARGURA_FORMA[7][NUM_ROTACOES];
+extern const uint8_t ROTACOES_DISTINTAS[7];  // Rotações com formas diferentes
+
+// Histórico para desfazer e refazer ações. Cada ação guarda só o delta
+// inverso: as trocas (4 e 5) se desfazem aplicando-as de novo; jogar e
+// reservar tiram a peça nova do fim da fila e devolvem o tipo dela ao
+// gerador, e a peça que saiu volta à frente (ou sai da pilha); a colocação
+// no tabuleiro se desfaz devolvendo as linhas eliminadas (que estavam
+// cheias) e apagando os blocos da peça. O estado do gerador só é guardado
+// quando a ação reabasteceu o anel de tipos, no máximo uma vez a cada
+// dezenas de peças. Desfazer e refazer são O(1), e refazer é aplicar a ação
+// de novo: com o gerador restaurado, sai a mesma peça.
+//
+// As entradas ficam em um anel de capacidade fixa; a mais antiga é
+// descartada quando ele enche. Um fim de jogo esvazia o histórico, porque
+// desfazê-lo exigiria guardar o tabuleiro inteiro.
+#define CAPACIDADE_HISTORICO 256   // Ações guardadas, por padrão
+#define HISTORICO_MAXIMO (1 << 24) // Limite de --historico
+
+// Delta inverso de uma ação
+typedef struct {
+    Peca peca;                  // Peça jogada (1) ou usada (3)
+    uint8_t acao;               // Código da ação (1 a 5)
+    uint8_t reabasteceu;        // 1 se a ação reabasteceu o anel do gerador
+    uint8_t colocou;            // 1 se a peça foi colocada no tabuleiro
+    uint8_t alturaAnterior;     // alturaOcupada antes da colocação
+    uint8_t rotacao;            // Colocação, como em Colocacao
+    uint8_t coluna;
+    uint8_t linha;
+    uint8_t mascaraEliminadas;
+} EntradaHistorico;
+
+// Estado do gerador antes de um reabastecimento do anel
+typedef struct {
+    uint64_t estado[4];
+    uint32_t escrita;
+} FotoGerador;
+
+// Histórico de uma partida. Os contadores só crescem; o índice no anel é
+// o contador AND a máscara. [inicio, atual) pode ser desfeito e
+// [atual, fim) refeito; o mesmo vale para as fotos do gerador.
+typedef struct {
+    EntradaHistorico *entradas;
+    uint32_t mascara;           // Capacidade - 1 (potência de 2)
+    uint32_t inicio, atual, fim;
+    FotoGerador *fotos;
+    uint32_t mascaraFotos;
+    uint32_t inicioFotos, atualFotos, fimFotos;
+} Historico;
+
+// Estado capturado antes de uma ação, para montar o delta depois dela
+typedef struct {
+    FotoGerador gerador;
+    uint32_t leitura;
+    int alturaOcupada;
+    Peca frente;                // Frente da fila (peça jogada pela ação 1)
+    Peca topo;                  // Topo da pilha (peça usada pela ação 3)
+} MarcaHistorico;
+
+// Campos de hash de uma sessão (FilaPecas.hash/potencia e PilhaReserva.hash/potencia)
+typedef struct {
+    uint64_t hashFila;
+    uint64_t potenciaFila;
+    uint64_t hashPilha;
+    uint64_t potenciaPilha;
+} HashSessao;
+
+// Tabela de sessões: N partidas independentes em uma única alocação, com
+// cada campo guardado em um array próprio (estrutura de arrays). Os campos
+// de controle de todas as sessões ficam contíguos na memória, e as peças de
+// cada sessão ocupam uma faixa fixa dos arrays de fila e de pilha. A faixa
+// da pilha tem até PILHA_INICIAL_ARENA posições; pilhas mais fundas crescem
+// na arena da própria sessão, liberada inteira quando a sessão termina.
+typedef struct {
+    int quantidade;            // Número de sessões
+    int limiteFila;            // Peças na fila de cada sessão
+    int capacidadeFila;        // Posições reservadas para a fila de cada sessão
+    int capacidadePilha;       // Capacidade da pilha de cada sessão
+    int alocacaoInicialPilha;  // Posições da faixa fixa da pilha de cada sessão
+    int pecasTroca;            // PilhaReserva.pecasTroca de todas as sessões
+    
+    int *frente;               // FilaPecas.frente de cada sessão
+    int *tras;                 // FilaPecas.tras de cada sessão
+    int *tamanho;              // FilaPecas.tamanho de cada sessão
+    int *topo;                 // PilhaReserva.topo de cada sessão
+    IdPeca *proximoId;         // FilaPecas.proximoId de cada sessão
+    GeradorPecas *geradores;   // Gerador de cada sessão
+    Peca *pecasFila;           // quantidade x capacidadeFila peças
+    Peca *pecasPilha;          // quantidade x alocacaoInicialPilha peças
+    Peca **pilhas;             // Array atual da pilha de cada sessão (faixa fixa ou arena)
+    int *alocadasPilha;        // PilhaReserva.alocadas de cada sessão
+    Arena *arenas;             // Arena de cada sessão, usada quando a pilha cresce
+    HashSessao *hashes;        // Hashes incrementais da fila e da pilha de cada sessão
+    Tabuleiro *tabuleiros;     // Tabuleiro de cada sessão (NULL = partidas sem tabuleiro)
+    
+    void *bloco;               // Alocação única que contém todos os arrays
+} TabelaSessoes;
+
+// Tabuleiro
+int inicializarTabuleiro(Tabuleiro *tabuleiro, int largura, int altura);
+void limparTabuleiro(Tabuleiro *tabuleiro);
+int posicaoLivre(const Tabuleiro *tabuleiro, int tipo, int rotacao, int x, int y);
+int girarPeca(const Tabuleiro *tabuleiro, int tipo, int *rotacao, int *x, int *y, int antiHorario);
+int linhaDeQueda(const Tabuleiro *tabuleiro, int tipo, int rotacao, int x);
+int colocarPeca(Tabuleiro *tabuleiro, int tipo, int rotacao, int x, Colocacao *colocacao);
+void desfazerColocacao(Tabuleiro *tabuleiro, int tipo, const Colocacao *colocacao, int alturaAnterior);
+int escolherColocacaoPadrao(const Tabuleiro *tabuleiro, int tipo, int *rotacao);
+uint64_t calcularResumoTabuleiro(const Tabuleiro *tabuleiro);
+
+// Ações do menu sem impressão
+ResultadoOperacao operacaoJogar(FilaPecas *fila, Tabuleiro *tabuleiro,
+                                Peca *jogada, Peca *nova, Colocacao *colocacao);
+ResultadoOperacao operacaoEnviarParaPilha(FilaPecas *fila, PilhaReserva *pilha,
+                                          Peca *reservada, Peca *nova);
+ResultadoOperacao operacaoUsarDaPilha(PilhaReserva *pilha, Tabuleiro *tabuleiro,
+                                      Peca *usada, Colocacao *colocacao);
+ResultadoOperacao operacaoTrocarAtual(FilaPecas *fila, PilhaReserva *pilha);
+ResultadoOperacao operacaoTrocarPecas(FilaPecas *fila, PilhaReserva *pilha, int k);
+int pecasTrocaMultipla(const PilhaReserva *pilha);
+ResultadoOperacao operacaoTrocarMultipla(FilaPecas *fila, PilhaReserva *pilha);
+ResultadoOperacao aplicarAcao(FilaPecas *fila, PilhaReserva *pilha, Tabuleiro *tabuleiro,
+                              int opcao);
+uint64_t calcularResumoEstado(FilaPecas *fila, PilhaReserva *pilha);
+
+// Histórico
+int criarHistorico(Historico *historico, int capacidade);
+void liberarHistorico(Historico *historico);
+void esvaziarHistorico(Historico *historico);
+void marcarAntesDaAcao(MarcaHistorico *marca, const FilaPecas *fila, const PilhaReserva *pilha,
+                       const Tabuleiro *tabuleiro);
+void registrarNoHistorico(Historico *historico, const MarcaHistorico *marca, int acao,
+                          ResultadoOperacao resultado, const Colocacao *colocacao);
+ResultadoOperacao aplicarAcaoComHistorico(Historico *historico, FilaPecas *fila, PilhaReserva *pilha,
+                                          Tabuleiro *tabuleiro, int opcao);
+int desfazerAcao(Historico *historico, FilaPecas *fila, PilhaReserva *pilha, Tabuleiro *tabuleiro);
+int refazerAcao(Historico *historico, FilaPecas *fila, PilhaReserva *pilha, Tabuleiro *tabuleiro);
+
+// Tabela de sessões
+int criarTabelaSessoes(TabelaSessoes *tabela, int quantidade, const ConfiguracaoJogo *config);
+void reiniciarSessao(TabelaSessoes *tabela, int sessao, uint64_t semente);
+void liberarTabelaSessoes(TabelaSessoes *tabela);
+void carregarSessao(TabelaSessoes *tabela, int sessao, FilaPecas *fila, PilhaReserva *pilha);
+void guardarSessao(TabelaSessoes *tabela, int sessao, FilaPecas *fila, PilhaReserva *pilha);
+ResultadoOperacao aplicarAcaoSessao(TabelaSessoes *tabela, int sessao, int opcao);
+uint64_t calcularResumoTabela(TabelaSessoes *tabela);
+
+/**
+ * Retorna o tabuleiro de uma sessão (NULL se as partidas não têm tabuleiro)
+ */
+static inline Tabuleiro *tabuleiroDaSessao(TabelaSessoes *tabela, int sessao) {
+    return tabela->tabuleiros ? &tabela->tabuleiros[sessao] : NULL;
+}
+
+#endif  // TETRIS_JOGO_H
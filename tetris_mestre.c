@@ -1,385 +1,5105 @@
+#define _GNU_SOURCE  // accept4
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#define TEM_IO_URING 1          // Backend io_uring do servidor (--io-uring)
+#endif
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "tetris_nucleo.h"
+#include "tetris_jogo.h"
+#include "tetris_canal.h"
 
-#define TAMANHO_FILA 5
-#define TAMANHO_PILHA 3
+#define TAMANHO_FILA 5            // Tamanho padrão da fila (prévia de peças)
+#define TAMANHO_PILHA 3           // Capacidade padrão da pilha de reserva
+#define MAX_PILHA_EXIBIDA 16      // Peças da pilha mostradas na tela
 
-// Estrutura que representa uma peça do Tetris
-typedef struct {
-    char nome;  // Tipo da peça: 'I', 'O', 'T', 'L'
-    int id;     // Identificador único da peça
-} Peca;
+// ---------------------------------------------------------------------------
+// Renderizador: cada quadro (mensagens, estado e menu) é montado em um único
+// buffer de memória e enviado com uma só chamada a write(). Em um terminal,
+// o modo diferencial compara o quadro com o anterior e reescreve apenas as
+// linhas que mudaram, posicionando o cursor com sequências ANSI.
+// ---------------------------------------------------------------------------
+
+#define CAPACIDADE_INICIAL_QUADRO 4096
+#define LINHAS_MENSAGEM 4  // Linhas reservadas para mensagens no modo diferencial
 
-// Estrutura que representa a fila circular de peças
-typedef struct {
-    Peca pecas[TAMANHO_FILA];  // Array de peças
-    int frente;                 // Índice da frente da fila
-    int tras;                   // Índice do final da fila
-    int tamanho;                // Quantidade atual de peças na fila
-    int proximoId;              // Próximo ID a ser atribuído
-} FilaPecas;
-
-// Estrutura que representa a pilha de peças reservadas
 typedef struct {
-    Peca pecas[TAMANHO_PILHA];  // Array de peças reservadas
-    int topo;                    // Índice do topo da pilha (-1 = vazia)
-} PilhaReserva;
+    char *quadro;              // Quadro em construção
+    size_t tamanho;
+    size_t capacidade;
+    char *anterior;            // Último quadro enviado (modo diferencial)
+    size_t tamanhoAnterior;
+    size_t capacidadeAnterior;
+    char *saida;               // Bytes que vão para o terminal neste quadro
+    size_t tamanhoSaida;
+    size_t capacidadeSaida;
+    int diferencial;           // 1 = redesenha só as linhas alteradas
+    int telaLimpa;             // 0 até o primeiro quadro diferencial limpar a tela
+} Renderizador;
 
 /**
- * Gera uma peça aleatória com um ID único
- * @param id - Identificador único para a peça
- * @return Peca - Nova peça gerada
+ * Garante espaço para mais 'extra' bytes em um buffer que cresce em dobro
  */
-Peca gerarPeca(int id) {
-    Peca novaPeca;
-    char tipos[] = {'I', 'O', 'T', 'L'};
-    
-    // Seleciona um tipo aleatório
-    novaPeca.nome = tipos[rand() % 4];
-    novaPeca.id = id;
+static void garantirEspaco(char **buffer, size_t *capacidade, size_t tamanho, size_t extra) {
+    if (tamanho + extra + 1 <= *capacidade) {
+        return;
+    }
     
-    return novaPeca;
+    size_t nova = *capacidade ? *capacidade : CAPACIDADE_INICIAL_QUADRO;
+    while (nova < tamanho + extra + 1) {
+        nova *= 2;
+    }
+    char *novoBuffer = realloc(*buffer, nova);
+    if (novoBuffer == NULL) {
+        fprintf(stderr, "❌ Erro: memória insuficiente para o quadro.\n");
+        exit(1);
+    }
+    *buffer = novoBuffer;
+    *capacidade = nova;
 }
 
 /**
- * Inicializa a fila de peças com elementos iniciais
- * @param fila - Ponteiro para a estrutura da fila
+ * Inicializa o renderizador
+ * @param diferencial - 1 para redesenhar só as linhas alteradas (requer terminal ANSI)
  */
-void inicializarFila(FilaPecas *fila) {
-    fila->frente = 0;
-    fila->tras = 0;
-    fila->tamanho = 0;
-    fila->proximoId = 0;
-    
-    // Preenche a fila com peças iniciais
-    for (int i = 0; i < TAMANHO_FILA; i++) {
-        fila->pecas[i] = gerarPeca(fila->proximoId);
-        fila->proximoId++;
-        fila->tamanho++;
-        fila->tras = (fila->tras + 1) % TAMANHO_FILA;
-    }
+void inicializarRenderizador(Renderizador *tela, int diferencial) {
+    memset(tela, 0, sizeof(*tela));
+    tela->diferencial = diferencial;
 }
 
 /**
- * Inicializa a pilha de reserva vazia
- * @param pilha - Ponteiro para a estrutura da pilha
+ * Libera os buffers do renderizador
  */
-void inicializarPilha(PilhaReserva *pilha) {
-    pilha->topo = -1;  // Pilha começa vazia
+void liberarRenderizador(Renderizador *tela) {
+    free(tela->quadro);
+    free(tela->anterior);
+    free(tela->saida);
+    memset(tela, 0, sizeof(*tela));
 }
 
 /**
- * Verifica se a fila está vazia
+ * Começa um quadro novo (vazio)
  */
-int filaVazia(FilaPecas *fila) {
-    return fila->tamanho == 0;
+void iniciarQuadro(Renderizador *tela) {
+    tela->tamanho = 0;
 }
 
 /**
- * Verifica se a fila está cheia
+ * Acrescenta texto formatado ao quadro (mesma sintaxe do printf)
  */
-int filaCheia(FilaPecas *fila) {
-    return fila->tamanho == TAMANHO_FILA;
+void escreverQuadro(Renderizador *tela, const char *formato, ...) {
+    va_list argumentos;
+    
+    garantirEspaco(&tela->quadro, &tela->capacidade, tela->tamanho, 256);
+    va_start(argumentos, formato);
+    int escritos = vsnprintf(tela->quadro + tela->tamanho, tela->capacidade - tela->tamanho,
+                             formato, argumentos);
+    va_end(argumentos);
+    
+    if (escritos >= 0 && (size_t)escritos >= tela->capacidade - tela->tamanho) {
+        // Não coube: aumenta o buffer e formata de novo
+        garantirEspaco(&tela->quadro, &tela->capacidade, tela->tamanho, (size_t)escritos);
+        va_start(argumentos, formato);
+        vsnprintf(tela->quadro + tela->tamanho, tela->capacidade - tela->tamanho,
+                  formato, argumentos);
+        va_end(argumentos);
+    }
+    if (escritos > 0) {
+        tela->tamanho += (size_t)escritos;
+    }
 }
 
 /**
- * Verifica se a pilha está vazia
+ * Completa com linhas em branco o trecho do quadro que começou em 'inicio',
+ * para que ele ocupe sempre 'linhas' linhas. Assim, no modo diferencial, uma
+ * mensagem mais curta não desloca o resto da tela.
  */
-int pilhaVazia(PilhaReserva *pilha) {
-    return pilha->topo == -1;
+void completarLinhas(Renderizador *tela, size_t inicio, int linhas) {
+    if (!tela->diferencial) {
+        return;
+    }
+    
+    int contadas = 0;
+    for (size_t i = inicio; i < tela->tamanho; i++) {
+        if (tela->quadro[i] == '\n') {
+            contadas++;
+        }
+    }
+    while (contadas++ < linhas) {
+        escreverQuadro(tela, "\n");
+    }
 }
 
 /**
- * Verifica se a pilha está cheia
+ * Acrescenta bytes ao buffer de saída do quadro
  */
-int pilhaCheia(PilhaReserva *pilha) {
-    return pilha->topo == TAMANHO_PILHA - 1;
+static void acrescentarSaida(Renderizador *tela, const char *dados, size_t tamanho) {
+    garantirEspaco(&tela->saida, &tela->capacidadeSaida, tela->tamanhoSaida, tamanho);
+    memcpy(tela->saida + tela->tamanhoSaida, dados, tamanho);
+    tela->tamanhoSaida += tamanho;
 }
 
 /**
- * Adiciona uma nova peça gerada ao final da fila
+ * Conta as colunas de uma linha em UTF-8 (um caractere = uma coluna)
  */
-void adicionarPecaNaFila(FilaPecas *fila) {
-    if (filaCheia(fila)) {
-        return;  // Não adiciona se já está cheia
+static int larguraLinha(const char *linha, size_t tamanho) {
+    int colunas = 0;
+    for (size_t i = 0; i < tamanho; i++) {
+        if (((unsigned char)linha[i] & 0xC0) != 0x80) {
+            colunas++;
+        }
     }
-    
-    // Gera e insere nova peça no final
-    Peca novaPeca = gerarPeca(fila->proximoId);
-    fila->pecas[fila->tras] = novaPeca;
-    fila->tras = (fila->tras + 1) % TAMANHO_FILA;
-    fila->tamanho++;
-    fila->proximoId++;
+    return colunas;
 }
 
 /**
- * Remove e retorna a peça da frente da fila
+ * Retorna o tamanho da linha que começa em 'texto' (sem o '\n')
  */
-Peca removerDaFila(FilaPecas *fila) {
-    Peca pecaRemovida = fila->pecas[fila->frente];
-    fila->frente = (fila->frente + 1) % TAMANHO_FILA;
-    fila->tamanho--;
-    return pecaRemovida;
+static size_t tamanhoLinha(const char *texto, size_t restante) {
+    const char *fim = memchr(texto, '\n', restante);
+    return fim ? (size_t)(fim - texto) : restante;
 }
 
 /**
- * Opção 1: Joga uma peça (remove da fila e adiciona nova)
+ * Verifica se o quadro cabe no terminal sem rolar (requisito do modo diferencial)
  */
-void jogarPeca(FilaPecas *fila) {
-    if (filaVazia(fila)) {
-        printf("\n❌ Erro: A fila está vazia!\n");
-        return;
+static int quadroCabeNaTela(Renderizador *tela) {
+    struct winsize janela;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &janela) != 0 || janela.ws_row == 0) {
+        return 1;  // Tamanho desconhecido: assume que cabe
     }
     
-    // Remove a peça da frente
-    Peca pecaJogada = removerDaFila(fila);
-    printf("\n✓ Peça [%c %d] jogada com sucesso!\n", pecaJogada.nome, pecaJogada.id);
-    
-    // Adiciona uma nova peça no final da fila
-    adicionarPecaNaFila(fila);
-    printf("✓ Nova peça [%c %d] adicionada à fila.\n", 
-           fila->pecas[(fila->tras - 1 + TAMANHO_FILA) % TAMANHO_FILA].nome,
-           fila->pecas[(fila->tras - 1 + TAMANHO_FILA) % TAMANHO_FILA].id);
+    int linhas = 0;
+    size_t pos = 0;
+    while (pos < tela->tamanho) {
+        size_t tamanho = tamanhoLinha(tela->quadro + pos, tela->tamanho - pos);
+        if (larguraLinha(tela->quadro + pos, tamanho) >= janela.ws_col) {
+            return 0;
+        }
+        linhas++;
+        pos += tamanho + 1;
+    }
+    return linhas < janela.ws_row;
 }
 
 /**
- * Opção 2: Envia peça da fila para a pilha de reserva
+ * Monta a saída do modo diferencial: reescreve só as linhas diferentes do
+ * quadro anterior e deixa o cursor no fim do quadro (depois do prompt)
  */
-void enviarParaPilha(FilaPecas *fila, PilhaReserva *pilha) {
-    if (filaVazia(fila)) {
-        printf("\n❌ Erro: A fila está vazia!\n");
-        return;
-    }
+static void montarDiferenca(Renderizador *tela) {
+    char comando[32];
+    size_t posNovo = 0, posAnterior = 0;
+    int linhas = 0;          // Linhas do quadro novo já examinadas
+    int colunaFinal = 0;     // Largura da última linha do quadro novo
+    int n;
     
-    if (pilhaCheia(pilha)) {
-        printf("\n❌ Erro: A pilha de reserva está cheia!\n");
-        return;
+    if (!tela->telaLimpa || !quadroCabeNaTela(tela)) {
+        acrescentarSaida(tela, "\x1b[H\x1b[2J", 7);  // Redesenho completo
+        tela->tamanhoAnterior = 0;
+        tela->telaLimpa = 1;
     }
     
-    // Remove da fila e adiciona na pilha
-    Peca pecaReservada = removerDaFila(fila);
-    pilha->topo++;
-    pilha->pecas[pilha->topo] = pecaReservada;
+    while (posNovo < tela->tamanho) {
+        size_t tamNovo = tamanhoLinha(tela->quadro + posNovo, tela->tamanho - posNovo);
+        int igual = 0;
+        
+        if (posAnterior < tela->tamanhoAnterior) {
+            size_t tamAnterior = tamanhoLinha(tela->anterior + posAnterior,
+                                              tela->tamanhoAnterior - posAnterior);
+            igual = tamAnterior == tamNovo &&
+                    memcmp(tela->anterior + posAnterior, tela->quadro + posNovo, tamNovo) == 0;
+            posAnterior += tamAnterior + 1;
+        }
+        
+        if (!igual) {
+            n = snprintf(comando, sizeof(comando), "\x1b[%d;1H", linhas + 1);
+            acrescentarSaida(tela, comando, (size_t)n);
+            acrescentarSaida(tela, tela->quadro + posNovo, tamNovo);
+            acrescentarSaida(tela, "\x1b[K", 3);
+        }
+        
+        colunaFinal = larguraLinha(tela->quadro + posNovo, tamNovo);
+        posNovo += tamNovo + 1;
+        linhas++;
+    }
     
-    printf("\n✓ Peça [%c %d] enviada para a pilha de reserva!\n", 
-           pecaReservada.nome, pecaReservada.id);
+    // Apaga o que sobrou de um quadro anterior mais longo
+    if (posAnterior < tela->tamanhoAnterior) {
+        n = snprintf(comando, sizeof(comando), "\x1b[%d;1H\x1b[J", linhas + 1);
+        acrescentarSaida(tela, comando, (size_t)n);
+    }
     
-    // Adiciona uma nova peça no final da fila
-    adicionarPecaNaFila(fila);
-    printf("✓ Nova peça [%c %d] adicionada à fila.\n", 
-           fila->pecas[(fila->tras - 1 + TAMANHO_FILA) % TAMANHO_FILA].nome,
-           fila->pecas[(fila->tras - 1 + TAMANHO_FILA) % TAMANHO_FILA].id);
+    // Cursor no fim do quadro: depois do prompt, ou no início da linha seguinte
+    if (tela->tamanho > 0 && tela->quadro[tela->tamanho - 1] == '\n') {
+        n = snprintf(comando, sizeof(comando), "\x1b[%d;1H", linhas + 1);
+    } else {
+        n = snprintf(comando, sizeof(comando), "\x1b[%d;%dH", linhas, colunaFinal + 1);
+    }
+    acrescentarSaida(tela, comando, (size_t)n);
 }
 
 /**
- * Opção 3: Usa uma peça da pilha de reserva
+ * Fecha o quadro. No modo diferencial só as linhas alteradas desde o
+ * último quadro vão para a saída.
+ * @param tamanho - Recebe o número de bytes a enviar
+ * @return const char* - Bytes a enviar, válidos até o próximo quadro
  */
-void usarPecaDaPilha(PilhaReserva *pilha) {
-    if (pilhaVazia(pilha)) {
-        printf("\n❌ Erro: A pilha de reserva está vazia!\n");
-        return;
+const char *concluirQuadro(Renderizador *tela, size_t *tamanho) {
+    if (!tela->diferencial) {
+        *tamanho = tela->tamanho;
+        return tela->quadro;
     }
     
-    // Remove do topo da pilha
-    Peca pecaUsada = pilha->pecas[pilha->topo];
-    pilha->topo--;
+    tela->tamanhoSaida = 0;
+    montarDiferenca(tela);
     
-    printf("\n✓ Peça da pilha [%c %d] usada com sucesso!\n", 
-           pecaUsada.nome, pecaUsada.id);
+    // O quadro atual vira a referência do próximo
+    garantirEspaco(&tela->anterior, &tela->capacidadeAnterior, 0, tela->tamanho);
+    memcpy(tela->anterior, tela->quadro, tela->tamanho);
+    tela->tamanhoAnterior = tela->tamanho;
+    *tamanho = tela->tamanhoSaida;
+    return tela->saida;
 }
 
 /**
- * Opção 4: Troca a peça da frente da fila com o topo da pilha
+ * Envia um quadro pronto ao terminal com uma única chamada a write()
+ * @param contexto - Não usado (assinatura de EntregaQuadro)
  */
-void trocarPecaAtual(FilaPecas *fila, PilhaReserva *pilha) {
-    if (filaVazia(fila)) {
-        printf("\n❌ Erro: A fila está vazia!\n");
-        return;
+void escreverNoTerminal(void *contexto, const char *dados, size_t tamanho) {
+    (void)contexto;
+    while (tamanho > 0) {
+        ssize_t escritos = write(STDOUT_FILENO, dados, tamanho);
+        if (escritos <= 0) {
+            break;
+        }
+        dados += escritos;
+        tamanho -= (size_t)escritos;
     }
+}
+
+/**
+ * Escreve no quadro onde a peça caiu no tabuleiro
+ */
+static void descreverColocacao(Renderizador *tela, const Colocacao *colocacao) {
+    if (colocacao->fimDeJogo) {
+        escreverQuadro(tela, "💥 Fim de jogo! A peça passou do topo; o tabuleiro foi esvaziado.\n");
+    } else {
+        escreverQuadro(tela, "  Colocada na coluna %d, linha %d, rotação %d°: %d linha(s) eliminada(s).\n",
+                       colocacao->coluna, colocacao->linha, colocacao->rotacao * 90,
+                       colocacao->linhasEliminadas);
+    }
+}
+
+/**
+ * Opção 1: Joga uma peça (remove da fila, coloca no tabuleiro e adiciona nova)
+ * @param colocacao - Recebe onde a peça caiu, se houver tabuleiro
+ */
+ResultadoOperacao jogarPeca(Renderizador *tela, FilaPecas *fila, Tabuleiro *tabuleiro,
+                            Colocacao *colocacao) {
+    Peca pecaJogada, novaPeca;
     
-    if (pilhaVazia(pilha)) {
-        printf("\n❌ Erro: A pilha está vazia!\n");
-        return;
+    ResultadoOperacao resultado = operacaoJogar(fila, tabuleiro, &pecaJogada, &novaPeca, colocacao);
+    if (resultado == OP_FILA_VAZIA) {
+        escreverQuadro(tela, "\n❌ Erro: A fila está vazia!\n");
+        return resultado;
     }
     
-    // Guarda as peças que serão trocadas
-    Peca pecaFila = fila->pecas[fila->frente];
-    Peca pecaPilha = pilha->pecas[pilha->topo];
+    escreverQuadro(tela, "\n✓ Peça " FORMATO_PECA " jogada com sucesso!\n", ARGS_PECA(pecaJogada));
+    escreverQuadro(tela, "✓ Nova peça " FORMATO_PECA " adicionada à fila.\n", ARGS_PECA(novaPeca));
+    if (tabuleiro != NULL) {
+        descreverColocacao(tela, colocacao);
+    }
+    return resultado;
+}
+
+/**
+ * Opção 2: Envia peça da fila para a pilha de reserva
+ */
+ResultadoOperacao enviarParaPilha(Renderizador *tela, FilaPecas *fila, PilhaReserva *pilha) {
+    Peca pecaReservada, novaPeca;
+    ResultadoOperacao resultado = operacaoEnviarParaPilha(fila, pilha, &pecaReservada, &novaPeca);
     
-    // Realiza a troca
-    fila->pecas[fila->frente] = pecaPilha;
-    pilha->pecas[pilha->topo] = pecaFila;
+    switch (resultado) {
+        case OP_FILA_VAZIA:
+            escreverQuadro(tela, "\n❌ Erro: A fila está vazia!\n");
+            return resultado;
+        case OP_PILHA_CHEIA:
+            escreverQuadro(tela, "\n❌ Erro: A pilha de reserva está cheia!\n");
+            return resultado;
+        default:
+            break;
+    }
     
-    printf("\n✓ Troca realizada!\n");
-    printf("  Peça da fila [%c %d] ↔ Peça da pilha [%c %d]\n", 
-           pecaFila.nome, pecaFila.id, pecaPilha.nome, pecaPilha.id);
+    escreverQuadro(tela, "\n✓ Peça " FORMATO_PECA " enviada para a pilha de reserva!\n", 
+           ARGS_PECA(pecaReservada));
+    escreverQuadro(tela, "✓ Nova peça " FORMATO_PECA " adicionada à fila.\n", ARGS_PECA(novaPeca));
+    return resultado;
 }
 
 /**
- * Opção 5: Troca múltipla - troca os 3 primeiros da fila com os 3 da pilha
+ * Opção 3: Usa uma peça da pilha de reserva
+ * @param colocacao - Recebe onde a peça caiu, se houver tabuleiro
  */
-void trocarMultipla(FilaPecas *fila, PilhaReserva *pilha) {
-    // Valida se há pelo menos 3 peças em cada estrutura
-    if (fila->tamanho < 3) {
-        printf("\n❌ Erro: A fila precisa ter pelo menos 3 peças!\n");
-        return;
+ResultadoOperacao usarPecaDaPilha(Renderizador *tela, PilhaReserva *pilha, Tabuleiro *tabuleiro,
+                                  Colocacao *colocacao) {
+    Peca pecaUsada;
+    
+    ResultadoOperacao resultado = operacaoUsarDaPilha(pilha, tabuleiro, &pecaUsada, colocacao);
+    if (resultado == OP_PILHA_VAZIA) {
+        escreverQuadro(tela, "\n❌ Erro: A pilha de reserva está vazia!\n");
+        return resultado;
     }
     
-    if (pilha->topo < 2) {  // topo >= 2 significa pelo menos 3 peças (índices 0, 1, 2)
-        printf("\n❌ Erro: A pilha precisa ter pelo menos 3 peças!\n");
-        return;
+    escreverQuadro(tela, "\n✓ Peça da pilha " FORMATO_PECA " usada com sucesso!\n", 
+           ARGS_PECA(pecaUsada));
+    if (tabuleiro != NULL) {
+        descreverColocacao(tela, colocacao);
+    }
+    return resultado;
+}
+
+/**
+ * Opção 4: Troca a peça da frente da fila com o topo da pilha
+ */
+ResultadoOperacao trocarPecaAtual(Renderizador *tela, FilaPecas *fila, PilhaReserva *pilha) {
+    ResultadoOperacao resultado = operacaoTrocarAtual(fila, pilha);
+    
+    switch (resultado) {
+        case OP_FILA_VAZIA:
+            escreverQuadro(tela, "\n❌ Erro: A fila está vazia!\n");
+            return resultado;
+        case OP_PILHA_VAZIA:
+            escreverQuadro(tela, "\n❌ Erro: A pilha está vazia!\n");
+            return resultado;
+        default:
+            break;
     }
     
-    printf("\n🔄 Realizando troca múltipla...\n");
+    // Após a troca, a peça da fila está no topo da pilha e vice-versa
+    Peca pecaFila = pilha->pecas[pilha->topo];
+    Peca pecaPilha = fila->pecas[fila->frente];
     
-    // Array temporário para guardar as 3 peças da fila
-    Peca tempFila[3];
+    escreverQuadro(tela, "\n✓ Troca realizada!\n");
+    escreverQuadro(tela, "  Peça da fila " FORMATO_PECA " ↔ Peça da pilha " FORMATO_PECA "\n", 
+           ARGS_PECA(pecaFila), ARGS_PECA(pecaPilha));
+    return resultado;
+}
+
+/**
+ * Opção 5: Troca múltipla - troca os k primeiros da fila com os k da pilha
+ * (k = pecasTrocaMultipla, 3 se --troca não mudar)
+ */
+ResultadoOperacao trocarMultipla(Renderizador *tela, FilaPecas *fila, PilhaReserva *pilha) {
+    int k = pecasTrocaMultipla(pilha);
+    ResultadoOperacao resultado = operacaoTrocarMultipla(fila, pilha);
     
-    // Guarda as 3 primeiras peças da fila
-    int indiceFila = fila->frente;
-    for (int i = 0; i < 3; i++) {
-        tempFila[i] = fila->pecas[indiceFila];
-        indiceFila = (indiceFila + 1) % TAMANHO_FILA;
+    switch (resultado) {
+        case OP_FILA_INSUFICIENTE:
+            escreverQuadro(tela, "\n❌ Erro: A fila precisa ter pelo menos %d peças!\n", k);
+            return resultado;
+        case OP_PILHA_INSUFICIENTE:
+            escreverQuadro(tela, "\n❌ Erro: A pilha precisa ter pelo menos %d peças!\n", k);
+            return resultado;
+        default:
+            break;
     }
     
-    // Substitui as 3 primeiras da fila pelas 3 do topo da pilha
-    indiceFila = fila->frente;
-    for (int i = 0; i < 3; i++) {
-        fila->pecas[indiceFila] = pilha->pecas[pilha->topo - (2 - i)];
-        indiceFila = (indiceFila + 1) % TAMANHO_FILA;
+    escreverQuadro(tela, "\n🔄 Realizando troca múltipla...\n");
+    escreverQuadro(tela, "✓ Troca múltipla realizada com sucesso!\n");
+    escreverQuadro(tela, "  %d peças da fila trocadas com %d peças da pilha.\n", k, k);
+    return resultado;
+}
+
+// Nome de cada ação nas mensagens de desfazer e refazer
+static const char *DESCRICAO_ACOES[NUM_ACOES] = {
+    "", "jogar peça", "enviar para a pilha", "usar peça da pilha", "trocar peça atual", "troca múltipla"
+};
+
+/**
+ * Opção 6: Desfaz a última ação
+ * @param historico - Histórico da partida (NULL = desfazer indisponível)
+ * @return int - 1 se alguma ação foi desfeita
+ */
+int desfazerUltimaAcao(Renderizador *tela, Historico *historico, FilaPecas *fila,
+                        PilhaReserva *pilha, Tabuleiro *tabuleiro) {
+    if (historico == NULL) {
+        escreverQuadro(tela, "\n❌ Erro: Desfazer não está disponível nesta partida!\n");
+        return 0;
     }
     
-    // Substitui as 3 peças da pilha pelas que estavam na fila
-    for (int i = 0; i < 3; i++) {
-        pilha->pecas[pilha->topo - (2 - i)] = tempFila[i];
+    int acao = desfazerAcao(historico, fila, pilha, tabuleiro);
+    if (acao == 0) {
+        escreverQuadro(tela, "\n❌ Erro: Não há ação para desfazer!\n");
+        return 0;
+    }
+    escreverQuadro(tela, "\n↩ Ação desfeita: %s.\n", DESCRICAO_ACOES[acao]);
+    return 1;
+}
+
+/**
+ * Opção 7: Refaz a última ação desfeita
+ * @param historico - Histórico da partida (NULL = refazer indisponível)
+ * @return int - 1 se alguma ação foi refeita
+ */
+int refazerUltimaAcao(Renderizador *tela, Historico *historico, FilaPecas *fila,
+                       PilhaReserva *pilha, Tabuleiro *tabuleiro) {
+    if (historico == NULL) {
+        escreverQuadro(tela, "\n❌ Erro: Refazer não está disponível nesta partida!\n");
+        return 0;
     }
     
-    printf("✓ Troca múltipla realizada com sucesso!\n");
-    printf("  3 peças da fila trocadas com 3 peças da pilha.\n");
+    int acao = refazerAcao(historico, fila, pilha, tabuleiro);
+    if (acao == 0) {
+        escreverQuadro(tela, "\n❌ Erro: Não há ação para refazer!\n");
+        return 0;
+    }
+    escreverQuadro(tela, "\n↪ Ação refeita: %s.\n", DESCRICAO_ACOES[acao]);
+    return 1;
+}
+
+/**
+ * Escreve no quadro o tabuleiro, de cima para baixo
+ */
+void exibirTabuleiro(Renderizador *tela, Tabuleiro *tabuleiro) {
+    for (int y = tabuleiro->altura - 1; y >= 0; y--) {
+        escreverQuadro(tela, "│");
+        for (int x = 0; x < tabuleiro->largura; x++) {
+            escreverQuadro(tela, (tabuleiro->linhas[y] >> x) & 1 ? "█" : "·");
+        }
+        escreverQuadro(tela, "│\n");
+    }
+    escreverQuadro(tela, "└");
+    for (int x = 0; x < tabuleiro->largura; x++) {
+        escreverQuadro(tela, "─");
+    }
+    escreverQuadro(tela, "┘\n");
+    escreverQuadro(tela, "Peças: %lld  Linhas: %lld  Fins de jogo: %lld\n",
+                   tabuleiro->pecasColocadas, tabuleiro->linhasEliminadas, tabuleiro->finsDeJogo);
 }
 
 /**
- * Exibe o estado atual da fila e da pilha
+ * Escreve no quadro o estado atual do tabuleiro (se houver), da fila e da pilha
  */
-void exibirEstado(FilaPecas *fila, PilhaReserva *pilha) {
-    printf("\n========================================\n");
-    printf("ESTADO ATUAL\n");
-    printf("========================================\n");
+void exibirEstado(Renderizador *tela, FilaPecas *fila, PilhaReserva *pilha, Tabuleiro *tabuleiro) {
+    escreverQuadro(tela, "\n========================================\n");
+    escreverQuadro(tela, "ESTADO ATUAL\n");
+    escreverQuadro(tela, "========================================\n");
+    
+    if (tabuleiro != NULL) {
+        exibirTabuleiro(tela, tabuleiro);
+    }
     
     // Exibe a fila
-    printf("Fila de peças: ");
+    escreverQuadro(tela, "Fila de peças: ");
     if (filaVazia(fila)) {
-        printf("[VAZIA]");
+        escreverQuadro(tela, "[VAZIA]");
     } else {
         int indice = fila->frente;
         for (int i = 0; i < fila->tamanho; i++) {
-            printf("[%c %d] ", fila->pecas[indice].nome, fila->pecas[indice].id);
-            indice = (indice + 1) % TAMANHO_FILA;
+            escreverQuadro(tela, FORMATO_PECA " ", ARGS_PECA(fila->pecas[indice]));
+            indice = (indice + 1) & fila->mascara;
         }
     }
-    printf("\n");
+    escreverQuadro(tela, "\n");
     
     // Exibe a pilha (do topo para a base)
-    printf("Pilha de reserva (Topo -> Base): ");
+    escreverQuadro(tela, "Pilha de reserva (Topo -> Base): ");
     if (pilhaVazia(pilha)) {
-        printf("[VAZIA]");
+        escreverQuadro(tela, "[VAZIA]");
     } else {
-        for (int i = pilha->topo; i >= 0; i--) {
-            printf("[%c %d] ", pilha->pecas[i].nome, pilha->pecas[i].id);
+        // Pilhas grandes (--pilha) mostram só as peças perto do topo
+        int base = pilha->topo >= MAX_PILHA_EXIBIDA ? pilha->topo - MAX_PILHA_EXIBIDA + 1 : 0;
+        for (int i = pilha->topo; i >= base; i--) {
+            escreverQuadro(tela, FORMATO_PECA " ", ARGS_PECA(pilha->pecas[i]));
+        }
+        if (base > 0) {
+            escreverQuadro(tela, "... (+%d)", base);
         }
     }
-    printf("\n========================================\n");
+    escreverQuadro(tela, "\n========================================\n");
+}
+
+/**
+ * Escreve no quadro o menu de opções
+ * @param pecasTroca - Peças trocadas pela opção 5
+ */
+void exibirMenu(Renderizador *tela, int pecasTroca) {
+    // Espaços até a borda: o texto com k de um dígito deixa 3
+    int margem = 4 - snprintf(NULL, 0, "%d", pecasTroca);
+    
+    escreverQuadro(tela, "\n┌──────────────────────────────────────────────┐\n");
+    escreverQuadro(tela, "│          TETRIS STACK - MENU AVANÇADO       │\n");
+    escreverQuadro(tela, "├──────────────────────────────────────────────┤\n");
+    escreverQuadro(tela, "│ 1 - Jogar peça da frente da fila            │\n");
+    escreverQuadro(tela, "│ 2 - Enviar peça da fila para pilha          │\n");
+    escreverQuadro(tela, "│ 3 - Usar peça da pilha de reserva           │\n");
+    escreverQuadro(tela, "│ 4 - Trocar frente da fila com topo da pilha │\n");
+    escreverQuadro(tela, "│ 5 - Troca múltipla (%d peças fila ↔ pilha)%*s│\n",
+                   pecasTroca, margem > 0 ? margem : 0, "");
+    escreverQuadro(tela, "│ 6 - Desfazer última ação                    │\n");
+    escreverQuadro(tela, "│ 7 - Refazer ação desfeita                   │\n");
+    escreverQuadro(tela, "│ 0 - Sair                                     │\n");
+    escreverQuadro(tela, "└──────────────────────────────────────────────┘\n");
+    escreverQuadro(tela, "Escolha uma opção: ");
+}
+
+// ---------------------------------------------------------------------------
+// Métricas do modo interativo e do servidor: contadores e histogramas de
+// latência de cada operação do menu, da montagem da tela e do quadro inteiro
+// (da leitura da opção até o quadro enviado); no servidor, também de cada
+// comando e do atendimento de cada leitura de um cliente.
+//
+// Os histogramas seguem a ideia do HDR: cada potência de 2 (em ns) é dividida
+// em SUBFAIXAS_HISTOGRAMA faixas iguais, então o erro relativo de qualquer
+// percentil fica abaixo de 1/32 (~3%) de 1 ns a dezenas de minutos, com um
+// array fixo e registro em O(1) (um clz e um incremento).
+//
+// Desligadas (sem --metricas), cada ponto de medição custa só o teste de um
+// ponteiro global nulo. O relatório é gravado no fim da partida e a cada
+// SIGUSR1 (kill -USR1 <pid>); no servidor, no encerramento e a cada SIGUSR1.
+// ---------------------------------------------------------------------------
+
+#define BITS_SUBFAIXA_HISTOGRAMA 5
+#define SUBFAIXAS_HISTOGRAMA (1 << BITS_SUBFAIXA_HISTOGRAMA)
+#define EXPOENTE_MAXIMO_HISTOGRAMA 42                  // Até 2^42 ns (~73 min)
+#define FAIXAS_HISTOGRAMA ((EXPOENTE_MAXIMO_HISTOGRAMA - BITS_SUBFAIXA_HISTOGRAMA + 2) * SUBFAIXAS_HISTOGRAMA)
+
+// O que é medido; as ações 1-7 do menu usam o próprio código como índice
+typedef enum {
+    METRICA_EXIBIR_ESTADO = 0,
+    METRICA_JOGAR = 1,
+    METRICA_RESERVAR = 2,
+    METRICA_USAR = 3,
+    METRICA_TROCAR = 4,
+    METRICA_MULTIPLA = 5,
+    METRICA_DESFAZER = 6,
+    METRICA_REFAZER = 7,
+    METRICA_EXIBIR_MENU,
+    METRICA_QUADRO,          // Da opção lida até o quadro enviado
+    METRICA_ATENDIMENTO,     // Servidor: dos bytes recebidos de um cliente às respostas prontas
+    NUM_METRICAS
+} TipoMetrica;
+
+static const char *NOMES_METRICAS[NUM_METRICAS] = {
+    "exibirEstado", "jogarPeca", "enviarParaPilha", "usarPecaDaPilha", "trocarPecaAtual",
+    "trocarMultipla", "desfazer", "refazer", "exibirMenu", "quadro", "atendimento"
+};
+
+// Contadores e histograma de uma métrica
+typedef struct {
+    uint64_t quantidade;
+    uint64_t falhas;                       // Operações que não tiveram sucesso
+    uint64_t somaNs;
+    uint64_t minimoNs;
+    uint64_t maximoNs;
+    uint32_t faixas[FAIXAS_HISTOGRAMA];
+} Histograma;
+
+typedef struct {
+    Histograma histogramas[NUM_METRICAS];
+    const char *caminho;                   // Arquivo do relatório
+} Metricas;
+
+static Metricas *metricasAtivas = NULL;
+static volatile sig_atomic_t relatorioPedido = 0;
+
+/**
+ * Retorna o tempo monotônico atual em nanossegundos
+ */
+static inline uint64_t relogioNs(void) {
+    struct timespec agora;
+    clock_gettime(CLOCK_MONOTONIC, &agora);
+    return (uint64_t)agora.tv_sec * 1000000000ULL + (uint64_t)agora.tv_nsec;
 }
 
 /**
- * Exibe o menu de opções
+ * Faixa do histograma onde cai um valor: abaixo de SUBFAIXAS_HISTOGRAMA a
+ * faixa é exata; acima, os BITS_SUBFAIXA_HISTOGRAMA bits depois do mais
+ * significativo escolhem a faixa dentro da potência de 2
  */
-void exibirMenu() {
-    printf("\n┌──────────────────────────────────────────────┐\n");
-    printf("│          TETRIS STACK - MENU AVANÇADO       │\n");
-    printf("├──────────────────────────────────────────────┤\n");
-    printf("│ 1 - Jogar peça da frente da fila            │\n");
-    printf("│ 2 - Enviar peça da fila para pilha          │\n");
-    printf("│ 3 - Usar peça da pilha de reserva           │\n");
-    printf("│ 4 - Trocar frente da fila com topo da pilha │\n");
-    printf("│ 5 - Troca múltipla (3 peças fila ↔ pilha)   │\n");
-    printf("│ 0 - Sair                                     │\n");
-    printf("└──────────────────────────────────────────────┘\n");
-    printf("Escolha uma opção: ");
+static inline int faixaHistograma(uint64_t valor) {
+    if (valor < SUBFAIXAS_HISTOGRAMA) {
+        return (int)valor;
+    }
+    int expoente = 63 - __builtin_clzll(valor);
+    if (expoente > EXPOENTE_MAXIMO_HISTOGRAMA) {
+        return FAIXAS_HISTOGRAMA - 1;
+    }
+    int deslocamento = expoente - BITS_SUBFAIXA_HISTOGRAMA;
+    return (deslocamento + 1) * SUBFAIXAS_HISTOGRAMA + (int)(valor >> deslocamento) - SUBFAIXAS_HISTOGRAMA;
 }
 
 /**
- * Função principal do programa
+ * Maior valor que cai na faixa (inverso de faixaHistograma)
  */
-int main() {
-    FilaPecas fila;
-    PilhaReserva pilha;
-    int opcao;
+static uint64_t limiteFaixaHistograma(int faixa) {
+    if (faixa < SUBFAIXAS_HISTOGRAMA) {
+        return (uint64_t)faixa;
+    }
+    int deslocamento = faixa / SUBFAIXAS_HISTOGRAMA - 1;
+    uint64_t inicio = (uint64_t)(SUBFAIXAS_HISTOGRAMA + faixa % SUBFAIXAS_HISTOGRAMA) << deslocamento;
+    return inicio + (1ULL << deslocamento) - 1;
+}
+
+/**
+ * Marca o início de uma medição
+ * @return uint64_t - Instante atual, ou 0 com as métricas desligadas
+ */
+static inline uint64_t iniciarMedicao(void) {
+    return metricasAtivas != NULL ? relogioNs() : 0;
+}
+
+/**
+ * Registra a duração desde 'inicio' na métrica
+ * @param falhou - 1 se a operação não teve sucesso
+ */
+static inline void concluirMedicao(TipoMetrica metrica, uint64_t inicio, int falhou) {
+    if (metricasAtivas == NULL) {
+        return;
+    }
+    uint64_t duracao = relogioNs() - inicio;
+    Histograma *h = &metricasAtivas->histogramas[metrica];
     
-    // Inicializa gerador de números aleatórios
-    srand(time(NULL));
+    h->quantidade++;
+    h->falhas += (uint64_t)falhou;
+    h->somaNs += duracao;
+    if (duracao < h->minimoNs) {
+        h->minimoNs = duracao;
+    }
+    if (duracao > h->maximoNs) {
+        h->maximoNs = duracao;
+    }
+    h->faixas[faixaHistograma(duracao)]++;
+}
+
+/**
+ * Valor abaixo do qual está a fração 'percentil' das medições (0 a 1).
+ * Retorna o limite superior da faixa, sem passar do máximo observado.
+ */
+static uint64_t percentilHistograma(const Histograma *h, double percentil) {
+    uint64_t alvo = (uint64_t)(percentil * (double)h->quantidade + 0.5);
+    uint64_t acumulado = 0;
     
-    // Inicializa a fila com peças e a pilha vazia
-    inicializarFila(&fila);
-    inicializarPilha(&pilha);
+    if (alvo < 1) {
+        alvo = 1;
+    }
+    for (int i = 0; i < FAIXAS_HISTOGRAMA; i++) {
+        acumulado += h->faixas[i];
+        if (acumulado >= alvo) {
+            uint64_t limite = limiteFaixaHistograma(i);
+            return limite < h->maximoNs ? limite : h->maximoNs;
+        }
+    }
+    return h->maximoNs;
+}
+
+/**
+ * Grava o relatório de todas as métricas medidas, uma por linha
+ * @return int - 1 em caso de sucesso
+ */
+static int gravarRelatorioMetricas(const Metricas *metricas) {
+    FILE *arquivo = fopen(metricas->caminho, "w");
+    if (arquivo == NULL) {
+        return 0;
+    }
     
-    printf("╔══════════════════════════════════════════════╗\n");
-    printf("║      BEM-VINDO AO TETRIS STACK!             ║\n");
-    printf("║      Sistema Avançado de Gerenciamento      ║\n");
-    printf("║      Fila Circular + Pilha de Reserva       ║\n");
-    printf("╚══════════════════════════════════════════════╝\n");
+    fprintf(arquivo, "metrica,quantidade,falhas,media_ns,min_ns,p50_ns,p90_ns,p99_ns,p999_ns,max_ns\n");
+    for (int m = 0; m < NUM_METRICAS; m++) {
+        const Histograma *h = &metricas->histogramas[m];
+        if (h->quantidade == 0) {
+            continue;
+        }
+        fprintf(arquivo, "%s,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n", NOMES_METRICAS[m],
+                (unsigned long long)h->quantidade, (unsigned long long)h->falhas,
+                (unsigned long long)(h->somaNs / h->quantidade), (unsigned long long)h->minimoNs,
+                (unsigned long long)percentilHistograma(h, 0.50),
+                (unsigned long long)percentilHistograma(h, 0.90),
+                (unsigned long long)percentilHistograma(h, 0.99),
+                (unsigned long long)percentilHistograma(h, 0.999),
+                (unsigned long long)h->maximoNs);
+    }
+    return fclose(arquivo) == 0;
+}
+
+/**
+ * Pede o relatório; ele é gravado pelo loop principal, fora do sinal
+ */
+static void tratarPedidoRelatorio(int sinal) {
+    (void)sinal;
+    relatorioPedido = 1;
+}
+
+/**
+ * Liga as métricas e o relatório por SIGUSR1
+ * @param caminho - Arquivo onde o relatório é gravado
+ * @return int - 1 em caso de sucesso
+ */
+int ativarMetricas(const char *caminho) {
+    Metricas *metricas = calloc(1, sizeof(Metricas));
+    if (metricas == NULL) {
+        return 0;
+    }
+    for (int m = 0; m < NUM_METRICAS; m++) {
+        metricas->histogramas[m].minimoNs = UINT64_MAX;
+    }
+    metricas->caminho = caminho;
     
-    // Exibe estado inicial
-    exibirEstado(&fila, &pilha);
+    // Sem SA_RESTART: o sinal interrompe a leitura da opção e o relatório
+    // sai na hora, mesmo com o jogador parado no menu
+    struct sigaction acao;
+    memset(&acao, 0, sizeof(acao));
+    acao.sa_handler = tratarPedidoRelatorio;
+    sigemptyset(&acao.sa_mask);
+    sigaction(SIGUSR1, &acao, NULL);
     
-    // Loop principal do programa
-    do {
-        exibirMenu();
-        scanf("%d", &opcao);
-        
-        switch(opcao) {
-            case 1:
-                // Jogar peça (remover da fila e adicionar nova)
-                jogarPeca(&fila);
-                exibirEstado(&fila, &pilha);
-                break;
-                
-            case 2:
-                // Enviar peça da fila para a pilha
-                enviarParaPilha(&fila, &pilha);
-                exibirEstado(&fila, &pilha);
-                break;
-                
-            case 3:
-                // Usar peça da pilha de reserva
-                usarPecaDaPilha(&pilha);
-                exibirEstado(&fila, &pilha);
-                break;
-                
-            case 4:
-                // Trocar peça da frente da fila com o topo da pilha
-                trocarPecaAtual(&fila, &pilha);
-                exibirEstado(&fila, &pilha);
-                break;
-                
-            case 5:
-                // Troca múltipla: 3 peças da fila com 3 da pilha
-                trocarMultipla(&fila, &pilha);
-                exibirEstado(&fila, &pilha);
-                break;
-                
-            case 0:
-                // Sair do programa
-                printf("\n👋 Obrigado por jogar Tetris Stack!\n");
-                printf("🎮 Desenvolvido pela ByteBros.\n\n");
-                break;
-                
-            default:
-                printf("\n❌ Opção inválida! Tente novamente.\n");
+    metricasAtivas = metricas;
+    return 1;
+}
+
+/**
+ * Grava o relatório final e desliga as métricas
+ * @return int - 1 em caso de sucesso (ou se estavam desligadas)
+ */
+int encerrarMetricas(void) {
+    if (metricasAtivas == NULL) {
+        return 1;
+    }
+    int ok = gravarRelatorioMetricas(metricasAtivas);
+    signal(SIGUSR1, SIG_DFL);
+    free(metricasAtivas);
+    metricasAtivas = NULL;
+    return ok;
+}
+
+/**
+ * Grava o relatório se um SIGUSR1 o pediu desde a última chamada. Chamada
+ * pelos loops que esperam (a leitura do menu e os loops do servidor), que o
+ * sinal interrompe.
+ */
+static void atenderPedidoRelatorio(void) {
+    if (relatorioPedido && metricasAtivas != NULL) {
+        relatorioPedido = 0;
+        gravarRelatorioMetricas(metricasAtivas);
+    }
+}
+
+/**
+ * Lê o que houver na entrada padrão. Um SIGUSR1 durante a espera grava o
+ * relatório e a leitura continua.
+ * @return size_t - Bytes lidos, 0 no fim da entrada
+ */
+static size_t lerEntrada(char *buffer, size_t tamanho) {
+    for (;;) {
+        atenderPedidoRelatorio();
+        ssize_t lidos = read(STDIN_FILENO, buffer, tamanho);
+        if (lidos >= 0) {
+            return (size_t)lidos;
         }
-        
-    } while(opcao != 0);
+        if (errno != EINTR) {
+            return 0;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Registro binário de eventos e replay determinístico.
+//
+// Formato (inteiros em little-endian):
+//   cabeçalho (36 bytes): "TETRISLG", versão (u32), limite da fila (u32),
+//     capacidade da pilha (u32), modo do gerador (u8), largura e altura do
+//     tabuleiro (u8 cada, 0 = sem tabuleiro), reservado (u8), semente (u64),
+//     peças trocadas pela ação 5 (u32)
+//   um evento por ação: 1 byte com a ação (bits 0-2; 6 = código inválido) e
+//     o resultado (bits 3-6), seguido, nas ações com sucesso, do id da peça
+//     resultante em varint: 1 e 2 gravam a diferença para o id da última
+//     peça nova (quase sempre 1), 3 grava proximoId - id da peça usada
+//   fim: MARCA_FIM_REGISTRO e o rodapé (ações, hash, resumo da fila e da
+//     pilha, resumo do tabuleiro, tamanho da fila, topo, proximoId)
+//
+// Como o gerador é determinístico, a semente e os códigos de ação bastam
+// para refazer a partida; os ids servem para conferir cada passo.
+// ---------------------------------------------------------------------------
+
+#define MAGICO_REGISTRO "TETRISLG"
+#define VERSAO_REGISTRO 2
+#define TAMANHO_CABECALHO_REGISTRO 36
+#define TAMANHO_RODAPE_REGISTRO 52
+#define MARCA_FIM_REGISTRO 0xFF
+#define ACAO_REGISTRO_INVALIDA 6
+#define TAMANHO_BUFFER_REGISTRO (1 << 16)
+#define MAX_EVENTO_REGISTRO 11   // 1 byte de ação + varint de até 10 bytes
+
+// Gravador do registro de uma partida
+typedef struct {
+    FILE *arquivo;
+    uint8_t buffer[TAMANHO_BUFFER_REGISTRO];
+    size_t usado;
+    long long acoes;           // Eventos gravados
+    IdPeca ultimoIdNovo;       // Id da última peça que entrou na fila
+    int falhou;                // 1 se alguma escrita falhou
+} RegistroEventos;
+
+/**
+ * Grava um inteiro de 'bytes' bytes em little-endian
+ */
+static inline uint8_t *escreverLE(uint8_t *destino, uint64_t valor, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        destino[i] = (uint8_t)(valor >> (8 * i));
+    }
+    return destino + bytes;
+}
+
+/**
+ * Lê um inteiro de 'bytes' bytes em little-endian
+ */
+static inline uint64_t lerLE(const uint8_t *origem, int bytes) {
+    uint64_t valor = 0;
+    for (int i = 0; i < bytes; i++) {
+        valor |= (uint64_t)origem[i] << (8 * i);
+    }
+    return valor;
+}
+
+/**
+ * Grava um inteiro em varint (7 bits por byte, bit alto = continua)
+ */
+static inline uint8_t *escreverVarint(uint8_t *destino, uint64_t valor) {
+    while (valor >= 0x80) {
+        *destino++ = (uint8_t)(valor | 0x80);
+        valor >>= 7;
+    }
+    *destino++ = (uint8_t)valor;
+    return destino;
+}
+
+/**
+ * Lê um varint sem passar de 'fim'
+ * @return const uint8_t* - Posição depois do varint, ou NULL se estiver truncado
+ */
+static inline const uint8_t *lerVarint(const uint8_t *origem, const uint8_t *fim, uint64_t *valor) {
+    uint64_t resultado = 0;
+    for (int deslocamento = 0; origem < fim && deslocamento < 64; deslocamento += 7) {
+        uint8_t byte = *origem++;
+        resultado |= (uint64_t)(byte & 0x7F) << deslocamento;
+        if (!(byte & 0x80)) {
+            *valor = resultado;
+            return origem;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Id da peça do topo da pilha, que a ação 3 vai usar (-1 se vazia)
+ */
+static inline IdPeca idDoTopo(const PilhaReserva *pilha) {
+    return pilha->topo >= 0 ? idPeca(pilha->pecas[pilha->topo]) : (IdPeca)-1;
+}
+
+/**
+ * Grava o conteúdo do buffer no arquivo
+ */
+void descarregarRegistro(RegistroEventos *registro) {
+    if (registro->usado > 0 &&
+        fwrite(registro->buffer, 1, registro->usado, registro->arquivo) != registro->usado) {
+        registro->falhou = 1;
+    }
+    registro->usado = 0;
+    fflush(registro->arquivo);
+}
+
+/**
+ * Cria o arquivo de registro e grava o cabeçalho
+ * @param config - Parâmetros da partida registrada
+ * @param fila - Fila recém-inicializada (dá o id da última peça inicial)
+ * @return int - 1 em caso de sucesso, 0 se o arquivo não pôde ser criado
+ */
+int abrirRegistro(RegistroEventos *registro, const char *caminho,
+                  const ConfiguracaoJogo *config, const FilaPecas *fila) {
+    registro->arquivo = fopen(caminho, "wb");
+    if (registro->arquivo == NULL) {
+        return 0;
+    }
+    
+    uint8_t *p = registro->buffer;
+    memcpy(p, MAGICO_REGISTRO, 8);
+    p = escreverLE(p + 8, VERSAO_REGISTRO, 4);
+    p = escreverLE(p, (uint64_t)config->limiteFila, 4);
+    p = escreverLE(p, (uint64_t)config->capacidadePilha, 4);
+    p = escreverLE(p, (uint64_t)config->modoGerador, 1);
+    p = escreverLE(p, (uint64_t)config->larguraTabuleiro, 1);
+    p = escreverLE(p, (uint64_t)config->alturaTabuleiro, 1);
+    p = escreverLE(p, 0, 1);
+    p = escreverLE(p, config->semente, 8);
+    p = escreverLE(p, (uint64_t)config->pecasTroca, 4);
+    
+    registro->usado = (size_t)(p - registro->buffer);
+    registro->acoes = 0;
+    registro->ultimoIdNovo = fila->proximoId - 1;
+    registro->falhou = 0;
+    return 1;
+}
+
+/**
+ * Grava o evento de uma ação já aplicada
+ * @param acao - Código lido (1 a 5; qualquer outro é gravado como inválido)
+ * @param resultado - Resultado da ação
+ * @param fila - Fila depois da ação
+ * @param idTopoAntes - idDoTopo(pilha) antes da ação (usado pela ação 3)
+ */
+void registrarEvento(RegistroEventos *registro, int acao, ResultadoOperacao resultado,
+                     const FilaPecas *fila, IdPeca idTopoAntes) {
+    if (registro->usado + MAX_EVENTO_REGISTRO > TAMANHO_BUFFER_REGISTRO) {
+        descarregarRegistro(registro);
+    }
+    
+    int codigo = (acao >= 1 && acao <= 5) ? acao : ACAO_REGISTRO_INVALIDA;
+    uint8_t *p = registro->buffer + registro->usado;
+    *p++ = (uint8_t)(codigo | (int)resultado << 3);
     
+    if (resultado == OP_SUCESSO && (codigo == 1 || codigo == 2)) {
+        IdPeca idNovo = fila->proximoId - 1;
+        p = escreverVarint(p, (uint64_t)(idNovo - registro->ultimoIdNovo));
+        registro->ultimoIdNovo = idNovo;
+    } else if (resultado == OP_SUCESSO && codigo == 3) {
+        p = escreverVarint(p, (uint64_t)(fila->proximoId - idTopoAntes));
+    }
+    
+    registro->usado = (size_t)(p - registro->buffer);
+    registro->acoes++;
+}
+
+/**
+ * Grava o rodapé com o estado final e fecha o arquivo
+ * @param tabuleiro - Tabuleiro da partida (pode ser NULL)
+ * @return int - 1 se todas as escritas deram certo
+ */
+int fecharRegistro(RegistroEventos *registro, FilaPecas *fila, PilhaReserva *pilha,
+                   const Tabuleiro *tabuleiro) {
+    if (registro->usado + 1 + TAMANHO_RODAPE_REGISTRO > TAMANHO_BUFFER_REGISTRO) {
+        descarregarRegistro(registro);
+    }
+    
+    uint8_t *p = registro->buffer + registro->usado;
+    *p++ = MARCA_FIM_REGISTRO;
+    p = escreverLE(p, (uint64_t)registro->acoes, 8);
+    p = escreverLE(p, hashEstado(fila, pilha), 8);
+    p = escreverLE(p, calcularResumoEstado(fila, pilha), 8);
+    p = escreverLE(p, tabuleiro ? calcularResumoTabuleiro(tabuleiro) : 0, 8);
+    p = escreverLE(p, (uint64_t)fila->tamanho, 4);
+    p = escreverLE(p, (uint64_t)(int64_t)pilha->topo, 4);
+    p = escreverLE(p, (uint64_t)(int64_t)fila->proximoId, 8);
+    p = escreverLE(p, 0, 4);  // Reservado
+    registro->usado = (size_t)(p - registro->buffer);
+    
+    descarregarRegistro(registro);
+    if (fclose(registro->arquivo) != 0) {
+        registro->falhou = 1;
+    }
+    registro->arquivo = NULL;
+    return !registro->falhou;
+}
+
+/**
+ * Retorna o tempo monotônico atual em segundos
+ */
+double tempoAtual(void) {
+    struct timespec agora;
+    clock_gettime(CLOCK_MONOTONIC, &agora);
+    return agora.tv_sec + agora.tv_nsec / 1e9;
+}
+
+/**
+ * Lê o arquivo inteiro para a memória
+ * @return uint8_t* - Conteúdo (liberar com free), ou NULL em caso de erro
+ */
+static uint8_t *lerArquivoInteiro(const char *caminho, size_t *tamanho) {
+    FILE *arquivo = fopen(caminho, "rb");
+    if (arquivo == NULL) {
+        return NULL;
+    }
+    
+    uint8_t *dados = NULL;
+    long fim;
+    if (fseek(arquivo, 0, SEEK_END) == 0 && (fim = ftell(arquivo)) >= 0 &&
+        fseek(arquivo, 0, SEEK_SET) == 0) {
+        dados = malloc(fim > 0 ? (size_t)fim : 1);
+        if (dados != NULL && fread(dados, 1, (size_t)fim, arquivo) != (size_t)fim) {
+            free(dados);
+            dados = NULL;
+        }
+        *tamanho = (size_t)fim;
+    }
+    fclose(arquivo);
+    return dados;
+}
+
+// Partida reconstruída a partir de um registro
+typedef struct {
+    ConfiguracaoJogo config;
+    GeradorPecas gerador;
+    FilaPecas fila;
+    PilhaReserva pilha;
+    Arena arena;                 // De onde vem o array da pilha
+    Tabuleiro tabuleiro;
+    Tabuleiro *tabuleiroAtivo;   // NULL se a partida não tem tabuleiro
+    IdPeca ultimoIdNovo;         // Como em RegistroEventos
+    long long acoes;             // Eventos já refeitos
+} PartidaReplay;
+
+/**
+ * Lê a configuração do cabeçalho de um registro
+ * @return int - 1 se o cabeçalho é válido
+ */
+static int lerCabecalhoRegistro(const uint8_t *dados, size_t tamanho, ConfiguracaoJogo *config) {
+    if (tamanho < TAMANHO_CABECALHO_REGISTRO || memcmp(dados, MAGICO_REGISTRO, 8) != 0 ||
+        lerLE(dados + 8, 4) != VERSAO_REGISTRO) {
+        return 0;
+    }
+    
+    config->limiteFila = (int)lerLE(dados + 12, 4);
+    config->capacidadePilha = (int)lerLE(dados + 16, 4);
+    config->modoGerador = (ModoGerador)dados[20];
+    config->larguraTabuleiro = dados[21];
+    config->alturaTabuleiro = dados[22];
+    config->semente = lerLE(dados + 24, 8);
+    config->pecasTroca = (int)lerLE(dados + 32, 4);
+    return config->capacidadePilha >= 1 && config->capacidadePilha <= CAPACIDADE_MAXIMA_PILHA &&
+           config->modoGerador <= GERADOR_SACOLA_7 && dados[23] == 0 &&
+           config->pecasTroca >= 1 && config->pecasTroca <= CAPACIDADE_MAXIMA_PILHA;
+}
+
+/**
+ * Cria a partida no estado inicial descrito pela configuração
+ * @return int - 1 em caso de sucesso, 0 se a configuração for inválida ou faltar memória
+ */
+static int iniciarPartidaReplay(PartidaReplay *partida, const ConfiguracaoJogo *config) {
+    partida->config = *config;
+    inicializarArena(&partida->arena);
+    inicializarGerador(&partida->gerador, config->semente, config->modoGerador);
+    if (!inicializarPilhaNaArena(&partida->pilha, &partida->arena, config->capacidadePilha) ||
+        !inicializarFila(&partida->fila, config->limiteFila, &partida->gerador)) {
+        liberarArena(&partida->arena);
+        return 0;
+    }
+    partida->pilha.pecasTroca = config->pecasTroca;
+    
+    partida->tabuleiroAtivo = NULL;
+    if (config->larguraTabuleiro > 0) {
+        if (!inicializarTabuleiro(&partida->tabuleiro, config->larguraTabuleiro, config->alturaTabuleiro)) {
+            liberarFila(&partida->fila);
+            liberarArena(&partida->arena);
+            return 0;
+        }
+        partida->tabuleiroAtivo = &partida->tabuleiro;
+    }
+    
+    partida->ultimoIdNovo = partida->fila.proximoId - 1;
+    partida->acoes = 0;
+    return 1;
+}
+
+/**
+ * Libera a fila e a pilha da partida
+ */
+static void liberarPartidaReplay(PartidaReplay *partida) {
+    liberarFila(&partida->fila);
+    liberarArena(&partida->arena);
+}
+
+/**
+ * Refaz até 'maximo' eventos a partir de 'p', conferindo cada um. Para antes
+ * da marca de fim, no primeiro evento divergente ou ao chegar em 'maximo'.
+ * @param erro - Recebe a descrição da divergência (NULL se não houver)
+ * @return const uint8_t* - Posição do próximo evento (ou da marca de fim)
+ */
+static const uint8_t *refazerEventos(PartidaReplay *partida, const uint8_t *p, const uint8_t *fim,
+                                     long long maximo, const char **erro) {
+    FilaPecas *fila = &partida->fila;
+    PilhaReserva *pilha = &partida->pilha;
+    
+    *erro = NULL;
+    for (long long n = 0; n < maximo; n++) {
+        if (p >= fim) {
+            *erro = "registro sem rodapé (incompleto)";
+            return p;
+        }
+        if (*p == MARCA_FIM_REGISTRO) {
+            return p;
+        }
+        
+        uint8_t byte = *p++;
+        int codigo = byte & 7;
+        ResultadoOperacao esperado = (ResultadoOperacao)(byte >> 3);
+        IdPeca idTopoAntes = idDoTopo(pilha);
+        ResultadoOperacao resultado = aplicarAcao(fila, pilha, partida->tabuleiroAtivo,
+                                                  codigo == ACAO_REGISTRO_INVALIDA ? 0 : codigo);
+        uint64_t valor = 0;
+        
+        if (resultado != esperado) {
+            *erro = "resultado diferente do registrado";
+        } else if (resultado == OP_SUCESSO && (codigo == 1 || codigo == 2)) {
+            if ((p = lerVarint(p, fim, &valor)) == NULL) {
+                *erro = "evento truncado";
+            } else if (fila->proximoId - 1 != partida->ultimoIdNovo + (IdPeca)valor) {
+                *erro = "id da peça nova diferente do registrado";
+            }
+            partida->ultimoIdNovo = fila->proximoId - 1;
+        } else if (resultado == OP_SUCESSO && codigo == 3) {
+            if ((p = lerVarint(p, fim, &valor)) == NULL) {
+                *erro = "evento truncado";
+            } else if (fila->proximoId - idTopoAntes != (IdPeca)valor) {
+                *erro = "id da peça usada diferente do registrado";
+            }
+        }
+        if (*erro != NULL) {
+            return p;
+        }
+        partida->acoes++;
+    }
+    return p;
+}
+
+/**
+ * Confere o rodapé (que começa depois da marca de fim) com o estado da
+ * partida. O rodapé termina o registro: bytes a mais depois dele também
+ * são divergência.
+ * @return const char* - NULL se confere, senão a descrição da divergência
+ */
+static const char *conferirRodape(PartidaReplay *partida, const uint8_t *p, const uint8_t *fim) {
+    FilaPecas *fila = &partida->fila;
+    PilhaReserva *pilha = &partida->pilha;
+    
+    if ((size_t)(fim - p) < TAMANHO_RODAPE_REGISTRO) {
+        return "rodapé truncado";
+    }
+    if ((size_t)(fim - p) > TAMANHO_RODAPE_REGISTRO || lerLE(p + 48, 4) != 0) {
+        return "dados inesperados no rodapé";
+    }
+    if ((long long)lerLE(p, 8) != partida->acoes ||
+        lerLE(p + 8, 8) != hashEstado(fila, pilha) ||
+        lerLE(p + 16, 8) != calcularResumoEstado(fila, pilha) ||
+        lerLE(p + 24, 8) != (partida->tabuleiroAtivo ? calcularResumoTabuleiro(partida->tabuleiroAtivo) : 0) ||
+        (int)lerLE(p + 32, 4) != fila->tamanho ||
+        (int32_t)lerLE(p + 36, 4) != pilha->topo ||
+        lerLE(p + 40, 8) != (uint64_t)(int64_t)fila->proximoId) {
+        return "estado final diferente do registrado";
+    }
+    return NULL;
+}
+
+/**
+ * Refaz a partida de um registro sem nenhuma saída por ação, conferindo o
+ * resultado e os ids de cada evento e, no fim, o estado com o rodapé.
+ * Imprime uma única linha com o veredito.
+ * @return int - 0 se o replay confere com o registro, 1 caso contrário
+ */
+int executarReplay(const char *caminho) {
+    size_t tamanho = 0;
+    uint8_t *dados = lerArquivoInteiro(caminho, &tamanho);
+    ConfiguracaoJogo config;
+    PartidaReplay partida;
+    
+    if (dados == NULL) {
+        fprintf(stderr, "❌ Erro: não foi possível ler '%s'.\n", caminho);
+        return 1;
+    }
+    if (!lerCabecalhoRegistro(dados, tamanho, &config) || !iniciarPartidaReplay(&partida, &config)) {
+        fprintf(stderr, "❌ Erro: '%s' não é um registro válido da versão %d.\n", caminho, VERSAO_REGISTRO);
+        free(dados);
+        return 1;
+    }
+    
+    const uint8_t *fim = dados + tamanho;
+    const char *erro;
+    const uint8_t *p = refazerEventos(&partida, dados + TAMANHO_CABECALHO_REGISTRO, fim, LLONG_MAX, &erro);
+    if (erro == NULL) {
+        erro = conferirRodape(&partida, p + 1, fim);
+    }
+    
+    if (erro == NULL) {
+        printf("replay=ok acoes=%lld resumo=%016llx\n", partida.acoes,
+               (unsigned long long)calcularResumoEstado(&partida.fila, &partida.pilha));
+    } else {
+        printf("replay=falhou acao=%lld motivo=%s\n", partida.acoes + 1, erro);
+    }
+    
+    liberarPartidaReplay(&partida);
+    free(dados);
+    return erro == NULL ? 0 : 1;
+}
+
+// ---------------------------------------------------------------------------
+// Estado salvo: fotos binárias de layout fixo de uma partida ou de todas as
+// sessões de uma tabela, para reiniciar o processo sem perder as partidas.
+//
+// Formato (inteiros em little-endian):
+//   cabeçalho (64 bytes): "TETRISSV", versão (u32), tamanho de uma sessão
+//     (u32), sessões (u64), semente (u64), limite da fila (u32), capacidade
+//     da pilha (u32), modo do gerador (u8), largura e altura do tabuleiro
+//     (u8 cada, 0 = sem tabuleiro), reservado (u8), peças trocadas pela
+//     ação 5 (u32), soma de verificação (u64 na posição 48, ver
+//     somaArquivoEstado), zeros
+//   uma sessão após a outra, todas do mesmo tamanho (ver serializarSessao)
+//
+// Todo o arquivo é montado em um único buffer e gravado com uma só escrita
+// em um arquivo temporário, renomeado no fim: uma falha no meio nunca deixa
+// um estado salvo pela metade no lugar do anterior.
+// ---------------------------------------------------------------------------
+
+#define MAGICO_ESTADO_SALVO "TETRISSV"
+#define VERSAO_ESTADO_SALVO 3
+#define TAMANHO_CABECALHO_ESTADO 64
+#define POSICAO_SOMA_ESTADO 48
+#define TAMANHO_FIXO_SESSAO 160   // Campos de controle, hashes e gerador
+#define TAMANHO_TABULEIRO_SALVO (4 * (ALTURA_MAXIMA_TABULEIRO + LINHAS_EXTRAS_TABULEIRO) + 32)
+
+/**
+ * Peça em 64 bits independente do layout de Peca: id << 3 | tipo
+ */
+static inline uint64_t pecaParaU64(Peca peca) {
+    return (uint64_t)idPeca(peca) << BITS_TIPO_PECA | (uint64_t)tipoPeca(peca);
+}
+
+static inline Peca pecaDeU64(uint64_t valor) {
+    return criarPeca((int)(valor & ((1u << BITS_TIPO_PECA) - 1)), (IdPeca)(valor >> BITS_TIPO_PECA));
+}
+
+/**
+ * Tamanho de uma sessão salva (fixo para uma configuração)
+ */
+size_t tamanhoSessaoSalva(const ConfiguracaoJogo *config) {
+    return TAMANHO_FIXO_SESSAO
+         + 8 * (size_t)capacidadeFila(config->limiteFila)
+         + 8 * (size_t)config->capacidadePilha
+         + (config->larguraTabuleiro > 0 ? TAMANHO_TABULEIRO_SALVO : 0);
+}
+
+/**
+ * Grava uma sessão em 'destino' (tamanhoSessaoSalva bytes). O anel da fila
+ * vai inteiro, com frente e trás, para a restauração ser uma cópia direta.
+ * @param tabuleiro - Tabuleiro da sessão (NULL se a partida não tem tabuleiro)
+ */
+static void serializarSessao(uint8_t *destino, const FilaPecas *fila, const PilhaReserva *pilha,
+                             const Tabuleiro *tabuleiro) {
+    const GeradorPecas *gerador = fila->gerador;
+    uint8_t *p = destino;
+    
+    p = escreverLE(p, (uint64_t)fila->proximoId, 8);
+    p = escreverLE(p, (uint64_t)fila->frente, 4);
+    p = escreverLE(p, (uint64_t)fila->tras, 4);
+    p = escreverLE(p, (uint64_t)fila->tamanho, 4);
+    p = escreverLE(p, (uint32_t)pilha->topo, 4);
+    p = escreverLE(p, fila->hash, 8);
+    p = escreverLE(p, fila->potencia, 8);
+    p = escreverLE(p, pilha->hash, 8);
+    p = escreverLE(p, pilha->potencia, 8);
+    for (int i = 0; i < 4; i++) {
+        p = escreverLE(p, gerador->estado[i], 8);
+    }
+    p = escreverLE(p, gerador->leitura, 4);
+    p = escreverLE(p, gerador->escrita, 4);
+    memcpy(p, gerador->tipos, TAMANHO_BUFFER_TIPOS);
+    p += TAMANHO_BUFFER_TIPOS;
+    
+    // Posições livres do anel e da pilha vão zeradas (nunca foram escritas)
+    for (int i = 0; i <= fila->mascara; i++) {
+        int ocupada = ((i - fila->frente) & fila->mascara) < fila->tamanho;
+        p = escreverLE(p, ocupada ? pecaParaU64(fila->pecas[i]) : 0, 8);
+    }
+    for (int i = 0; i < pilha->capacidade; i++) {
+        p = escreverLE(p, i <= pilha->topo ? pecaParaU64(pilha->pecas[i]) : 0, 8);
+    }
+    
+    if (tabuleiro != NULL) {
+        for (int y = 0; y < ALTURA_MAXIMA_TABULEIRO + LINHAS_EXTRAS_TABULEIRO; y++) {
+            p = escreverLE(p, tabuleiro->linhas[y], 4);
+        }
+        p = escreverLE(p, (uint64_t)tabuleiro->alturaOcupada, 8);
+        p = escreverLE(p, (uint64_t)tabuleiro->pecasColocadas, 8);
+        p = escreverLE(p, (uint64_t)tabuleiro->linhasEliminadas, 8);
+        p = escreverLE(p, (uint64_t)tabuleiro->finsDeJogo, 8);
+    }
+}
+
+/**
+ * Restaura uma sessão gravada por serializarSessao e confere a consistência
+ * dos campos e dos hashes
+ * @param fila - Fila já inicializada com a configuração do arquivo (as peças e o gerador são sobrescritos)
+ * @param pilha - Pilha já inicializada com a mesma capacidade
+ * @param tabuleiro - Tabuleiro já inicializado com as dimensões do arquivo, ou NULL
+ * @return int - 1 se a sessão é válida
+ */
+static int desserializarSessao(const uint8_t *origem, FilaPecas *fila, PilhaReserva *pilha,
+                               Tabuleiro *tabuleiro) {
+    GeradorPecas *gerador = fila->gerador;
+    const uint8_t *p = origem;
+    
+    fila->proximoId = (IdPeca)lerLE(p, 8);
+    fila->frente = (int)lerLE(p + 8, 4);
+    fila->tras = (int)lerLE(p + 12, 4);
+    fila->tamanho = (int)lerLE(p + 16, 4);
+    int topo = (int32_t)lerLE(p + 20, 4);
+    fila->hash = lerLE(p + 24, 8);
+    fila->potencia = lerLE(p + 32, 8);
+    pilha->hash = lerLE(p + 40, 8);
+    pilha->potencia = lerLE(p + 48, 8);
+    for (int i = 0; i < 4; i++) {
+        gerador->estado[i] = lerLE(p + 56 + 8 * i, 8);
+    }
+    gerador->leitura = (uint32_t)lerLE(p + 88, 4);
+    gerador->escrita = (uint32_t)lerLE(p + 92, 4);
+    memcpy(gerador->tipos, p + 96, TAMANHO_BUFFER_TIPOS);
+    p += TAMANHO_FIXO_SESSAO;
+    
+    // Os campos vêm de u32: valores negativos também são recusados
+    if (fila->frente < 0 || fila->frente > fila->mascara ||
+        fila->tamanho < 0 || fila->tamanho > fila->limite ||
+        fila->tras != ((fila->frente + fila->tamanho) & fila->mascara) ||
+        topo < -1 || topo >= pilha->capacidade ||
+        gerador->escrita - gerador->leitura > TAMANHO_BUFFER_TIPOS) {
+        return 0;
+    }
+    
+    // As potências dos hashes são função dos tamanhos: não basta confiar nelas
+    uint64_t potencia = 1;
+    for (int i = 0; i < fila->tamanho; i++) {
+        potencia *= BASE_HASH_FILA;
+    }
+    if (fila->potencia != potencia) {
+        return 0;
+    }
+    potencia = 1;
+    for (int i = 0; i <= topo; i++) {
+        potencia *= BASE_HASH_PILHA;
+    }
+    if (pilha->potencia != potencia) {
+        return 0;
+    }
+    
+    pilha->topo = -1;                         // Nada a copiar se o array crescer
+    if (!reservarNaPilha(pilha, topo + 1)) {
+        return 0;
+    }
+    pilha->topo = topo;
+    
+    for (int i = 0; i <= fila->mascara; i++) {
+        if (((i - fila->frente) & fila->mascara) < fila->tamanho) {
+            fila->pecas[i] = pecaDeU64(lerLE(p, 8));
+        }
+        p += 8;
+    }
+    for (int i = 0; i < pilha->capacidade; i++) {
+        if (i <= pilha->topo) {
+            pilha->pecas[i] = pecaDeU64(lerLE(p, 8));
+        }
+        p += 8;
+    }
+    
+    if (tabuleiro != NULL) {
+        for (int y = 0; y < ALTURA_MAXIMA_TABULEIRO + LINHAS_EXTRAS_TABULEIRO; y++) {
+            tabuleiro->linhas[y] = (uint32_t)lerLE(p + 4 * y, 4) & tabuleiro->linhaCheia;
+        }
+        p += 4 * (ALTURA_MAXIMA_TABULEIRO + LINHAS_EXTRAS_TABULEIRO);
+        tabuleiro->alturaOcupada = (int)lerLE(p, 8);
+        tabuleiro->pecasColocadas = (long long)lerLE(p + 8, 8);
+        tabuleiro->linhasEliminadas = (long long)lerLE(p + 16, 8);
+        tabuleiro->finsDeJogo = (long long)lerLE(p + 24, 8);
+        if (tabuleiro->alturaOcupada < 0 || tabuleiro->alturaOcupada > tabuleiro->altura) {
+            return 0;
+        }
+    }
+    
+    // Os hashes guardados precisam bater com o conteúdo
+    return hashEstado(fila, pilha) == recalcularHashEstado(fila, pilha);
+}
+
+#define SOMA_INICIAL 0x84222325CBF29CE4ULL
+
+/**
+ * Continua uma soma de verificação sobre mais 'tamanho' bytes, palavra a
+ * palavra; uma sobra de menos de 8 bytes entra como uma palavra com o
+ * tamanho da sobra no byte alto
+ */
+static uint64_t continuarSoma(uint64_t soma, const uint8_t *dados, size_t tamanho) {
+    size_t i = 0;
+    for (; i + 8 <= tamanho; i += 8) {
+        soma = rotl64((soma ^ lerLE(dados + i, 8)) * 0x9E3779B97F4A7C15ULL, 31);
+    }
+    if (i < tamanho) {
+        uint64_t sobra = lerLE(dados + i, (int)(tamanho - i)) | (uint64_t)(tamanho - i) << 56;
+        soma = rotl64((soma ^ sobra) * 0x9E3779B97F4A7C15ULL, 31);
+    }
+    return soma;
+}
+
+/**
+ * Soma de verificação das sessões (o tamanho de uma sessão é múltiplo de 8)
+ */
+static uint64_t somaEstado(const uint8_t *dados, size_t tamanho) {
+    return continuarSoma(SOMA_INICIAL, dados, tamanho);
+}
+
+/**
+ * Soma de verificação de um estado salvo: o cabeçalho inteiro (menos o
+ * campo da própria soma) e as sessões
+ */
+static uint64_t somaArquivoEstado(const uint8_t *dados, size_t tamanho) {
+    uint64_t soma = continuarSoma(SOMA_INICIAL, dados, POSICAO_SOMA_ESTADO);
+    soma = continuarSoma(soma, dados + POSICAO_SOMA_ESTADO + 8,
+                         TAMANHO_CABECALHO_ESTADO - POSICAO_SOMA_ESTADO - 8);
+    return continuarSoma(soma, dados + TAMANHO_CABECALHO_ESTADO, tamanho - TAMANHO_CABECALHO_ESTADO);
+}
+
+/**
+ * Prepara o buffer de um estado salvo com o cabeçalho preenchido
+ * @return uint8_t* - Buffer com espaço para as sessões (liberar com free), ou NULL
+ */
+static uint8_t *criarBufferEstado(const ConfiguracaoJogo *config, uint64_t quantidade, size_t *tamanho) {
+    size_t tamanhoSessao = tamanhoSessaoSalva(config);
+    *tamanho = TAMANHO_CABECALHO_ESTADO + (size_t)quantidade * tamanhoSessao;
+    uint8_t *buffer = calloc(1, *tamanho);
+    if (buffer == NULL) {
+        return NULL;
+    }
+    
+    memcpy(buffer, MAGICO_ESTADO_SALVO, 8);
+    escreverLE(buffer + 8, VERSAO_ESTADO_SALVO, 4);
+    escreverLE(buffer + 12, tamanhoSessao, 4);
+    escreverLE(buffer + 16, quantidade, 8);
+    escreverLE(buffer + 24, config->semente, 8);
+    escreverLE(buffer + 32, (uint64_t)config->limiteFila, 4);
+    escreverLE(buffer + 36, (uint64_t)config->capacidadePilha, 4);
+    buffer[40] = (uint8_t)config->modoGerador;
+    buffer[41] = (uint8_t)config->larguraTabuleiro;
+    buffer[42] = (uint8_t)config->alturaTabuleiro;
+    escreverLE(buffer + 44, (uint64_t)config->pecasTroca, 4);
+    return buffer;
+}
+
+/**
+ * Grava o buffer inteiro em 'caminho' com uma só escrita, passando por um
+ * arquivo temporário
+ * @return int - 1 em caso de sucesso
+ */
+static int gravarBufferEstado(const char *caminho, const uint8_t *buffer, size_t tamanho) {
+    char temporario[4096];
+    if (snprintf(temporario, sizeof(temporario), "%s.tmp", caminho) >= (int)sizeof(temporario)) {
+        return 0;
+    }
+    
+    FILE *arquivo = fopen(temporario, "wb");
+    if (arquivo == NULL) {
+        return 0;
+    }
+    int ok = fwrite(buffer, 1, tamanho, arquivo) == tamanho;
+    if (fclose(arquivo) != 0) {
+        ok = 0;
+    }
+    if (!ok || rename(temporario, caminho) != 0) {
+        remove(temporario);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Lê e valida o cabeçalho de um estado salvo
+ * @return const char* - NULL se válido, senão a descrição do erro
+ */
+static const char *lerCabecalhoEstado(const uint8_t *dados, size_t tamanho, ConfiguracaoJogo *config,
+                                      uint64_t *quantidade) {
+    if (tamanho < TAMANHO_CABECALHO_ESTADO || memcmp(dados, MAGICO_ESTADO_SALVO, 8) != 0) {
+        return "não é um estado salvo";
+    }
+    if (lerLE(dados + 8, 4) != VERSAO_ESTADO_SALVO) {
+        return "versão do estado salvo não suportada";
+    }
+    
+    *quantidade = lerLE(dados + 16, 8);
+    config->semente = lerLE(dados + 24, 8);
+    config->limiteFila = (int)lerLE(dados + 32, 4);
+    config->capacidadePilha = (int)lerLE(dados + 36, 4);
+    config->modoGerador = (ModoGerador)dados[40];
+    config->larguraTabuleiro = dados[41];
+    config->alturaTabuleiro = dados[42];
+    config->pecasTroca = (int)lerLE(dados + 44, 4);
+    
+    if (config->limiteFila < 1 || config->limiteFila > TAMANHO_MAXIMO_FILA ||
+        config->capacidadePilha < 1 || config->capacidadePilha > CAPACIDADE_MAXIMA_PILHA ||
+        config->pecasTroca < 1 || config->pecasTroca > CAPACIDADE_MAXIMA_PILHA ||
+        config->modoGerador > GERADOR_SACOLA_7 || lerLE(dados + 12, 4) != tamanhoSessaoSalva(config)) {
+        return "configuração inválida no estado salvo";
+    }
+    if (*quantidade < 1 || *quantidade > INT_MAX ||
+        (tamanho - TAMANHO_CABECALHO_ESTADO) / tamanhoSessaoSalva(config) != *quantidade) {
+        return "estado salvo truncado";
+    }
+    if (lerLE(dados + POSICAO_SOMA_ESTADO, 8) != somaArquivoEstado(dados, tamanho)) {
+        return "estado salvo corrompido";
+    }
+    return NULL;
+}
+
+/**
+ * Salva a partida (fila, pilha, gerador e tabuleiro) em 'caminho'
+ * @param tabuleiro - Tabuleiro da partida (NULL se a partida não tem tabuleiro)
+ * @return int - 1 em caso de sucesso
+ */
+int salvarPartida(const char *caminho, const ConfiguracaoJogo *config, const FilaPecas *fila,
+                  const PilhaReserva *pilha, const Tabuleiro *tabuleiro) {
+    size_t tamanho;
+    uint8_t *buffer = criarBufferEstado(config, 1, &tamanho);
+    if (buffer == NULL) {
+        return 0;
+    }
+    
+    serializarSessao(buffer + TAMANHO_CABECALHO_ESTADO, fila, pilha, tabuleiro);
+    escreverLE(buffer + POSICAO_SOMA_ESTADO, somaArquivoEstado(buffer, tamanho), 8);
+    int ok = gravarBufferEstado(caminho, buffer, tamanho);
+    free(buffer);
+    return ok;
+}
+
+/**
+ * Restaura uma partida salva por salvarPartida. A configuração vem do
+ * arquivo; a fila é alocada aqui e a pilha sai da arena.
+ * @param config - Recebe a configuração da partida
+ * @param pilha - Recebe a pilha, com a capacidade gravada no arquivo
+ * @param arena - Arena de onde vem o array da pilha
+ * @param tabuleiro - Recebe o tabuleiro, se a partida tiver um
+ * @return const char* - NULL em caso de sucesso, senão a descrição do erro
+ */
+const char *restaurarPartida(const char *caminho, ConfiguracaoJogo *config, GeradorPecas *gerador,
+                             FilaPecas *fila, PilhaReserva *pilha, Arena *arena, Tabuleiro *tabuleiro) {
+    size_t tamanho = 0;
+    uint64_t quantidade;
+    uint8_t *dados = lerArquivoInteiro(caminho, &tamanho);
+    if (dados == NULL) {
+        return "não foi possível ler o arquivo";
+    }
+    
+    const char *erro = lerCabecalhoEstado(dados, tamanho, config, &quantidade);
+    if (erro == NULL && quantidade != 1) {
+        erro = "o estado salvo não é de uma partida única";
+    }
+    if (erro == NULL && !inicializarPilhaNaArena(pilha, arena, config->capacidadePilha)) {
+        erro = "memória insuficiente para a pilha";
+    } else if (erro == NULL) {
+        pilha->pecasTroca = config->pecasTroca;
+    }
+    if (erro == NULL && config->larguraTabuleiro > 0 &&
+        !inicializarTabuleiro(tabuleiro, config->larguraTabuleiro, config->alturaTabuleiro)) {
+        erro = "configuração inválida no estado salvo";
+    }
+    if (erro == NULL) {
+        inicializarGerador(gerador, config->semente, config->modoGerador);
+        if (!inicializarFila(fila, config->limiteFila, gerador)) {
+            erro = "memória insuficiente para a fila";
+        } else if (!desserializarSessao(dados + TAMANHO_CABECALHO_ESTADO, fila, pilha,
+                                        config->larguraTabuleiro > 0 ? tabuleiro : NULL)) {
+            liberarFila(fila);
+            erro = "estado salvo corrompido";
+        }
+    }
+    
+    free(dados);
+    return erro;
+}
+
+/**
+ * Salva todas as sessões da tabela com uma única escrita
+ * @return int - 1 em caso de sucesso
+ */
+int salvarTabelaSessoes(TabelaSessoes *tabela, const ConfiguracaoJogo *config, const char *caminho) {
+    size_t tamanho;
+    size_t tamanhoSessao = tamanhoSessaoSalva(config);
+    uint8_t *buffer = criarBufferEstado(config, (uint64_t)tabela->quantidade, &tamanho);
+    if (buffer == NULL) {
+        return 0;
+    }
+    
+    for (int i = 0; i < tabela->quantidade; i++) {
+        FilaPecas fila;
+        PilhaReserva pilha;
+        carregarSessao(tabela, i, &fila, &pilha);
+        serializarSessao(buffer + TAMANHO_CABECALHO_ESTADO + (size_t)i * tamanhoSessao,
+                         &fila, &pilha, tabuleiroDaSessao(tabela, i));
+    }
+    
+    escreverLE(buffer + POSICAO_SOMA_ESTADO, somaArquivoEstado(buffer, tamanho), 8);
+    int ok = gravarBufferEstado(caminho, buffer, tamanho);
+    free(buffer);
+    return ok;
+}
+
+/**
+ * Cria a tabela a partir de um estado salvo por salvarTabelaSessoes
+ * @param config - Recebe a configuração das sessões
+ * @return const char* - NULL em caso de sucesso, senão a descrição do erro
+ */
+const char *restaurarTabelaSessoes(TabelaSessoes *tabela, ConfiguracaoJogo *config, const char *caminho) {
+    size_t tamanho = 0;
+    uint64_t quantidade;
+    uint8_t *dados = lerArquivoInteiro(caminho, &tamanho);
+    if (dados == NULL) {
+        return "não foi possível ler o arquivo";
+    }
+    
+    const char *erro = lerCabecalhoEstado(dados, tamanho, config, &quantidade);
+    if (erro == NULL && !criarTabelaSessoes(tabela, (int)quantidade, config)) {
+        erro = "não foi possível criar as sessões";
+    }
+    if (erro == NULL) {
+        size_t tamanhoSessao = tamanhoSessaoSalva(config);
+        for (int i = 0; i < tabela->quantidade && erro == NULL; i++) {
+            FilaPecas fila;
+            PilhaReserva pilha;
+            carregarSessao(tabela, i, &fila, &pilha);
+            if (!desserializarSessao(dados + TAMANHO_CABECALHO_ESTADO + (size_t)i * tamanhoSessao,
+                                     &fila, &pilha, tabuleiroDaSessao(tabela, i))) {
+                erro = "estado salvo corrompido";
+            }
+            guardarSessao(tabela, i, &fila, &pilha);
+        }
+        if (erro != NULL) {
+            liberarTabelaSessoes(tabela);
+        }
+    }
+    
+    free(dados);
+    return erro;
+}
+
+/**
+ * Cria a partida na configuração dada ou, com 'caminhoRestaurar', restaura
+ * a partida salva (a configuração passa a ser a do arquivo). Informa erros.
+ * @param arena - Arena de onde vem o array da pilha
+ * @param tabuleiroAtivo - Recebe 'tabuleiro' se a partida restaurada tiver tabuleiro
+ * @return int - 1 em caso de sucesso
+ */
+int prepararPartida(ConfiguracaoJogo *config, GeradorPecas *gerador, FilaPecas *fila, PilhaReserva *pilha,
+                    Arena *arena, Tabuleiro *tabuleiro, Tabuleiro **tabuleiroAtivo,
+                    const char *caminhoRestaurar) {
+    inicializarArena(arena);
+    
+    if (caminhoRestaurar == NULL) {
+        inicializarGerador(gerador, config->semente, config->modoGerador);
+        if (!inicializarPilhaNaArena(pilha, arena, config->capacidadePilha) ||
+            !inicializarFila(fila, config->limiteFila, gerador)) {
+            fprintf(stderr, "❌ Erro: memória insuficiente para a fila.\n");
+            liberarArena(arena);
+            return 0;
+        }
+        pilha->pecasTroca = config->pecasTroca;
+        return 1;
+    }
+    
+    const char *erro = restaurarPartida(caminhoRestaurar, config, gerador, fila, pilha, arena, tabuleiro);
+    if (erro != NULL) {
+        fprintf(stderr, "❌ Erro: '%s': %s.\n", caminhoRestaurar, erro);
+        liberarArena(arena);
+        return 0;
+    }
+    *tabuleiroAtivo = config->larguraTabuleiro > 0 ? tabuleiro : NULL;
+    fprintf(stderr, "✓ Partida restaurada de '%s'.\n", caminhoRestaurar);
+    return 1;
+}
+
+/**
+ * Cria a tabela com 'quantidade' sessões ou, com 'caminhoRestaurar',
+ * restaura as sessões salvas (a configuração passa a ser a do arquivo).
+ * Informa erros e o tempo da restauração.
+ * @return int - 1 em caso de sucesso
+ */
+int prepararTabela(TabelaSessoes *tabela, int quantidade, ConfiguracaoJogo *config,
+                   const char *caminhoRestaurar) {
+    if (caminhoRestaurar == NULL) {
+        if (!criarTabelaSessoes(tabela, quantidade, config)) {
+            fprintf(stderr, "❌ Erro: não foi possível criar %d sessões.\n", quantidade);
+            return 0;
+        }
+        return 1;
+    }
+    
+    double inicio = tempoAtual();
+    const char *erro = restaurarTabelaSessoes(tabela, config, caminhoRestaurar);
+    if (erro != NULL) {
+        fprintf(stderr, "❌ Erro: '%s': %s.\n", caminhoRestaurar, erro);
+        return 0;
+    }
+    fprintf(stderr, "✓ %d sessões restauradas de '%s' em %.1f ms.\n",
+            tabela->quantidade, caminhoRestaurar, (tempoAtual() - inicio) * 1e3);
+    return 1;
+}
+
+/**
+ * Salva a tabela em 'caminho' informando o resultado e o tempo
+ * @return int - 1 em caso de sucesso
+ */
+int salvarTabelaComAviso(TabelaSessoes *tabela, const ConfiguracaoJogo *config, const char *caminho) {
+    double inicio = tempoAtual();
+    if (!salvarTabelaSessoes(tabela, config, caminho)) {
+        fprintf(stderr, "❌ Erro: falha ao gravar '%s'.\n", caminho);
+        return 0;
+    }
+    fprintf(stderr, "✓ %d sessões salvas em '%s' em %.1f ms.\n",
+            tabela->quantidade, caminho, (tempoAtual() - inicio) * 1e3);
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// Arquivo de replay para acesso aleatório: os eventos de um registro, fotos
+// periódicas do estado e um índice ordenado pela ação de cada foto. O
+// arquivo é lido com mmap; buscar a ação N é uma busca binária no índice,
+// restaurar a foto anterior direto do mapa e refazer no máximo 'intervalo'
+// eventos, também lidos do mapa, sem cópia.
+//
+// Formato (inteiros em little-endian):
+//   cabeçalho (128 bytes): "TETRISAR", versão (u32), intervalo (u32),
+//     ações (u64), fotos (u64), início e tamanho dos eventos (u64 cada),
+//     início do índice (u64), início das fotos (u64), tamanho de uma foto
+//     (u64), cabeçalho do registro original (36 bytes), zeros, soma de
+//     verificação dos 120 bytes anteriores (u64)
+//   eventos: o registro original sem o cabeçalho (marca de fim e rodapé inclusos)
+//   fotos: todas do mesmo tamanho, alinhadas em 8 bytes: ação (u64),
+//     posição do próximo evento (u64), id da última peça nova (u64), soma
+//     de verificação (u64, ver somaFoto) e a partida no formato de uma
+//     sessão do estado salvo
+//   índice: por foto, a ação (u64) e a posição do próximo evento (u64)
+//
+// A soma de cada foto cobre a partida e os eventos até a próxima foto, que
+// é tudo o que uma busca a partir dela lê: o custo de conferir continua
+// proporcional ao intervalo, e não ao tamanho do arquivo.
+// ---------------------------------------------------------------------------
+
+#define MAGICO_ARQUIVO_REPLAY "TETRISAR"
+#define VERSAO_ARQUIVO_REPLAY 4
+#define TAMANHO_CABECALHO_ARQUIVO 128
+#define POSICAO_SOMA_ARQUIVO 120   // Soma de verificação do cabeçalho
+#define INTERVALO_FOTOS 65536   // Ações entre duas fotos, por padrão
+
+// Arquivo de replay mapeado na memória
+typedef struct {
+    const uint8_t *mapa;
+    size_t tamanho;
+    ConfiguracaoJogo config;
+    uint32_t intervalo;
+    uint64_t acoes;
+    uint64_t fotos;
+    const uint8_t *eventos;
+    size_t tamanhoEventos;
+    const uint8_t *indice;
+    const uint8_t *dadosFotos;
+    size_t tamanhoFoto;
+} ArquivoReplay;
+
+#define TAMANHO_PREFIXO_FOTO 32   // Ação, posição do próximo evento, última peça nova e soma
+
+/**
+ * Tamanho de uma foto para a configuração (fixo dentro de um arquivo): o
+ * prefixo e a partida no formato de uma sessão salva
+ */
+static size_t tamanhoFoto(const ConfiguracaoJogo *config) {
+    return TAMANHO_PREFIXO_FOTO + tamanhoSessaoSalva(config);
+}
+
+/**
+ * Soma de verificação de uma foto: a partida gravada nela e os eventos
+ * [inicioTrecho, fimTrecho) que uma busca a partir dela pode refazer
+ */
+static uint64_t somaFoto(const uint8_t *foto, const ConfiguracaoJogo *config, const uint8_t *eventos,
+                         uint64_t inicioTrecho, uint64_t fimTrecho) {
+    uint64_t soma = somaEstado(foto + TAMANHO_PREFIXO_FOTO, tamanhoSessaoSalva(config));
+    return continuarSoma(soma, eventos + inicioTrecho, (size_t)(fimTrecho - inicioTrecho));
+}
+
+/**
+ * Grava a foto do estado da partida em 'destino' (tamanhoFoto bytes). A
+ * soma de verificação é preenchida depois, quando o trecho de eventos da
+ * foto é conhecido.
+ * @param posicaoEvento - Posição, nos eventos, do próximo evento a refazer
+ */
+static void gravarFoto(uint8_t *destino, const PartidaReplay *partida, uint64_t posicaoEvento) {
+    uint8_t *p = destino;
+    p = escreverLE(p, (uint64_t)partida->acoes, 8);
+    p = escreverLE(p, posicaoEvento, 8);
+    p = escreverLE(p, (uint64_t)partida->ultimoIdNovo, 8);
+    p = escreverLE(p, 0, 8);
+    serializarSessao(p, &partida->fila, &partida->pilha, partida->tabuleiroAtivo);
+}
+
+/**
+ * Restaura a partida a partir de uma foto lida do mapa
+ * @param posicaoEvento - Recebe a posição, nos eventos, do próximo evento a refazer
+ * @return int - 1 se a foto é válida
+ */
+static int restaurarFoto(PartidaReplay *partida, const uint8_t *foto, uint64_t *posicaoEvento) {
+    partida->acoes = (long long)lerLE(foto, 8);
+    *posicaoEvento = lerLE(foto + 8, 8);
+    partida->ultimoIdNovo = (IdPeca)lerLE(foto + 16, 8);
+    return desserializarSessao(foto + TAMANHO_PREFIXO_FOTO, &partida->fila, &partida->pilha,
+                               partida->tabuleiroAtivo);
+}
+
+/**
+ * Cria um arquivo de replay a partir de um registro, refazendo a partida
+ * inteira e tirando uma foto a cada 'intervalo' ações (e uma na ação 0)
+ * @return int - Código de saída do programa
+ */
+int criarArquivoReplay(const char *caminhoRegistro, const char *caminhoArquivo, uint32_t intervalo) {
+    size_t tamanho = 0;
+    uint8_t *dados = lerArquivoInteiro(caminhoRegistro, &tamanho);
+    ConfiguracaoJogo config;
+    PartidaReplay partida;
+    
+    if (dados == NULL) {
+        fprintf(stderr, "❌ Erro: não foi possível ler '%s'.\n", caminhoRegistro);
+        return 1;
+    }
+    if (intervalo < 1 || !lerCabecalhoRegistro(dados, tamanho, &config) ||
+        !iniciarPartidaReplay(&partida, &config)) {
+        fprintf(stderr, "❌ Erro: '%s' não é um registro válido da versão %d.\n",
+                caminhoRegistro, VERSAO_REGISTRO);
+        free(dados);
+        return 1;
+    }
+    
+    const uint8_t *eventos = dados + TAMANHO_CABECALHO_REGISTRO;
+    const uint8_t *fim = dados + tamanho;
+    size_t bytesFoto = (tamanhoFoto(&config) + 7) & ~(size_t)7;
+    size_t capacidadeFotos = 16;
+    uint8_t *fotos = malloc(capacidadeFotos * bytesFoto);
+    uint8_t *indice = malloc(capacidadeFotos * 16);
+    uint64_t numFotos = 0;
+    const uint8_t *p = eventos;
+    const char *erro = NULL;
+    
+    // Foto, refaz 'intervalo' eventos, foto... até a marca de fim
+    while (fotos != NULL && indice != NULL) {
+        if (numFotos == capacidadeFotos) {
+            capacidadeFotos *= 2;
+            uint8_t *novasFotos = realloc(fotos, capacidadeFotos * bytesFoto);
+            uint8_t *novoIndice = novasFotos ? realloc(indice, capacidadeFotos * 16) : NULL;
+            if (novasFotos) fotos = novasFotos;
+            if (novoIndice) indice = novoIndice;
+            if (novasFotos == NULL || novoIndice == NULL) {
+                erro = "memória insuficiente";
+                break;
+            }
+        }
+        
+        memset(fotos + numFotos * bytesFoto, 0, bytesFoto);
+        gravarFoto(fotos + numFotos * bytesFoto, &partida, (uint64_t)(p - eventos));
+        escreverLE(indice + numFotos * 16, (uint64_t)partida.acoes, 8);
+        escreverLE(indice + numFotos * 16 + 8, (uint64_t)(p - eventos), 8);
+        numFotos++;
+        
+        p = refazerEventos(&partida, p, fim, intervalo, &erro);
+        if (erro != NULL || p >= fim || *p == MARCA_FIM_REGISTRO) {
+            break;
+        }
+    }
+    if (fotos == NULL || indice == NULL) {
+        erro = "memória insuficiente";
+    }
+    if (erro == NULL) {
+        erro = conferirRodape(&partida, p + 1, fim);
+    }
+    
+    if (erro == NULL) {
+        size_t tamanhoEventos = (size_t)(fim - eventos);
+        for (uint64_t i = 0; i < numFotos; i++) {
+            uint64_t fimTrecho = i + 1 < numFotos ? lerLE(indice + (i + 1) * 16 + 8, 8) : tamanhoEventos;
+            uint8_t *foto = fotos + i * bytesFoto;
+            escreverLE(foto + 24, somaFoto(foto, &config, eventos, lerLE(foto + 8, 8), fimTrecho), 8);
+        }
+        
+        uint64_t inicioEventos = TAMANHO_CABECALHO_ARQUIVO;
+        uint64_t inicioFotos = (inicioEventos + tamanhoEventos + 7) & ~(uint64_t)7;
+        uint64_t inicioIndice = inicioFotos + numFotos * bytesFoto;
+        uint8_t cabecalho[TAMANHO_CABECALHO_ARQUIVO] = {0};
+        uint8_t zeros[8] = {0};
+        
+        memcpy(cabecalho, MAGICO_ARQUIVO_REPLAY, 8);
+        escreverLE(cabecalho + 8, VERSAO_ARQUIVO_REPLAY, 4);
+        escreverLE(cabecalho + 12, intervalo, 4);
+        escreverLE(cabecalho + 16, (uint64_t)partida.acoes, 8);
+        escreverLE(cabecalho + 24, numFotos, 8);
+        escreverLE(cabecalho + 32, inicioEventos, 8);
+        escreverLE(cabecalho + 40, tamanhoEventos, 8);
+        escreverLE(cabecalho + 48, inicioIndice, 8);
+        escreverLE(cabecalho + 56, inicioFotos, 8);
+        escreverLE(cabecalho + 64, bytesFoto, 8);
+        memcpy(cabecalho + 72, dados, TAMANHO_CABECALHO_REGISTRO);
+        escreverLE(cabecalho + POSICAO_SOMA_ARQUIVO,
+                   continuarSoma(SOMA_INICIAL, cabecalho, POSICAO_SOMA_ARQUIVO), 8);
+        
+        FILE *arquivo = fopen(caminhoArquivo, "wb");
+        int ok = arquivo != NULL &&
+                 fwrite(cabecalho, 1, sizeof(cabecalho), arquivo) == sizeof(cabecalho) &&
+                 fwrite(eventos, 1, tamanhoEventos, arquivo) == tamanhoEventos &&
+                 fwrite(zeros, 1, inicioFotos - inicioEventos - tamanhoEventos, arquivo) ==
+                     inicioFotos - inicioEventos - tamanhoEventos &&
+                 fwrite(fotos, bytesFoto, numFotos, arquivo) == numFotos &&
+                 fwrite(indice, 16, numFotos, arquivo) == numFotos;
+        if (arquivo != NULL && fclose(arquivo) != 0) {
+            ok = 0;
+        }
+        if (!ok) {
+            erro = "falha ao gravar o arquivo";
+        }
+    }
+    
+    if (erro == NULL) {
+        printf("arquivo=ok acoes=%lld fotos=%llu\n", partida.acoes, (unsigned long long)numFotos);
+    } else {
+        fprintf(stderr, "❌ Erro: %s (ação %lld).\n", erro, partida.acoes + 1);
+    }
+    
+    free(fotos);
+    free(indice);
+    liberarPartidaReplay(&partida);
+    free(dados);
+    return erro == NULL ? 0 : 1;
+}
+
+/**
+ * Confere se 'quantidade' itens de 'tamanhoItem' bytes a partir de 'posicao'
+ * cabem em 'tamanho' bytes, sem estourar as contas (tamanhoItem > 0)
+ * @return int - 1 se couberem
+ */
+static int trechoCabe(uint64_t posicao, uint64_t quantidade, uint64_t tamanhoItem, uint64_t tamanho) {
+    return posicao <= tamanho && quantidade <= (tamanho - posicao) / tamanhoItem;
+}
+
+/**
+ * Confere o índice das fotos: a primeira é a da ação 0 e as ações não
+ * diminuem nem passam do fim da partida, como a busca binária supõe
+ * @return int - 1 se o índice for válido
+ */
+static int indiceOrdenado(const ArquivoReplay *arquivo) {
+    uint64_t anterior = 0;
+    for (uint64_t i = 0; i < arquivo->fotos; i++) {
+        uint64_t acao = lerLE(arquivo->indice + i * 16, 8);
+        if (acao < anterior || (i == 0 && acao != 0)) {
+            return 0;
+        }
+        anterior = acao;
+    }
+    return anterior <= arquivo->acoes;
+}
+
+/**
+ * Mapeia um arquivo de replay e valida o cabeçalho e o índice
+ * @return int - 1 em caso de sucesso
+ */
+int abrirArquivoReplay(ArquivoReplay *arquivo, const char *caminho) {
+    int descritor = open(caminho, O_RDONLY);
+    struct stat info;
+    
+    if (descritor < 0) {
+        return 0;
+    }
+    if (fstat(descritor, &info) != 0 || (size_t)info.st_size < TAMANHO_CABECALHO_ARQUIVO) {
+        close(descritor);
+        return 0;
+    }
+    
+    void *mapa = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, descritor, 0);
+    close(descritor);  // O mapa continua válido sem o descritor
+    if (mapa == MAP_FAILED) {
+        return 0;
+    }
+    
+    const uint8_t *m = mapa;
+    arquivo->mapa = m;
+    arquivo->tamanho = (size_t)info.st_size;
+    arquivo->intervalo = (uint32_t)lerLE(m + 12, 4);
+    arquivo->acoes = lerLE(m + 16, 8);
+    arquivo->fotos = lerLE(m + 24, 8);
+    uint64_t inicioEventos = lerLE(m + 32, 8);
+    arquivo->tamanhoEventos = lerLE(m + 40, 8);
+    uint64_t inicioIndice = lerLE(m + 48, 8);
+    uint64_t inicioFotos = lerLE(m + 56, 8);
+    arquivo->tamanhoFoto = lerLE(m + 64, 8);
+    
+    int valido = memcmp(m, MAGICO_ARQUIVO_REPLAY, 8) == 0 &&
+                 lerLE(m + 8, 4) == VERSAO_ARQUIVO_REPLAY &&
+                 lerLE(m + POSICAO_SOMA_ARQUIVO, 8) == continuarSoma(SOMA_INICIAL, m, POSICAO_SOMA_ARQUIVO) &&
+                 lerCabecalhoRegistro(m + 72, TAMANHO_CABECALHO_REGISTRO, &arquivo->config) &&
+                 arquivo->fotos > 0 &&
+                 arquivo->tamanhoFoto >= tamanhoFoto(&arquivo->config) &&
+                 trechoCabe(inicioEventos, arquivo->tamanhoEventos, 1, arquivo->tamanho) &&
+                 trechoCabe(inicioFotos, arquivo->fotos, arquivo->tamanhoFoto, arquivo->tamanho) &&
+                 trechoCabe(inicioIndice, arquivo->fotos, 16, arquivo->tamanho);
+    if (valido) {
+        arquivo->eventos = m + inicioEventos;
+        arquivo->indice = m + inicioIndice;
+        arquivo->dadosFotos = m + inicioFotos;
+        valido = indiceOrdenado(arquivo);
+    }
+    if (!valido) {
+        munmap(mapa, arquivo->tamanho);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Desfaz o mapeamento do arquivo
+ */
+void fecharArquivoReplay(ArquivoReplay *arquivo) {
+    munmap((void *)arquivo->mapa, arquivo->tamanho);
+    arquivo->mapa = NULL;
+}
+
+/**
+ * Leva a partida ao estado depois de 'acao' ações: busca binária no índice
+ * pela última foto com ação <= 'acao', restaura a foto e refaz o resto
+ * @param partida - Partida já iniciada com a configuração do arquivo
+ * @return const char* - NULL em caso de sucesso, senão a descrição do erro
+ */
+const char *posicionarReplay(const ArquivoReplay *arquivo, PartidaReplay *partida, uint64_t acao) {
+    if (acao > arquivo->acoes) {
+        return "ação além do fim da partida";
+    }
+    
+    uint64_t inicio = 0, fim = arquivo->fotos;  // Invariante: foto[inicio].acao <= acao
+    while (fim - inicio > 1) {
+        uint64_t meio = inicio + (fim - inicio) / 2;
+        if (lerLE(arquivo->indice + meio * 16, 8) <= acao) {
+            inicio = meio;
+        } else {
+            fim = meio;
+        }
+    }
+    
+    // A foto precisa bater com o índice e com a própria soma, que cobre os
+    // eventos até a próxima foto: a busca só lê esse trecho
+    const uint8_t *foto = arquivo->dadosFotos + inicio * arquivo->tamanhoFoto;
+    const uint8_t *entrada = arquivo->indice + inicio * 16;
+    uint64_t posicao = lerLE(entrada + 8, 8);
+    uint64_t fimTrecho = inicio + 1 < arquivo->fotos ? lerLE(entrada + 16 + 8, 8) : arquivo->tamanhoEventos;
+    if (lerLE(foto, 8) != lerLE(entrada, 8) || lerLE(foto + 8, 8) != posicao ||
+        posicao > fimTrecho || fimTrecho > arquivo->tamanhoEventos ||
+        lerLE(foto + 24, 8) != somaFoto(foto, &arquivo->config, arquivo->eventos, posicao, fimTrecho) ||
+        !restaurarFoto(partida, foto, &posicao) || (uint64_t)partida->acoes > acao) {
+        return "foto corrompida";
+    }
+    const char *erro;
+    refazerEventos(partida, arquivo->eventos + posicao, arquivo->eventos + fimTrecho,
+                   (long long)(acao - (uint64_t)partida->acoes), &erro);
+    return erro;
+}
+
+/**
+ * Modo de busca: mostra o estado depois da ação 'acao' de um arquivo de
+ * replay. O tempo da busca vai para stderr.
+ * @return int - Código de saída do programa
+ */
+int executarBuscaReplay(const char *caminho, uint64_t acao) {
+    ArquivoReplay arquivo;
+    PartidaReplay partida;
+    
+    if (!abrirArquivoReplay(&arquivo, caminho)) {
+        fprintf(stderr, "❌ Erro: '%s' não é um arquivo de replay válido.\n", caminho);
+        return 1;
+    }
+    if (!iniciarPartidaReplay(&partida, &arquivo.config)) {
+        fprintf(stderr, "❌ Erro: memória insuficiente para a partida.\n");
+        fecharArquivoReplay(&arquivo);
+        return 1;
+    }
+    
+    double inicio = tempoAtual();
+    const char *erro = posicionarReplay(&arquivo, &partida, acao);
+    double segundos = tempoAtual() - inicio;
+    
+    if (erro == NULL) {
+        FilaPecas *fila = &partida.fila;
+        printf("acao=%llu fila_tamanho=%d pilha_tamanho=%d proximo_id=%lld\n",
+               (unsigned long long)acao, fila->tamanho, partida.pilha.topo + 1,
+               (long long)fila->proximoId);
+        printf("fila=");
+        for (int i = 0; i < fila->tamanho && i < 16; i++) {
+            printf(FORMATO_PECA, ARGS_PECA(fila->pecas[(fila->frente + i) & fila->mascara]));
+        }
+        printf("%s\npilha=", fila->tamanho > 16 ? "..." : "");
+        for (int i = 0; i <= partida.pilha.topo; i++) {
+            printf(FORMATO_PECA, ARGS_PECA(partida.pilha.pecas[i]));
+        }
+        printf("\n");
+        if (partida.tabuleiroAtivo != NULL) {
+            printf("resumo_tabuleiro=%016llx\n",
+                   (unsigned long long)calcularResumoTabuleiro(partida.tabuleiroAtivo));
+        }
+        printf("hash=%016llx\n", (unsigned long long)hashEstado(fila, &partida.pilha));
+        fprintf(stderr, "busca_us=%.1f\n", segundos * 1e6);
+    } else {
+        fprintf(stderr, "❌ Erro: %s.\n", erro);
+    }
+    
+    liberarPartidaReplay(&partida);
+    fecharArquivoReplay(&arquivo);
+    return erro == NULL ? 0 : 1;
+}
+
+// Contadores do modo em lote, por código de ação
+typedef struct {
+    long long executadas[NUM_ACOES];  // Ações aplicadas com sucesso
+    long long falhas[NUM_ACOES];      // Ações recusadas (fila/pilha sem peças suficientes)
+    long long invalidas;              // Códigos fora do intervalo 1 a 5 (ou sessão inexistente)
+    long long total;                  // Total de comandos lidos
+} ContadoresLote;
+
+#define TAMANHO_BUFFER_LOTE (1 << 16)
+
+// Leitor de números de um fluxo de comandos, lido em blocos (sem scanf)
+typedef struct {
+    FILE *arquivo;
+    char buffer[TAMANHO_BUFFER_LOTE];
+    size_t posicao;   // Próximo byte a examinar em buffer
+    size_t lidos;     // Bytes válidos em buffer
+} LeitorComandos;
+
+/**
+ * Lê o próximo token do fluxo. Os tokens são separados por espaços em
+ * branco; um token que não é só de dígitos (por exemplo "-1", "-0", "+5",
+ * "1.5" ou "x") é lido inteiro e devolvido como -1, para contar como
+ * comando inválido em vez de virar outros comandos.
+ * @param valor - Recebe o número lido (satura em 1000000000) ou -1
+ * @return int - 1 se leu um token, 0 no fim do fluxo
+ */
+int lerNumero(LeitorComandos *leitor, long *valor) {
+    long numero = 0;
+    int lendoToken = 0;
+    int malformado = 0;
+    
+    for (;;) {
+        if (leitor->posicao == leitor->lidos) {
+            leitor->lidos = fread(leitor->buffer, 1, sizeof(leitor->buffer), leitor->arquivo);
+            leitor->posicao = 0;
+            if (leitor->lidos == 0) {
+                break;
+            }
+        }
+        
+        char c = leitor->buffer[leitor->posicao];
+        if (c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f') {
+            if (lendoToken) {
+                break;
+            }
+        } else if (c >= '0' && c <= '9') {
+            if (numero < 1000000000L) {
+                numero = numero * 10 + (c - '0');
+            }
+            lendoToken = 1;
+        } else {
+            malformado = 1;
+            lendoToken = 1;
+        }
+        leitor->posicao++;
+    }
+    
+    if (!lendoToken) {
+        return 0;
+    }
+    *valor = malformado ? -1 : numero;
+    return 1;
+}
+
+/**
+ * Registra o resultado de uma ação nos contadores do lote
+ */
+static void contabilizarAcao(ContadoresLote *contadores, int acao, ResultadoOperacao resultado) {
+    if (resultado == OP_OPCAO_INVALIDA) {
+        contadores->invalidas++;
+    } else if (resultado == OP_SUCESSO) {
+        contadores->executadas[acao]++;
+    } else {
+        contadores->falhas[acao]++;
+    }
+}
+
+/**
+ * Imprime os contadores do lote e o tempo gasto
+ */
+static void imprimirContadoresLote(ContadoresLote *contadores, double segundos) {
+    const char *nomes[NUM_ACOES] = {"sair", "jogar", "reservar", "usar", "trocar", "multipla"};
+    
+    printf("comandos=%lld invalidos=%lld\n", contadores->total, contadores->invalidas);
+    for (int acao = 1; acao < NUM_ACOES; acao++) {
+        printf("%s=%lld falhas_%s=%lld\n", nomes[acao], contadores->executadas[acao],
+               nomes[acao], contadores->falhas[acao]);
+    }
+    
+    // Tempo vai para stderr para não alterar a saída comparável entre execuções
+    if (segundos > 0) {
+        fprintf(stderr, "tempo=%.3fs acoes_por_segundo=%.0f\n",
+                segundos, contadores->total / segundos);
+    }
+}
+
+/**
+ * Modo em lote: lê um fluxo de comandos (mesmos códigos do menu, separados
+ * por espaços ou quebras de linha) e aplica todos sem exibir menu nem estado.
+ * O comando 0 encerra o fluxo, como no modo interativo.
+ * Ao final imprime apenas os contadores e o resumo do estado final.
+ * @param leitor - Leitor do fluxo de comandos
+ * @param tabuleiro - Tabuleiro da partida (pode ser NULL)
+ * @param registro - Registro de eventos aberto (NULL = não registra)
+ * @return int - Código de saída do programa
+ */
+int executarModoLote(LeitorComandos *leitor, FilaPecas *fila, PilhaReserva *pilha,
+                     Tabuleiro *tabuleiro, RegistroEventos *registro) {
+    ContadoresLote contadores;
+    memset(&contadores, 0, sizeof(contadores));
+    
+    clock_t inicio = clock();
+    long valor;
+    
+    while (lerNumero(leitor, &valor)) {
+        contadores.total++;
+        if (valor == 0) {
+            break;
+        }
+        int acao = (valor > 0 && valor < NUM_ACOES) ? (int)valor : 0;
+        if (registro != NULL) {
+            IdPeca idTopoAntes = idDoTopo(pilha);
+            ResultadoOperacao resultado = aplicarAcao(fila, pilha, tabuleiro, acao);
+            registrarEvento(registro, acao, resultado, fila, idTopoAntes);
+            contabilizarAcao(&contadores, acao, resultado);
+        } else {
+            contabilizarAcao(&contadores, acao, aplicarAcao(fila, pilha, tabuleiro, acao));
+        }
+    }
+    
+    imprimirContadoresLote(&contadores, (double)(clock() - inicio) / CLOCKS_PER_SEC);
+    printf("fila_tamanho=%d pilha_tamanho=%d proximo_id=%lld\n",
+           fila->tamanho, pilha->topo + 1, (long long)fila->proximoId);
+    if (tabuleiro != NULL) {
+        printf("pecas_colocadas=%lld linhas_eliminadas=%lld fins_de_jogo=%lld\n",
+               tabuleiro->pecasColocadas, tabuleiro->linhasEliminadas, tabuleiro->finsDeJogo);
+        printf("resumo_tabuleiro=%016llx\n", (unsigned long long)calcularResumoTabuleiro(tabuleiro));
+    }
+    printf("hash=%016llx\n", (unsigned long long)hashEstado(fila, pilha));
+    printf("resumo=%016llx\n", (unsigned long long)calcularResumoEstado(fila, pilha));
+    return 0;
+}
+
+/**
+ * Modo em lote com várias sessões: o fluxo traz pares "sessao acao"; uma
+ * sessão sem ação no fim do fluxo conta como comando inválido.
+ * Ao final imprime os contadores e um resumo que combina o resumo de
+ * cada sessão, na ordem dos índices.
+ * @param leitor - Leitor do fluxo de comandos
+ * @param tabela - Tabela de sessões já criada
+ * @return int - Código de saída do programa
+ */
+int executarModoLoteSessoes(LeitorComandos *leitor, TabelaSessoes *tabela) {
+    ContadoresLote contadores;
+    memset(&contadores, 0, sizeof(contadores));
+    
+    clock_t inicio = clock();
+    long sessao, valor;
+    
+    while (lerNumero(leitor, &sessao)) {
+        contadores.total++;
+        if (!lerNumero(leitor, &valor)) {
+            contadores.invalidas++;  // Sessão sem comando no fim da entrada
+            break;
+        }
+        if (valor == 0) {
+            break;
+        }
+        if (sessao < 0 || sessao >= tabela->quantidade) {
+            contadores.invalidas++;
+            continue;
+        }
+        int acao = (valor > 0 && valor < NUM_ACOES) ? (int)valor : 0;
+        contabilizarAcao(&contadores, acao, aplicarAcaoSessao(tabela, (int)sessao, acao));
+    }
+    
+    imprimirContadoresLote(&contadores, (double)(clock() - inicio) / CLOCKS_PER_SEC);
+    printf("sessoes=%d\n", tabela->quantidade);
+    printf("resumo=%016llx\n", (unsigned long long)calcularResumoTabela(tabela));
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Simulação paralela: as sessões da tabela são divididas em faixas, uma por
+// thread. Cada thread consome a própria faixa em lotes pequenos e, quando ela
+// acaba, rouba metade do que resta na faixa de outra thread. Uma sessão só é
+// retirada de uma faixa uma vez, então ela tem um único dono durante toda a
+// simulação e as operações de fila e pilha não precisam de trava.
+// ---------------------------------------------------------------------------
+
+#define MAX_THREADS 256
+#define LOTE_SESSOES 16  // Sessões retiradas da própria faixa de cada vez
+
+// Faixa de sessões ainda não simuladas de uma thread
+typedef struct {
+    pthread_mutex_t trava;
+    int inicio;      // Primeira sessão pendente
+    int fim;         // Uma depois da última sessão pendente
+} __attribute__((aligned(64))) FaixaSessoes;
+
+// Parâmetros compartilhados por todas as threads da simulação
+typedef struct {
+    TabelaSessoes *tabela;
+    FaixaSessoes *faixas;
+    int numThreads;
+    long long acoesPorSessao;   // Média de ações por sessão
+    uint64_t sementeAcoes;      // Semente das ações sorteadas para cada sessão
+} Simulacao;
+
+// Estado e estatísticas de uma thread da simulação
+typedef struct {
+    Simulacao *simulacao;
+    int indice;
+    pthread_t thread;
+    int iniciada;               // 1 se a thread foi criada (a 0 é a principal)
+    long long acoes;            // Ações aplicadas por esta thread
+    long long sessoes;          // Sessões simuladas por esta thread
+    long long roubos;           // Faixas roubadas de outras threads
+    double segundos;            // Tempo ativo da thread
+} __attribute__((aligned(64))) TrabalhadorSimulacao;
+
+/**
+ * Quantidade de ações da sessão. Uma em cada 16 sessões recebe 8 vezes a
+ * média, para que as faixas fiquem desbalanceadas e o roubo seja exercitado.
+ */
+static long long acoesDaSessao(Simulacao *simulacao, int sessao) {
+    uint64_t x = simulacao->sementeAcoes ^ ((uint64_t)sessao * 0xD1B54A32D192ED03ULL);
+    return (splitmix64(&x) % 16 == 0) ? simulacao->acoesPorSessao * 8
+                                      : simulacao->acoesPorSessao;
+}
+
+/**
+ * Aplica a uma sessão a sequência de ações sorteada para ela. A sequência
+ * depende só da semente e do índice da sessão, então o estado final não
+ * depende de qual thread simulou a sessão.
+ * @return long long - Quantidade de ações aplicadas
+ */
+static long long simularSessao(Simulacao *simulacao, int sessao) {
+    TabelaSessoes *tabela = simulacao->tabela;
+    FilaPecas fila;
+    PilhaReserva pilha;
+    uint64_t x = simulacao->sementeAcoes + (uint64_t)sessao;
+    uint64_t bits = 0;
+    long long total = acoesDaSessao(simulacao, sessao);
+    Tabuleiro *tabuleiro = tabuleiroDaSessao(tabela, sessao);
+    
+    carregarSessao(tabela, sessao, &fila, &pilha);
+    for (long long i = 0; i < total; i++) {
+        // Cada saída de 64 bits rende 8 ações (1 a 5) de 8 bits cada
+        if ((i & 7) == 0) {
+            bits = splitmix64(&x);
+        }
+        aplicarAcao(&fila, &pilha, tabuleiro, 1 + (int)(((bits & 0xFF) * 5) >> 8));
+        bits >>= 8;
+    }
+    guardarSessao(tabela, sessao, &fila, &pilha);
+    return total;
+}
+
+/**
+ * Retira até 'quantidade' sessões do início da faixa
+ * @return int - 1 se obteve alguma sessão, 0 se a faixa está vazia
+ */
+static int retirarDaFaixa(FaixaSessoes *faixa, int quantidade, int *inicio, int *fim) {
+    int obteve = 0;
+    
+    pthread_mutex_lock(&faixa->trava);
+    if (faixa->inicio < faixa->fim) {
+        *inicio = faixa->inicio;
+        *fim = faixa->inicio + quantidade < faixa->fim ? faixa->inicio + quantidade : faixa->fim;
+        faixa->inicio = *fim;
+        obteve = 1;
+    }
+    pthread_mutex_unlock(&faixa->trava);
+    return obteve;
+}
+
+/**
+ * Rouba a metade final da faixa de outra thread e a coloca na própria faixa
+ * @return int - 1 se conseguiu roubar, 0 se todas as faixas estão vazias
+ */
+static int roubarFaixa(Simulacao *simulacao, int ladrao) {
+    for (int passo = 1; passo < simulacao->numThreads; passo++) {
+        FaixaSessoes *vitima = &simulacao->faixas[(ladrao + passo) % simulacao->numThreads];
+        int inicio = 0, fim = 0;
+        
+        pthread_mutex_lock(&vitima->trava);
+        int restantes = vitima->fim - vitima->inicio;
+        if (restantes > 0) {
+            fim = vitima->fim;
+            inicio = vitima->fim - (restantes + 1) / 2;
+            vitima->fim = inicio;
+        }
+        pthread_mutex_unlock(&vitima->trava);
+        
+        if (fim > inicio) {
+            FaixaSessoes *propria = &simulacao->faixas[ladrao];
+            pthread_mutex_lock(&propria->trava);
+            propria->inicio = inicio;
+            propria->fim = fim;
+            pthread_mutex_unlock(&propria->trava);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Laço de cada thread: consome a própria faixa e rouba quando ela acaba
+ */
+static void *executarTrabalhador(void *argumento) {
+    TrabalhadorSimulacao *trabalhador = argumento;
+    Simulacao *simulacao = trabalhador->simulacao;
+    FaixaSessoes *propria = &simulacao->faixas[trabalhador->indice];
+    double inicioTempo = tempoAtual();
+    int inicio, fim;
+    
+    for (;;) {
+        if (!retirarDaFaixa(propria, LOTE_SESSOES, &inicio, &fim)) {
+            if (!roubarFaixa(simulacao, trabalhador->indice)) {
+                break;
+            }
+            trabalhador->roubos++;
+            continue;
+        }
+        
+        for (int sessao = inicio; sessao < fim; sessao++) {
+            trabalhador->acoes += simularSessao(simulacao, sessao);
+            trabalhador->sessoes++;
+        }
+    }
+    
+    trabalhador->segundos = tempoAtual() - inicioTempo;
+    return NULL;
+}
+
+/**
+ * Modo de simulação paralela: aplica ações sorteadas a todas as sessões da
+ * tabela usando 'numThreads' threads e imprime a vazão (ações por segundo no
+ * total e por thread) e o resumo do estado final, que é o mesmo para
+ * qualquer número de threads.
+ * @return int - Código de saída do programa
+ */
+int executarModoSimulacao(TabelaSessoes *tabela, int numThreads,
+                          long long acoesPorSessao, uint64_t semente) {
+    if (numThreads < 1 || numThreads > MAX_THREADS) {
+        fprintf(stderr, "❌ Erro: número de threads inválido (use 1 a %d).\n", MAX_THREADS);
+        return 1;
+    }
+    
+    static FaixaSessoes faixas[MAX_THREADS];
+    static TrabalhadorSimulacao trabalhadores[MAX_THREADS];
+    Simulacao simulacao = {tabela, faixas, numThreads, acoesPorSessao, semente};
+    
+    // Divide as sessões em faixas contíguas de tamanho quase igual
+    for (int t = 0; t < numThreads; t++) {
+        pthread_mutex_init(&faixas[t].trava, NULL);
+        faixas[t].inicio = (int)((long long)tabela->quantidade * t / numThreads);
+        faixas[t].fim = (int)((long long)tabela->quantidade * (t + 1) / numThreads);
+        memset(&trabalhadores[t], 0, sizeof(trabalhadores[t]));
+        trabalhadores[t].simulacao = &simulacao;
+        trabalhadores[t].indice = t;
+    }
+    
+    double inicio = tempoAtual();
+    for (int t = 1; t < numThreads; t++) {
+        // Se a thread não puder ser criada, a faixa dela é roubada pelas outras
+        trabalhadores[t].iniciada = pthread_create(&trabalhadores[t].thread, NULL,
+                                                   executarTrabalhador, &trabalhadores[t]) == 0;
+        if (!trabalhadores[t].iniciada) {
+            fprintf(stderr, "❌ Erro: não foi possível criar a thread %d.\n", t);
+        }
+    }
+    executarTrabalhador(&trabalhadores[0]);  // A thread principal também trabalha
+    for (int t = 1; t < numThreads; t++) {
+        if (trabalhadores[t].iniciada) {
+            pthread_join(trabalhadores[t].thread, NULL);
+        }
+    }
+    double segundos = tempoAtual() - inicio;
+    
+    long long total = 0;
+    for (int t = 0; t < numThreads; t++) {
+        TrabalhadorSimulacao *trabalhador = &trabalhadores[t];
+        total += trabalhador->acoes;
+        printf("thread=%d sessoes=%lld acoes=%lld roubos=%lld acoes_por_segundo=%.0f\n",
+               t, trabalhador->sessoes, trabalhador->acoes, trabalhador->roubos,
+               trabalhador->segundos > 0 ? trabalhador->acoes / trabalhador->segundos : 0.0);
+        pthread_mutex_destroy(&faixas[t].trava);
+    }
+    
+    printf("threads=%d sessoes=%d acoes=%lld tempo=%.3fs\n",
+           numThreads, tabela->quantidade, total, segundos);
+    if (segundos > 0) {
+        printf("acoes_por_segundo=%.0f acoes_por_segundo_por_thread=%.0f\n",
+               total / segundos, total / segundos / numThreads);
+    }
+    printf("resumo=%016llx\n", (unsigned long long)calcularResumoTabela(tabela));
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Partida interativa como máquina de estados. O loop do menu virou uma
+// corrotina sem pilha própria: retomarPartida consome os bytes de entrada
+// que houver, monta e entrega um quadro para cada opção completa e, quando
+// a entrada acaba (mesmo no meio de um número), a partida fica suspensa,
+// com tudo o que precisa guardado na estrutura, até chegar mais entrada.
+// Nenhuma chamada espera pelo jogador, então o mesmo código atende o
+// terminal e milhares de conexões do servidor (--texto) em uma só thread.
+// ---------------------------------------------------------------------------
+
+// Recebe os bytes de cada quadro pronto
+typedef void (*EntregaQuadro)(void *contexto, const char *dados, size_t tamanho);
+
+// Onde está a leitura da próxima opção (a mesma sintaxe do scanf "%d")
+typedef enum {
+    LEITURA_ESPACOS,     // Pulando espaços antes do número
+    LEITURA_SINAL,       // Leu o sinal, falta o primeiro dígito
+    LEITURA_DIGITOS      // Lendo os dígitos
+} EtapaLeitura;
+
+typedef struct {
+    FilaPecas *fila;               // No servidor, só válidas durante uma retomada
+    PilhaReserva *pilha;           // (fora dela ficam NULL)
+    Tabuleiro *tabuleiro;          // NULL = sem tabuleiro
+    Historico *historico;          // NULL = desfazer indisponível
+    RegistroEventos *registro;     // NULL = sem registro
+    Renderizador *tela;
+    EntregaQuadro entregar;
+    void *contexto;                // Repassado a 'entregar'
+    int primeiroQuadro;
+    int encerrada;                 // 1 depois da despedida
+    long long opcoes;              // Opções executadas
+    EtapaLeitura leitura;
+    int negativo;
+    long numero;
+} PartidaInterativa;
+
+/**
+ * Fecha o quadro atual e o entrega
+ */
+static void entregarQuadro(PartidaInterativa *partida) {
+    size_t tamanho;
+    const char *dados = concluirQuadro(partida->tela, &tamanho);
+    partida->entregar(partida->contexto, dados, tamanho);
+}
+
+/**
+ * Começa um quadro: o cabeçalho sai no primeiro quadro e, no modo
+ * diferencial, em todos
+ */
+static void abrirQuadro(PartidaInterativa *partida) {
+    Renderizador *tela = partida->tela;
+    iniciarQuadro(tela);
+    
+    if (partida->primeiroQuadro || tela->diferencial) {
+        escreverQuadro(tela, "╔══════════════════════════════════════════════╗\n");
+        escreverQuadro(tela, "║      BEM-VINDO AO TETRIS STACK!             ║\n");
+        escreverQuadro(tela, "║      Sistema Avançado de Gerenciamento      ║\n");
+        escreverQuadro(tela, "║      Fila Circular + Pilha de Reserva       ║\n");
+        escreverQuadro(tela, "╚══════════════════════════════════════════════╝\n");
+    }
+}
+
+/**
+ * Termina o quadro com o estado (se pedido) e o menu, e o entrega
+ * @param comEstado - 1 para exibir o estado antes do menu
+ */
+static void fecharQuadro(PartidaInterativa *partida, int comEstado) {
+    Renderizador *tela = partida->tela;
+    
+    if (comEstado) {
+        uint64_t inicioEstado = iniciarMedicao();
+        exibirEstado(tela, partida->fila, partida->pilha, partida->tabuleiro);
+        concluirMedicao(METRICA_EXIBIR_ESTADO, inicioEstado, 0);
+    }
+    uint64_t inicioMenu = iniciarMedicao();
+    exibirMenu(tela, pecasTrocaMultipla(partida->pilha));
+    concluirMedicao(METRICA_EXIBIR_MENU, inicioMenu, 0);
+    entregarQuadro(partida);
+    partida->primeiroQuadro = 0;
+}
+
+/**
+ * Entrega o quadro inicial: cabeçalho, estado e menu, sem nenhuma opção
+ */
+static void exibirQuadroInicial(PartidaInterativa *partida) {
+    abrirQuadro(partida);
+    completarLinhas(partida->tela, partida->tela->tamanho, LINHAS_MENSAGEM);
+    fecharQuadro(partida, 1);
+}
+
+/**
+ * Executa uma opção do menu e entrega o quadro seguinte
+ * @param opcao - Opção lida (qualquer número diferente de 0)
+ */
+static void executarOpcao(PartidaInterativa *partida, int opcao) {
+    Renderizador *tela = partida->tela;
+    FilaPecas *fila = partida->fila;
+    PilhaReserva *pilha = partida->pilha;
+    Tabuleiro *tabuleiro = partida->tabuleiro;
+    uint64_t inicioQuadro = iniciarMedicao();
+    abrirQuadro(partida);
+    
+    // Resultado da opção escolhida no quadro anterior
+    size_t inicioMensagens = tela->tamanho;
+    IdPeca idTopoAntes = idDoTopo(pilha);
+    ResultadoOperacao resultado = OP_OPCAO_INVALIDA;
+    MarcaHistorico marca;
+    Colocacao colocacao;
+    if (partida->historico != NULL) {
+        marcarAntesDaAcao(&marca, fila, pilha, tabuleiro);
+    }
+    uint64_t inicioAcao = iniciarMedicao();
+    int falhou = 0;
+    switch(opcao) {
+        case 1:
+            // Jogar peça (remover da fila e adicionar nova)
+            resultado = jogarPeca(tela, fila, tabuleiro, &colocacao);
+            break;
+            
+        case 2:
+            // Enviar peça da fila para a pilha
+            resultado = enviarParaPilha(tela, fila, pilha);
+            break;
+            
+        case 3:
+            // Usar peça da pilha de reserva
+            resultado = usarPecaDaPilha(tela, pilha, tabuleiro, &colocacao);
+            break;
+            
+        case 4:
+            // Trocar peça da frente da fila com o topo da pilha
+            resultado = trocarPecaAtual(tela, fila, pilha);
+            break;
+            
+        case 5:
+            // Troca múltipla: k peças da fila com k da pilha
+            resultado = trocarMultipla(tela, fila, pilha);
+            break;
+            
+        case 6:
+            // Desfazer a última ação
+            falhou = !desfazerUltimaAcao(tela, partida->historico, fila, pilha, tabuleiro);
+            break;
+            
+        case 7:
+            // Refazer a ação desfeita
+            falhou = !refazerUltimaAcao(tela, partida->historico, fila, pilha, tabuleiro);
+            break;
+            
+        default:
+            escreverQuadro(tela, "\n❌ Opção inválida! Tente novamente.\n");
+    }
+    if (opcao >= 1 && opcao <= 7) {
+        concluirMedicao((TipoMetrica)opcao, inicioAcao, opcao <= 5 ? resultado != OP_SUCESSO : falhou);
+    }
+    completarLinhas(tela, inicioMensagens, LINHAS_MENSAGEM);
+    
+    if (partida->historico != NULL && opcao >= 1 && opcao <= 5) {
+        registrarNoHistorico(partida->historico, &marca, opcao, resultado,
+                             tabuleiro != NULL && (opcao == 1 || opcao == 3) ? &colocacao : NULL);
+    }
+    
+    // Cada ação vai para o disco logo, para o registro sobreviver a uma queda
+    if (partida->registro != NULL) {
+        registrarEvento(partida->registro, opcao, resultado, fila, idTopoAntes);
+        descarregarRegistro(partida->registro);
+    }
+    
+    // Após uma opção inválida só o menu é exibido de novo (fora do modo diferencial)
+    fecharQuadro(partida, tela->diferencial || (opcao >= 1 && opcao <= 7));
+    concluirMedicao(METRICA_QUADRO, inicioQuadro, 0);
+}
+
+/**
+ * Entrega a despedida e encerra a partida
+ */
+static void despedirPartida(PartidaInterativa *partida) {
+    Renderizador *tela = partida->tela;
+    
+    iniciarQuadro(tela);
+    if (tela->diferencial) {
+        escreverQuadro(tela, "\n");  // Continua abaixo do prompt
+    }
+    escreverQuadro(tela, "\n👋 Obrigado por jogar Tetris Stack!\n");
+    escreverQuadro(tela, "🎮 Desenvolvido pela ByteBros.\n\n");
+    tela->diferencial = 0;  // A despedida vai direto, sem comparação
+    entregarQuadro(partida);
+    partida->encerrada = 1;
+}
+
+/**
+ * Começa a partida e entrega o quadro inicial
+ * @param historico - Histórico para desfazer (NULL = indisponível)
+ * @param registro - Registro de eventos (NULL = sem registro)
+ * @param entregar - Chamada com os bytes de cada quadro, junto com 'contexto'
+ */
+void iniciarPartidaInterativa(PartidaInterativa *partida, FilaPecas *fila, PilhaReserva *pilha,
+                              Tabuleiro *tabuleiro, Historico *historico, RegistroEventos *registro,
+                              Renderizador *tela, EntregaQuadro entregar, void *contexto) {
+    memset(partida, 0, sizeof(*partida));
+    partida->fila = fila;
+    partida->pilha = pilha;
+    partida->tabuleiro = tabuleiro;
+    partida->historico = historico;
+    partida->registro = registro;
+    partida->tela = tela;
+    partida->entregar = entregar;
+    partida->contexto = contexto;
+    partida->primeiroQuadro = 1;
+    partida->leitura = LEITURA_ESPACOS;
+    exibirQuadroInicial(partida);
+}
+
+/**
+ * Conclui o número lido: 0 encerra a partida, o resto é uma opção do menu
+ */
+static void concluirNumero(PartidaInterativa *partida) {
+    int opcao = (int)(partida->negativo ? -partida->numero : partida->numero);
+    
+    partida->leitura = LEITURA_ESPACOS;
+    partida->negativo = 0;
+    if (opcao == 0) {
+        despedirPartida(partida);
+    } else {
+        executarOpcao(partida, opcao);
+        partida->opcoes++;
+    }
+}
+
+/**
+ * Retoma a partida com mais bytes de entrada. Cada número completo é uma
+ * opção; o que sobrar de um número incompleto fica para a próxima chamada.
+ * Como no scanf, qualquer caractere que não forme um número encerra.
+ * @return int - 1 se a partida continua, 0 se foi encerrada
+ */
+int retomarPartida(PartidaInterativa *partida, const char *entrada, size_t tamanho) {
+    for (size_t i = 0; i < tamanho && !partida->encerrada; i++) {
+        char c = entrada[i];
+        
+        if (c >= '0' && c <= '9') {
+            if (partida->leitura != LEITURA_DIGITOS) {
+                partida->leitura = LEITURA_DIGITOS;
+                partida->numero = 0;
+            }
+            if (partida->numero < 1000000000L) {
+                partida->numero = partida->numero * 10 + (c - '0');
+            }
+            continue;
+        }
+        
+        // O caractere que encerra um número é examinado em seguida
+        if (partida->leitura == LEITURA_DIGITOS) {
+            concluirNumero(partida);
+            if (partida->encerrada) {
+                break;
+            }
+        }
+        if (partida->leitura == LEITURA_ESPACOS && (c == ' ' || (c >= '\t' && c <= '\r'))) {
+            continue;
+        }
+        if (partida->leitura == LEITURA_ESPACOS && (c == '-' || c == '+')) {
+            partida->leitura = LEITURA_SINAL;
+            partida->negativo = c == '-';
+            continue;
+        }
+        despedirPartida(partida);
+    }
+    return !partida->encerrada;
+}
+
+/**
+ * Fim da entrada: um número pendente ainda vale; depois a partida encerra
+ */
+void encerrarEntradaPartida(PartidaInterativa *partida) {
+    if (!partida->encerrada && partida->leitura == LEITURA_DIGITOS) {
+        concluirNumero(partida);
+    }
+    if (!partida->encerrada) {
+        despedirPartida(partida);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Servidor local: uma partida por conexão, em um socket Unix ou TCP em
+// 127.0.0.1. Uma única thread atende todos os clientes com epoll; cada
+// cliente ocupa uma sessão da tabela (fila e pilha próprias), devolvida
+// quando ele desconecta.
+//
+// Protocolo binário (inteiros em little-endian):
+//   ao conectar, o servidor envia 16 bytes: "TETRISSK", versão (u32) e o
+//     número da sessão (u32)
+//   cada comando é 1 byte: 1-5 = ações do menu, 8 = estado completo,
+//     0 = encerrar; outros códigos respondem OP_OPCAO_INVALIDA
+//   o comando 0 não tem resposta: o servidor envia as respostas pendentes,
+//     fecha a conexão e ignora o que vier depois dele
+//   cada um dos outros comandos recebe 24 bytes: código (u8), resultado (u8), tipo da peça
+//     da frente e do topo (u8 cada, 0xFF = vazia), tamanho da fila (u32), da
+//     pilha (u32), linhas eliminadas (u32) e hash do estado (u64)
+//   o estado completo acrescenta as peças da fila (frente ao fim) e as da
+//     pilha (base ao topo), 8 bytes cada (id << 3 | tipo)
+// O cliente pode mandar vários comandos sem esperar as respostas, que saem
+// na ordem dos comandos.
+// ---------------------------------------------------------------------------
+
+#define MAGICO_SERVIDOR "TETRISSK"
+#define VERSAO_PROTOCOLO 1
+#define TAMANHO_SAUDACAO 16
+#define TAMANHO_RESPOSTA 24
+#define COMANDO_ESTADO 8
+#define SESSOES_SERVIDOR 4096            // Clientes simultâneos, por padrão
+#define TAMANHO_LEITURA_SERVIDOR 4096    // Comandos lidos de um cliente por vez
+#define LIMITE_SAIDA_CLIENTE (1 << 20)   // Acima disto o cliente só volta a ser lido quando a saída esvaziar
+#define MAX_EVENTOS_SERVIDOR 256
+#define ID_ESCUTA UINT32_MAX             // Identifica o socket de escuta nos eventos
+
+// Conexão de um cliente (uma por sessão da tabela)
+typedef struct {
+    int fd;                    // -1 = sessão livre
+    uint8_t *saida;            // Respostas ainda não enviadas
+    size_t usado;              // Bytes em 'saida'
+    size_t enviado;            // Bytes de 'saida' já enviados
+    size_t capacidade;
+    uint32_t eventos;          // Eventos registrados no epoll
+    uint8_t *entrada;          // Buffer de leitura (só no backend io_uring)
+    PartidaInterativa partida; // Partida de texto (--texto), suspensa entre leituras
+    Renderizador tela;         // Quadros da partida de texto
+    int falhou;                // 1 se faltou memória para a saída
+    int encerrar;              // 1 = fechar quando a saída esvaziar
+} ClienteServidor;
+
+typedef struct {
+    TabelaSessoes *tabela;
+    ClienteServidor *clientes;
+    int *livres;               // Pilha de sessões livres
+    int numLivres;
+    int escuta;
+    int epoll;
+    const char *caminhoUnix;   // Socket a remover no fim (NULL = TCP)
+    int texto;                 // 1 = menu em texto, como no terminal (--texto)
+    uint64_t semente;
+    uint64_t conexoes;         // Conexões aceitas; a k-ésima joga com semente + k
+    uint64_t recusadas;        // Conexões sem sessão livre
+    uint64_t comandos;
+} Servidor;
+
+static volatile sig_atomic_t servidorAtivo = 1;
+
+/**
+ * Pede o fim do servidor (SIGINT/SIGTERM)
+ */
+static void tratarFimServidor(int sinal) {
+    (void)sinal;
+    servidorAtivo = 0;
+}
+
+/**
+ * Abre o socket de escuta: só dígitos = porta TCP em 127.0.0.1, qualquer
+ * outra coisa = caminho de um socket Unix
+ * @param caminhoUnix - Recebe o caminho se o socket for Unix, senão NULL
+ * @return int - Descritor do socket, ou -1 em caso de erro
+ */
+static int abrirEscuta(const char *endereco, const char **caminhoUnix) {
+    int porta = (int)strspn(endereco, "0123456789") == (int)strlen(endereco) ? atoi(endereco) : -1;
+    int fd;
+    
+    *caminhoUnix = NULL;
+    if (porta >= 0) {
+        struct sockaddr_in local;
+        int um = 1;
+        if (porta < 1 || porta > 65535) {
+            return -1;
+        }
+        memset(&local, 0, sizeof(local));
+        local.sin_family = AF_INET;
+        local.sin_port = htons((uint16_t)porta);
+        local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &um, sizeof(um));
+        if (bind(fd, (struct sockaddr *)&local, sizeof(local)) != 0) {
+            close(fd);
+            return -1;
+        }
+    } else {
+        struct sockaddr_un local;
+        struct stat info;
+        if (strlen(endereco) >= sizeof(local.sun_path)) {
+            return -1;
+        }
+        memset(&local, 0, sizeof(local));
+        local.sun_family = AF_UNIX;
+        strcpy(local.sun_path, endereco);
+        
+        // Um socket que sobrou de uma execução anterior é substituído;
+        // qualquer outro arquivo com esse nome é mantido (e o bind falha)
+        if (lstat(endereco, &info) == 0 && S_ISSOCK(info.st_mode)) {
+            unlink(endereco);
+        }
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        if (bind(fd, (struct sockaddr *)&local, sizeof(local)) != 0) {
+            close(fd);
+            return -1;
+        }
+        *caminhoUnix = endereco;
+    }
+    
+    if (listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        if (*caminhoUnix != NULL) {
+            unlink(*caminhoUnix);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Garante espaço para mais 'extra' bytes na saída do cliente
+ * @return int - 1 em caso de sucesso, 0 se faltar memória
+ */
+static int reservarSaida(ClienteServidor *cliente, size_t extra) {
+    if (cliente->usado + extra <= cliente->capacidade) {
+        return 1;
+    }
+    
+    // Antes de crescer, descarta o que já foi enviado
+    if (cliente->enviado > 0) {
+        memmove(cliente->saida, cliente->saida + cliente->enviado, cliente->usado - cliente->enviado);
+        cliente->usado -= cliente->enviado;
+        cliente->enviado = 0;
+        if (cliente->usado + extra <= cliente->capacidade) {
+            return 1;
+        }
+    }
+    
+    size_t nova = cliente->capacidade ? cliente->capacidade : 4096;
+    while (nova < cliente->usado + extra) {
+        nova *= 2;
+    }
+    uint8_t *saida = realloc(cliente->saida, nova);
+    if (saida == NULL) {
+        return 0;
+    }
+    cliente->saida = saida;
+    cliente->capacidade = nova;
+    return 1;
+}
+
+/**
+ * Atualiza no epoll os eventos do cliente: leitura enquanto a saída couber
+ * no limite, escrita enquanto houver algo a enviar
+ */
+static void atualizarEventosCliente(Servidor *servidor, int sessao) {
+    ClienteServidor *cliente = &servidor->clientes[sessao];
+    size_t pendente = cliente->usado - cliente->enviado;
+    uint32_t eventos = 0;
+    
+    if (!cliente->encerrar && pendente < LIMITE_SAIDA_CLIENTE) {
+        eventos |= EPOLLIN;
+    }
+    if (pendente > 0) {
+        eventos |= EPOLLOUT;
+    }
+    if (eventos != cliente->eventos) {
+        struct epoll_event evento = {.events = eventos, .data.u32 = (uint32_t)sessao};
+        epoll_ctl(servidor->epoll, EPOLL_CTL_MOD, cliente->fd, &evento);
+        cliente->eventos = eventos;
+    }
+}
+
+/**
+ * Fecha a conexão e devolve a sessão; a arena da pilha só é liberada
+ * quando a sessão for usada de novo (reiniciarSessao)
+ */
+static void fecharCliente(Servidor *servidor, int sessao) {
+    ClienteServidor *cliente = &servidor->clientes[sessao];
+    
+    close(cliente->fd);   // Também tira o descritor do epoll
+    cliente->fd = -1;
+    cliente->usado = cliente->enviado = 0;
+    cliente->encerrar = 0;
+    servidor->livres[servidor->numLivres++] = sessao;
+}
+
+/**
+ * Acrescenta um quadro da partida de texto à saída do cliente
+ * @param contexto - O ClienteServidor dono da partida
+ */
+static void entregarAoCliente(void *contexto, const char *dados, size_t tamanho) {
+    ClienteServidor *cliente = contexto;
+    if (!reservarSaida(cliente, tamanho)) {
+        cliente->falhou = 1;
+        return;
+    }
+    memcpy(cliente->saida + cliente->usado, dados, tamanho);
+    cliente->usado += tamanho;
+}
+
+/**
+ * Põe na saída de um cliente recém-conectado a saudação do protocolo
+ * binário ou, com --texto, o quadro inicial da partida
+ * @return int - 1 em caso de sucesso, 0 se faltar memória
+ */
+static int saudarCliente(Servidor *servidor, int sessao) {
+    ClienteServidor *cliente = &servidor->clientes[sessao];
+    
+    cliente->falhou = 0;
+    if (servidor->texto) {
+        FilaPecas fila;
+        PilhaReserva pilha;
+        carregarSessao(servidor->tabela, sessao, &fila, &pilha);
+        iniciarPartidaInterativa(&cliente->partida, &fila, &pilha, tabuleiroDaSessao(servidor->tabela, sessao),
+                                 NULL, NULL, &cliente->tela, entregarAoCliente, cliente);
+        // 'fila' e 'pilha' morrem aqui: atenderTexto aponta de novo a cada retomada
+        cliente->partida.fila = NULL;
+        cliente->partida.pilha = NULL;
+        return !cliente->falhou;
+    }
+    
+    if (!reservarSaida(cliente, TAMANHO_SAUDACAO)) {
+        return 0;
+    }
+    uint8_t *p = cliente->saida + cliente->usado;
+    memcpy(p, MAGICO_SERVIDOR, 8);
+    escreverLE(p + 8, VERSAO_PROTOCOLO, 4);
+    escreverLE(p + 12, (uint64_t)sessao, 4);
+    cliente->usado += TAMANHO_SAUDACAO;
+    return 1;
+}
+
+/**
+ * Aceita todas as conexões pendentes, cada uma com uma partida nova
+ */
+static void aceitarClientes(Servidor *servidor) {
+    for (;;) {
+        int fd = accept4(servidor->escuta, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;  // EAGAIN: não há mais conexões (ou erro passageiro)
+        }
+        if (servidor->numLivres == 0) {
+            close(fd);
+            servidor->recusadas++;
+            continue;
+        }
+        
+        int sessao = servidor->livres[--servidor->numLivres];
+        ClienteServidor *cliente = &servidor->clientes[sessao];
+        struct epoll_event evento = {.events = EPOLLIN | EPOLLOUT, .data.u32 = (uint32_t)sessao};
+        int um = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));  // Falha (sem efeito) em socket Unix
+        
+        reiniciarSessao(servidor->tabela, sessao, servidor->semente + servidor->conexoes++);
+        cliente->fd = fd;
+        cliente->eventos = evento.events;
+        if (!saudarCliente(servidor, sessao) || epoll_ctl(servidor->epoll, EPOLL_CTL_ADD, fd, &evento) != 0) {
+            fecharCliente(servidor, sessao);
+        }
+    }
+}
+
+/**
+ * Escreve a resposta de 24 bytes de um comando
+ */
+static uint8_t *escreverResposta(uint8_t *p, int comando, ResultadoOperacao resultado,
+                                 FilaPecas *fila, PilhaReserva *pilha, const Tabuleiro *tabuleiro) {
+    p[0] = (uint8_t)comando;
+    p[1] = (uint8_t)resultado;
+    p[2] = filaVazia(fila) ? 0xFF : (uint8_t)tipoPeca(fila->pecas[fila->frente]);
+    p[3] = pilhaVazia(pilha) ? 0xFF : (uint8_t)tipoPeca(pilha->pecas[pilha->topo]);
+    escreverLE(p + 4, (uint64_t)fila->tamanho, 4);
+    escreverLE(p + 8, (uint64_t)(pilha->topo + 1), 4);
+    escreverLE(p + 12, tabuleiro != NULL ? (uint64_t)tabuleiro->linhasEliminadas : 0, 4);
+    return escreverLE(p + 16, hashEstado(fila, pilha), 8);
+}
+
+/**
+ * Aplica os comandos recebidos à sessão do cliente e acrescenta as
+ * respostas à saída dele. A sessão é carregada e guardada uma vez só.
+ * @return int - 1 em caso de sucesso, 0 se faltar memória para a saída
+ */
+static int atenderComandos(Servidor *servidor, int sessao, const uint8_t *comandos, size_t quantidade) {
+    ClienteServidor *cliente = &servidor->clientes[sessao];
+    Tabuleiro *tabuleiro = tabuleiroDaSessao(servidor->tabela, sessao);
+    FilaPecas fila;
+    PilhaReserva pilha;
+    int ok = reservarSaida(cliente, quantidade * TAMANHO_RESPOSTA);
+    
+    carregarSessao(servidor->tabela, sessao, &fila, &pilha);
+    for (size_t i = 0; ok && i < quantidade; i++) {
+        int comando = comandos[i];
+        ResultadoOperacao resultado;
+        
+        if (comando == 0) {
+            cliente->encerrar = 1;
+            break;
+        }
+        uint64_t inicio = iniciarMedicao();
+        if (comando == COMANDO_ESTADO) {
+            size_t extra = 8 * (size_t)(fila.tamanho + pilha.topo + 1);
+            if (!reservarSaida(cliente, (quantidade - i) * TAMANHO_RESPOSTA + extra)) {
+                ok = 0;
+                break;
+            }
+            uint8_t *p = escreverResposta(cliente->saida + cliente->usado, comando, OP_SUCESSO,
+                                          &fila, &pilha, tabuleiro);
+            for (int j = 0; j < fila.tamanho; j++) {
+                p = escreverLE(p, pecaParaU64(fila.pecas[(fila.frente + j) & fila.mascara]), 8);
+            }
+            for (int j = 0; j <= pilha.topo; j++) {
+                p = escreverLE(p, pecaParaU64(pilha.pecas[j]), 8);
+            }
+            cliente->usado = (size_t)(p - cliente->saida);
+            concluirMedicao(METRICA_EXIBIR_ESTADO, inicio, 0);
+        } else {
+            resultado = comando < NUM_ACOES ? aplicarAcao(&fila, &pilha, tabuleiro, comando) : OP_OPCAO_INVALIDA;
+            escreverResposta(cliente->saida + cliente->usado, comando, resultado, &fila, &pilha, tabuleiro);
+            cliente->usado += TAMANHO_RESPOSTA;
+            if (comando < NUM_ACOES) {
+                concluirMedicao((TipoMetrica)comando, inicio, resultado != OP_SUCESSO);
+            }
+        }
+        servidor->comandos++;
+    }
+    guardarSessao(servidor->tabela, sessao, &fila, &pilha);
+    return ok;
+}
+
+/**
+ * Com --texto, retoma a partida do cliente com os bytes recebidos: ela
+ * avança uma opção por número completo e fica suspensa no resto. A fila e
+ * a pilha da sessão são carregadas só durante a retomada.
+ * @return int - 1 em caso de sucesso, 0 se faltar memória para a saída
+ */
+static int atenderTexto(Servidor *servidor, int sessao, const uint8_t *entrada, size_t tamanho) {
+    ClienteServidor *cliente = &servidor->clientes[sessao];
+    FilaPecas fila;
+    PilhaReserva pilha;
+    
+    long long opcoesAntes = cliente->partida.opcoes;
+    
+    carregarSessao(servidor->tabela, sessao, &fila, &pilha);
+    cliente->partida.fila = &fila;
+    cliente->partida.pilha = &pilha;
+    if (!retomarPartida(&cliente->partida, (const char *)entrada, tamanho)) {
+        cliente->encerrar = 1;
+    }
+    guardarSessao(servidor->tabela, sessao, &fila, &pilha);
+    cliente->partida.fila = NULL;
+    cliente->partida.pilha = NULL;
+    servidor->comandos += (uint64_t)(cliente->partida.opcoes - opcoesAntes);
+    return !cliente->falhou;
+}
+
+/**
+ * Aplica os bytes recebidos do cliente conforme o modo do servidor
+ */
+static int atenderEntrada(Servidor *servidor, int sessao, const uint8_t *entrada, size_t tamanho) {
+    uint64_t inicio = iniciarMedicao();
+    int ok = servidor->texto ? atenderTexto(servidor, sessao, entrada, tamanho)
+                             : atenderComandos(servidor, sessao, entrada, tamanho);
+    concluirMedicao(METRICA_ATENDIMENTO, inicio, !ok);
+    return ok;
+}
+
+/**
+ * Envia o que couber da saída do cliente
+ * @return int - 0 se a conexão caiu
+ */
+static int enviarSaidaCliente(ClienteServidor *cliente) {
+    while (cliente->enviado < cliente->usado) {
+        ssize_t enviados = send(cliente->fd, cliente->saida + cliente->enviado,
+                                cliente->usado - cliente->enviado, MSG_NOSIGNAL);
+        if (enviados < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        cliente->enviado += (size_t)enviados;
+    }
+    cliente->usado = cliente->enviado = 0;
+    return 1;
+}
+
+/**
+ * Trata os eventos de um cliente: lê e aplica comandos, envia respostas
+ */
+static void atenderCliente(Servidor *servidor, int sessao, uint32_t eventos) {
+    ClienteServidor *cliente = &servidor->clientes[sessao];
+    int vivo = 1;
+    
+    if (eventos & EPOLLIN) {
+        uint8_t comandos[TAMANHO_LEITURA_SERVIDOR];
+        ssize_t lidos = recv(cliente->fd, comandos, sizeof(comandos), 0);
+        if (lidos > 0) {
+            vivo = atenderEntrada(servidor, sessao, comandos, (size_t)lidos);
+        } else if (lidos == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            vivo = 0;  // O cliente fechou a conexão
+        }
+    }
+    if (vivo && (eventos & (EPOLLERR | EPOLLHUP)) && !(eventos & EPOLLIN)) {
+        vivo = 0;
+    }
+    
+    // Tenta enviar já, sem esperar o próximo EPOLLOUT
+    if (vivo) {
+        vivo = enviarSaidaCliente(cliente);
+    }
+    if (!vivo || (cliente->encerrar && cliente->usado == 0)) {
+        fecharCliente(servidor, sessao);
+        return;
+    }
+    atualizarEventosCliente(servidor, sessao);
+}
+
+/**
+ * Sobe o limite de descritores abertos até o máximo permitido, para
+ * atender milhares de clientes
+ */
+static void ampliarLimiteDescritores(void) {
+    struct rlimit limite;
+    if (getrlimit(RLIMIT_NOFILE, &limite) == 0 && limite.rlim_cur < limite.rlim_max) {
+        limite.rlim_cur = limite.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limite);
+    }
+}
+
+/**
+ * Cria o servidor sobre a tabela: todas as sessões começam livres
+ * @return int - 1 em caso de sucesso
+ */
+static int criarServidor(Servidor *servidor, TabelaSessoes *tabela, const char *endereco, uint64_t semente,
+                         int texto) {
+    int n = tabela->quantidade;
+    
+    memset(servidor, 0, sizeof(*servidor));
+    servidor->tabela = tabela;
+    servidor->semente = semente;
+    servidor->texto = texto;
+    servidor->clientes = calloc((size_t)n, sizeof(ClienteServidor));
+    servidor->livres = malloc((size_t)n * sizeof(int));
+    servidor->epoll = epoll_create1(EPOLL_CLOEXEC);
+    servidor->escuta = abrirEscuta(endereco, &servidor->caminhoUnix);
+    
+    if (servidor->clientes == NULL || servidor->livres == NULL || servidor->epoll < 0 || servidor->escuta < 0) {
+        free(servidor->clientes);
+        free(servidor->livres);
+        if (servidor->epoll >= 0) {
+            close(servidor->epoll);
+        }
+        if (servidor->escuta >= 0) {
+            close(servidor->escuta);
+        }
+        return 0;
+    }
+    
+    // A sessão 0 é a primeira a ser usada
+    for (int i = 0; i < n; i++) {
+        servidor->clientes[i].fd = -1;
+        servidor->livres[i] = n - 1 - i;
+    }
+    servidor->numLivres = n;
+    
+    struct epoll_event evento = {.events = EPOLLIN, .data.u32 = ID_ESCUTA};
+    epoll_ctl(servidor->epoll, EPOLL_CTL_ADD, servidor->escuta, &evento);
+    return 1;
+}
+
+/**
+ * Fecha todas as conexões e o socket de escuta
+ */
+static void liberarServidor(Servidor *servidor) {
+    for (int i = 0; i < servidor->tabela->quantidade; i++) {
+        if (servidor->clientes[i].fd >= 0) {
+            close(servidor->clientes[i].fd);
+        }
+        free(servidor->clientes[i].saida);
+        free(servidor->clientes[i].entrada);
+        liberarRenderizador(&servidor->clientes[i].tela);
+    }
+    close(servidor->escuta);
+    close(servidor->epoll);
+    if (servidor->caminhoUnix != NULL) {
+        unlink(servidor->caminhoUnix);
+    }
+    free(servidor->clientes);
+    free(servidor->livres);
+}
+
+/**
+ * Loop do servidor com epoll: espera prontidão e atende cada cliente pronto
+ */
+static void executarServidorEpoll(Servidor *servidor) {
+    struct epoll_event eventos[MAX_EVENTOS_SERVIDOR];
+    
+    while (servidorAtivo) {
+        int prontos = epoll_wait(servidor->epoll, eventos, MAX_EVENTOS_SERVIDOR, -1);
+        atenderPedidoRelatorio();
+        for (int i = 0; i < prontos; i++) {
+            if (eventos[i].data.u32 == ID_ESCUTA) {
+                aceitarClientes(servidor);
+            } else if (servidor->clientes[eventos[i].data.u32].fd >= 0) {
+                atenderCliente(servidor, (int)eventos[i].data.u32, eventos[i].events);
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Backend io_uring do servidor (--io-uring). Com epoll, cada leitura e cada
+// envio é uma syscall; aqui as leituras de comandos, os envios de respostas
+// e o accept vão para a fila de submissão do anel, e uma única chamada a
+// io_uring_enter por volta do loop submete todas e espera as que terminam.
+//
+// O anel é montado com as syscalls diretas (sem liburing). Cada cliente tem
+// no máximo uma operação em andamento: lê um lote de comandos, envia as
+// respostas dele e só então lê de novo. Assim o buffer de saída nunca muda
+// enquanto o kernel o usa, e fechar a conexão não deixa operação pendente.
+// Se o kernel não tiver io_uring (ou ele estiver bloqueado), o servidor
+// avisa e usa epoll.
+// ---------------------------------------------------------------------------
+
+#ifdef TEM_IO_URING
+
+#define ENTRADAS_ANEL_IO 4096   // Tamanho da fila de submissão
+
+// Tipo da operação, nos 2 bits baixos do user_data (o resto é a sessão)
+typedef enum {
+    OPERACAO_ACEITAR = 0,
+    OPERACAO_LER = 1,
+    OPERACAO_ENVIAR = 2
+} OperacaoAnel;
+
+// Filas de submissão e de conclusão mapeadas do kernel
+typedef struct {
+    int fd;
+    _Atomic uint32_t *sqCabeca;          // Avançada pelo kernel ao consumir
+    _Atomic uint32_t *sqCauda;           // Avançada por nós ao submeter
+    uint32_t sqMascara;
+    uint32_t *sqIndices;
+    struct io_uring_sqe *sqes;
+    _Atomic uint32_t *cqCabeca;          // Avançada por nós ao colher
+    _Atomic uint32_t *cqCauda;           // Avançada pelo kernel ao concluir
+    uint32_t cqMascara;
+    struct io_uring_cqe *cqes;
+    void *mapaSq;
+    void *mapaCq;                        // Igual a mapaSq com IORING_FEAT_SINGLE_MMAP
+    size_t tamanhoSq;
+    size_t tamanhoCq;
+    size_t tamanhoSqes;
+    uint32_t naoSubmetidas;              // Operações preparadas desde a última submissão
+} AnelIO;
+
+/**
+ * Cria o anel e mapeia as filas
+ * @return int - 1 em caso de sucesso, 0 se o io_uring não estiver disponível
+ */
+static int criarAnelIO(AnelIO *anel, unsigned entradas) {
+    struct io_uring_params parametros;
+    
+    memset(anel, 0, sizeof(*anel));
+    memset(&parametros, 0, sizeof(parametros));
+    anel->fd = (int)syscall(__NR_io_uring_setup, entradas, &parametros);
+    if (anel->fd < 0) {
+        return 0;
+    }
+    
+    anel->tamanhoSq = parametros.sq_off.array + parametros.sq_entries * sizeof(uint32_t);
+    anel->tamanhoCq = parametros.cq_off.cqes + parametros.cq_entries * sizeof(struct io_uring_cqe);
+    anel->tamanhoSqes = parametros.sq_entries * sizeof(struct io_uring_sqe);
+    int mapaUnico = (parametros.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (mapaUnico) {
+        anel->tamanhoSq = anel->tamanhoCq = anel->tamanhoSq > anel->tamanhoCq ? anel->tamanhoSq : anel->tamanhoCq;
+    }
+    
+    anel->mapaSq = mmap(NULL, anel->tamanhoSq, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        anel->fd, IORING_OFF_SQ_RING);
+    anel->mapaCq = mapaUnico ? anel->mapaSq
+                             : mmap(NULL, anel->tamanhoCq, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                    anel->fd, IORING_OFF_CQ_RING);
+    anel->sqes = mmap(NULL, anel->tamanhoSqes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      anel->fd, IORING_OFF_SQES);
+    if (anel->mapaSq == MAP_FAILED || anel->mapaCq == MAP_FAILED || anel->sqes == MAP_FAILED) {
+        if (anel->mapaSq != MAP_FAILED) {
+            munmap(anel->mapaSq, anel->tamanhoSq);
+        }
+        if (!mapaUnico && anel->mapaCq != MAP_FAILED) {
+            munmap(anel->mapaCq, anel->tamanhoCq);
+        }
+        if (anel->sqes != MAP_FAILED) {
+            munmap(anel->sqes, anel->tamanhoSqes);
+        }
+        close(anel->fd);
+        return 0;
+    }
+    
+    uint8_t *sq = anel->mapaSq;
+    uint8_t *cq = anel->mapaCq;
+    anel->sqCabeca = (_Atomic uint32_t *)(sq + parametros.sq_off.head);
+    anel->sqCauda = (_Atomic uint32_t *)(sq + parametros.sq_off.tail);
+    anel->sqMascara = *(uint32_t *)(sq + parametros.sq_off.ring_mask);
+    anel->sqIndices = (uint32_t *)(sq + parametros.sq_off.array);
+    anel->cqCabeca = (_Atomic uint32_t *)(cq + parametros.cq_off.head);
+    anel->cqCauda = (_Atomic uint32_t *)(cq + parametros.cq_off.tail);
+    anel->cqMascara = *(uint32_t *)(cq + parametros.cq_off.ring_mask);
+    anel->cqes = (struct io_uring_cqe *)(cq + parametros.cq_off.cqes);
+    return 1;
+}
+
+/**
+ * Desfaz os mapeamentos e fecha o anel
+ */
+static void liberarAnelIO(AnelIO *anel) {
+    munmap(anel->sqes, anel->tamanhoSqes);
+    if (anel->mapaCq != anel->mapaSq) {
+        munmap(anel->mapaCq, anel->tamanhoCq);
+    }
+    munmap(anel->mapaSq, anel->tamanhoSq);
+    close(anel->fd);
+}
+
+/**
+ * Submete as operações preparadas e, com 'esperar', bloqueia até ao menos
+ * uma concluir
+ * @return int - Operações submetidas, ou -errno
+ */
+static int submeterAnelIO(AnelIO *anel, int esperar) {
+    int submetidas = (int)syscall(__NR_io_uring_enter, anel->fd, anel->naoSubmetidas, esperar ? 1 : 0,
+                                  esperar ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    if (submetidas < 0) {
+        return -errno;
+    }
+    anel->naoSubmetidas -= (uint32_t)submetidas;
+    return submetidas;
+}
+
+/**
+ * Prepara uma operação na fila de submissão. Com a fila cheia, submete o
+ * que já está nela antes.
+ * @return int - 1 em caso de sucesso, 0 se a fila continuar cheia
+ */
+static int prepararOperacaoAnel(AnelIO *anel, uint8_t codigo, int fd, void *dados, uint32_t tamanho,
+                                uint64_t identificador) {
+    uint32_t cauda = atomic_load_explicit(anel->sqCauda, memory_order_relaxed);
+    if (cauda - atomic_load_explicit(anel->sqCabeca, memory_order_acquire) > anel->sqMascara) {
+        submeterAnelIO(anel, 0);
+        if (cauda - atomic_load_explicit(anel->sqCabeca, memory_order_acquire) > anel->sqMascara) {
+            return 0;
+        }
+    }
+    
+    uint32_t posicao = cauda & anel->sqMascara;
+    struct io_uring_sqe *sqe = &anel->sqes[posicao];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = codigo;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)dados;
+    sqe->len = tamanho;
+    sqe->user_data = identificador;
+    if (codigo == IORING_OP_SEND) {
+        sqe->msg_flags = MSG_NOSIGNAL;
+    } else if (codigo == IORING_OP_ACCEPT) {
+        sqe->accept_flags = SOCK_CLOEXEC;
+    }
+    anel->sqIndices[posicao] = posicao;
+    
+    // A entrada só fica visível ao kernel depois de preenchida
+    atomic_store_explicit(anel->sqCauda, cauda + 1, memory_order_release);
+    anel->naoSubmetidas++;
+    return 1;
+}
+
+/**
+ * Pede a leitura do próximo lote de comandos do cliente
+ */
+static int pedirLeitura(AnelIO *anel, Servidor *servidor, int sessao) {
+    ClienteServidor *cliente = &servidor->clientes[sessao];
+    return prepararOperacaoAnel(anel, IORING_OP_RECV, cliente->fd, cliente->entrada, TAMANHO_LEITURA_SERVIDOR,
+                                (uint64_t)sessao << 2 | OPERACAO_LER);
+}
+
+/**
+ * Pede o envio do que falta da saída do cliente
+ */
+static int pedirEnvio(AnelIO *anel, Servidor *servidor, int sessao) {
+    ClienteServidor *cliente = &servidor->clientes[sessao];
+    size_t pendente = cliente->usado - cliente->enviado;
+    return prepararOperacaoAnel(anel, IORING_OP_SEND, cliente->fd, cliente->saida + cliente->enviado,
+                                pendente > UINT32_MAX ? UINT32_MAX : (uint32_t)pendente,
+                                (uint64_t)sessao << 2 | OPERACAO_ENVIAR);
+}
+
+/**
+ * Conclusão de um accept: a conexão ganha uma sessão e a saudação
+ */
+static void concluirAceite(AnelIO *anel, Servidor *servidor, int fd) {
+    if (servidor->numLivres == 0) {
+        close(fd);
+        servidor->recusadas++;
+        return;
+    }
+    
+    int sessao = servidor->livres[--servidor->numLivres];
+    ClienteServidor *cliente = &servidor->clientes[sessao];
+    int um = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));
+    
+    reiniciarSessao(servidor->tabela, sessao, servidor->semente + servidor->conexoes++);
+    cliente->fd = fd;
+    if (cliente->entrada == NULL) {
+        cliente->entrada = malloc(TAMANHO_LEITURA_SERVIDOR);
+    }
+    if (cliente->entrada == NULL || !saudarCliente(servidor, sessao) || !pedirEnvio(anel, servidor, sessao)) {
+        fecharCliente(servidor, sessao);
+    }
+}
+
+/**
+ * Conclusão de uma leitura (resultado = bytes lidos) ou de um envio
+ * (resultado = bytes enviados); prepara a próxima operação do cliente
+ */
+static void concluirOperacaoCliente(AnelIO *anel, Servidor *servidor, int sessao, OperacaoAnel operacao,
+                                    int resultado) {
+    ClienteServidor *cliente = &servidor->clientes[sessao];
+    int vivo = resultado > 0 || (resultado == 0 && operacao == OPERACAO_ENVIAR);
+    
+    if (vivo && operacao == OPERACAO_LER) {
+        vivo = atenderEntrada(servidor, sessao, cliente->entrada, (size_t)resultado);
+    } else if (vivo) {
+        cliente->enviado += (size_t)resultado;
+        if (cliente->enviado == cliente->usado) {
+            cliente->usado = cliente->enviado = 0;
+        }
+    }
+    
+    if (vivo && cliente->usado > cliente->enviado) {
+        vivo = pedirEnvio(anel, servidor, sessao);
+    } else if (vivo && !cliente->encerrar) {
+        vivo = pedirLeitura(anel, servidor, sessao);
+    } else {
+        vivo = 0;  // Erro, fim da conexão ou comando 0 com tudo enviado
+    }
+    if (!vivo) {
+        fecharCliente(servidor, sessao);
+    }
+}
+
+/**
+ * Loop do servidor sobre o anel: uma syscall submete as operações
+ * preparadas na volta anterior e espera novas conclusões
+ */
+static void executarServidorAnel(Servidor *servidor, AnelIO *anel) {
+    // O accept e as leituras esperam dentro do anel, sem O_NONBLOCK
+    fcntl(servidor->escuta, F_SETFL, fcntl(servidor->escuta, F_GETFL) & ~O_NONBLOCK);
+    prepararOperacaoAnel(anel, IORING_OP_ACCEPT, servidor->escuta, NULL, 0, ID_ESCUTA);
+    
+    while (servidorAtivo) {
+        int submetidas = submeterAnelIO(anel, 1);
+        atenderPedidoRelatorio();
+        if (submetidas < 0 && submetidas != -EINTR && submetidas != -EAGAIN && submetidas != -EBUSY) {
+            fprintf(stderr, "❌ Erro: io_uring_enter falhou (%s).\n", strerror(-submetidas));
+            return;
+        }
+        
+        uint32_t cabeca = atomic_load_explicit(anel->cqCabeca, memory_order_relaxed);
+        uint32_t cauda = atomic_load_explicit(anel->cqCauda, memory_order_acquire);
+        for (; cabeca != cauda; cabeca++) {
+            const struct io_uring_cqe *cqe = &anel->cqes[cabeca & anel->cqMascara];
+            if (cqe->user_data == ID_ESCUTA) {
+                if (cqe->res >= 0) {
+                    concluirAceite(anel, servidor, cqe->res);
+                }
+                prepararOperacaoAnel(anel, IORING_OP_ACCEPT, servidor->escuta, NULL, 0, ID_ESCUTA);
+            } else {
+                concluirOperacaoCliente(anel, servidor, (int)(cqe->user_data >> 2),
+                                        (OperacaoAnel)(cqe->user_data & 3), cqe->res);
+            }
+        }
+        atomic_store_explicit(anel->cqCabeca, cabeca, memory_order_release);
+    }
+}
+
+#endif
+
+/**
+ * Modo servidor: atende clientes até SIGINT ou SIGTERM e imprime os totais
+ * @param endereco - Porta TCP (em 127.0.0.1) ou caminho do socket Unix
+ * @param usarAnel - 1 para tentar o backend io_uring (senão, ou sem suporte, epoll)
+ * @param texto - 1 para o menu em texto no lugar do protocolo binário
+ * @return int - Código de saída do programa
+ */
+int executarModoServidor(TabelaSessoes *tabela, const char *endereco, uint64_t semente, int usarAnel,
+                         int texto) {
+    Servidor servidor;
+    
+    ampliarLimiteDescritores();
+    if (!criarServidor(&servidor, tabela, endereco, semente, texto)) {
+        fprintf(stderr, "❌ Erro: não foi possível escutar em '%s'.\n", endereco);
+        return 1;
+    }
+    
+    struct sigaction acao;
+    memset(&acao, 0, sizeof(acao));
+    acao.sa_handler = tratarFimServidor;
+    sigemptyset(&acao.sa_mask);
+    sigaction(SIGINT, &acao, NULL);
+    sigaction(SIGTERM, &acao, NULL);
+    
+    const char *backend = "epoll";
+#ifdef TEM_IO_URING
+    AnelIO anel;
+    if (usarAnel && criarAnelIO(&anel, ENTRADAS_ANEL_IO)) {
+        backend = "io_uring";
+    } else if (usarAnel) {
+        fprintf(stderr, "❌ Erro: io_uring indisponível (%s); usando epoll.\n", strerror(errno));
+        usarAnel = 0;
+    }
+#else
+    if (usarAnel) {
+        fprintf(stderr, "❌ Erro: compilado sem io_uring; usando epoll.\n");
+        usarAnel = 0;
+    }
+#endif
+    
+    fprintf(stderr, "✓ Servidor escutando em '%s' (%d sessões, %s).\n", endereco, tabela->quantidade, backend);
+    double inicio = tempoAtual();
+    
+#ifdef TEM_IO_URING
+    if (usarAnel) {
+        executarServidorAnel(&servidor, &anel);
+        liberarAnelIO(&anel);
+    }
+#endif
+    if (!usarAnel) {
+        executarServidorEpoll(&servidor);
+    }
+    
+    double segundos = tempoAtual() - inicio;
+    printf("conexoes=%llu recusadas=%llu comandos=%llu\n", (unsigned long long)servidor.conexoes,
+           (unsigned long long)servidor.recusadas, (unsigned long long)servidor.comandos);
+    if (segundos > 0) {
+        fprintf(stderr, "tempo=%.3fs comandos_por_segundo=%.0f\n", segundos, servidor.comandos / segundos);
+    }
+    liberarServidor(&servidor);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Busca de jogadas para bots: enumera as ações legais (com todas as
+// colocações das peças que vão para o tabuleiro), avalia o tabuleiro com uma
+// heurística de pesos configuráveis e procura N jogadas à frente usando as
+// peças visíveis da fila e da pilha. A profundidade conta peças colocadas:
+// antes de cada colocação o bot pode fazer uma ação sem colocação (reservar
+// ou trocar). Peças que ainda não foram sorteadas encerram a busca naquele
+// ramo. Cada thread busca uma parte das jogadas da raiz, com aprofundamento
+// iterativo e tabela de transposição própria (mantida entre as decisões),
+// até completar a profundidade pedida ou esgotar o orçamento de tempo.
+// ---------------------------------------------------------------------------
+
+#define MAX_PROFUNDIDADE_BUSCA 8
+#define PREVIEW_BUSCA 16          // Peças da fila visíveis para a busca
+#define PILHA_BUSCA 16            // Peças do topo da pilha visíveis para a busca
+#define TIPO_DESCONHECIDO 0xFF    // Peça ainda não sorteada
+// Ações 1 e 3 (rotação x coluna, no tabuleiro mais largo) e as ações 2, 4 e 5
+#define MAX_JOGADAS (2 * NUM_ROTACOES * LARGURA_MAXIMA_TABULEIRO + 3)
+#define BITS_TRANSPOSICAO 14      // Tabela de transposição padrão: 2^14 entradas por thread
+#define NOS_ENTRE_RELOGIOS 256    // Nós visitados entre consultas ao relógio
+
+// Uma ação do menu e, para as ações 1 e 3, onde colocar a peça
+typedef struct {
+    int acao;       // 1 a 5, como no menu
+    int rotacao;    // Ações 1 e 3: rotação da peça
+    int coluna;     // Ações 1 e 3: coluna da borda esquerda da peça
+} Jogada;
+
+// Pesos da avaliação; valores maiores são melhores para o bot
+typedef struct {
+    double altura;          // Por célula na soma das alturas das colunas
+    double linhas;          // Por linha eliminada
+    double buracos;         // Por célula vazia coberta por um bloco
+    double irregularidade;  // Por unidade de diferença de altura entre colunas vizinhas
+    double fimDeJogo;       // Quando a peça passa do topo
+} PesosHeuristica;
+
+// Pesos padrão, os de uma heurística clássica de quatro termos
+static const PesosHeuristica PESOS_PADRAO = {-0.510066, 0.760666, -0.35663, -0.184483, -1000.0};
+
+typedef struct {
+    int profundidade;             // Jogadas à frente (1 a MAX_PROFUNDIDADE_BUSCA)
+    int numThreads;               // Threads para dividir a raiz (1 = sem threads)
+    double orcamentoSegundos;     // Tempo máximo da busca (0 = sem limite)
+    int bitsTransposicao;         // log2 das entradas da tabela de transposição
+    PesosHeuristica pesos;
+} ConfiguracaoBusca;
+
+typedef struct {
+    Jogada jogada;                // Melhor jogada encontrada
+    double valor;                 // Valor estimado da jogada
+    int profundidadeAlcancada;    // Profundidade completa da busca que a escolheu
+    long long nos;                // Estados visitados por todas as threads
+} ResultadoBusca;
+
+// Estado reduzido usado dentro da busca: o tabuleiro e os tipos das peças
+typedef struct {
+    Tabuleiro tabuleiro;
+    uint8_t fila[PREVIEW_BUSCA + MAX_PROFUNDIDADE_BUSCA + PILHA_BUSCA];  // Tipos a partir da frente original
+    int frente;                   // Índice da frente atual em 'fila'
+    int tamanhoFila;              // Peças na fila (constante durante a busca)
+    uint8_t pilha[PILHA_BUSCA];   // pilha[0] é o topo
+    int tamanhoPilha;             // Peças na pilha (pode passar de PILHA_BUSCA)
+    int capacidadePilha;
+    int pecasTroca;               // Peças trocadas pela ação 5 (até PILHA_BUSCA é simulada)
+    int ultimaAcao;               // Depois de uma ação sem colocação só vêm colocações
+} EstadoBusca;
+
+typedef struct {
+    uint64_t chave;
+    float valor;
+    int8_t profundidade;
+} EntradaTransposicao;
+
+// Configuração e tabelas de transposição (uma por thread) de um bot.
+// As tabelas são reaproveitadas de uma decisão para a seguinte.
+typedef struct {
+    ConfiguracaoBusca config;
+    EntradaTransposicao *transposicao;
+    size_t entradasPorThread;
+    int ultimaAcao;    // Ação da decisão anterior (supõe que o bot a aplicou)
+} MotorBusca;
+
+// Dados de uma thread de busca
+typedef struct {
+    const EstadoBusca *raiz;
+    const ConfiguracaoBusca *config;
+    const Jogada *jogadas;         // Jogadas da raiz (todas as threads)
+    int numJogadas;
+    int indice;                    // Esta thread busca as jogadas indice, indice + numThreads, ...
+    int numThreads;
+    double prazo;                  // Instante limite (tempoAtual), 0 = sem limite
+    EntradaTransposicao *transposicao;
+    uint64_t mascaraTransposicao;
+    long long nos;
+    int esgotado;                  // 1 quando o prazo passou durante a busca
+    int melhorJogada[MAX_PROFUNDIDADE_BUSCA + 1];    // Índice em 'jogadas', por profundidade
+    double melhorValor[MAX_PROFUNDIDADE_BUSCA + 1];
+    int profundidadeCompleta;      // Maior profundidade terminada antes do prazo
+    pthread_t thread;
+    int iniciada;                  // 1 se a thread foi criada (a 0 é a principal)
+} TrabalhadorBusca;
+
+/**
+ * Avalia o tabuleiro pela heurística: altura somada das colunas, buracos e
+ * irregularidade, todos calculados com operações de bits linha a linha
+ */
+static double avaliarTabuleiro(const Tabuleiro *tabuleiro, const PesosHeuristica *pesos) {
+    int alturas[LARGURA_MAXIMA_TABULEIRO] = {0};
+    uint32_t cobertas = 0;   // Colunas que já têm bloco acima da linha atual
+    int buracos = 0;
+    
+    for (int y = tabuleiro->alturaOcupada - 1; y >= 0; y--) {
+        uint32_t linha = tabuleiro->linhas[y];
+        uint32_t novas = linha & ~cobertas;
+        while (novas) {
+            alturas[__builtin_ctz(novas)] = y + 1;
+            novas &= novas - 1;
+        }
+        buracos += __builtin_popcount(~linha & cobertas);
+        cobertas |= linha;
+    }
+    
+    int somaAlturas = alturas[0];
+    int irregularidade = 0;
+    for (int c = 1; c < tabuleiro->largura; c++) {
+        somaAlturas += alturas[c];
+        irregularidade += abs(alturas[c] - alturas[c - 1]);
+    }
+    
+    return pesos->altura * somaAlturas + pesos->buracos * buracos +
+           pesos->irregularidade * irregularidade;
+}
+
+/**
+ * Monta o estado da busca a partir da partida
+ */
+static void montarEstadoBusca(EstadoBusca *estado, const FilaPecas *fila,
+                              const PilhaReserva *pilha, const Tabuleiro *tabuleiro) {
+    memset(estado->fila, TIPO_DESCONHECIDO, sizeof(estado->fila));
+    memset(estado->pilha, TIPO_DESCONHECIDO, sizeof(estado->pilha));
+    estado->tabuleiro = *tabuleiro;
+    estado->frente = 0;
+    estado->tamanhoFila = fila->tamanho;
+    for (int i = 0; i < fila->tamanho && i < PREVIEW_BUSCA; i++) {
+        estado->fila[i] = (uint8_t)tipoPeca(fila->pecas[(fila->frente + i) & fila->mascara]);
+    }
+    
+    estado->tamanhoPilha = pilha->topo + 1;
+    estado->capacidadePilha = pilha->capacidade;
+    estado->pecasTroca = pecasTrocaMultipla(pilha);
+    for (int i = 0; i < estado->tamanhoPilha && i < PILHA_BUSCA; i++) {
+        estado->pilha[i] = (uint8_t)tipoPeca(pilha->pecas[pilha->topo - i]);
+    }
+    estado->ultimaAcao = 0;
+}
+
+/**
+ * Enumera as jogadas legais a partir do estado. Jogadas que colocam uma
+ * peça aparecem uma vez para cada rotação distinta e coluna possível.
+ * @return int - Quantidade de jogadas escritas em 'jogadas'
+ */
+static int enumerarJogadas(const EstadoBusca *estado, Jogada *jogadas) {
+    int n = 0;
+    int largura = estado->tabuleiro.largura;
+    int tipoFila = estado->tamanhoFila > 0 ? estado->fila[estado->frente] : TIPO_DESCONHECIDO;
+    int tipoPilha = estado->tamanhoPilha > 0 ? estado->pilha[0] : TIPO_DESCONHECIDO;
+    
+    // Ações 1 e 3: cada rotação e coluna da peça da frente ou do topo
+    const int acoesColocacao[2] = {1, 3};
+    const int tipos[2] = {tipoFila, tipoPilha};
+    for (int a = 0; a < 2; a++) {
+        int tipo = tipos[a];
+        if (tipo == TIPO_DESCONHECIDO) {
+            continue;
+        }
+        for (int r = 0; r < ROTACOES_DISTINTAS[tipo]; r++) {
+            for (int x = 0; x + LARGURA_FORMA[tipo][r] <= largura; x++) {
+                jogadas[n++] = (Jogada){acoesColocacao[a], r, x};
+            }
+        }
+    }
+    
+    // Uma ação sem colocação por vez: trocas seguidas só se desfariam
+    if (estado->ultimaAcao == 2 || estado->ultimaAcao == 4 || estado->ultimaAcao == 5) {
+        return n;
+    }
+    if (tipoFila != TIPO_DESCONHECIDO && estado->tamanhoPilha < estado->capacidadePilha &&
+        estado->tamanhoPilha < PILHA_BUSCA) {
+        jogadas[n++] = (Jogada){2, 0, 0};
+    }
+    if (tipoFila != TIPO_DESCONHECIDO && tipoPilha != TIPO_DESCONHECIDO) {
+        jogadas[n++] = (Jogada){4, 0, 0};
+    }
+    int k = estado->pecasTroca;
+    if (estado->tamanhoFila >= k && estado->tamanhoPilha >= k && k <= PILHA_BUSCA &&
+        estado->frente + k <= (int)sizeof(estado->fila)) {
+        jogadas[n++] = (Jogada){5, 0, 0};
+    }
+    return n;
+}
+
+/**
+ * Testa se a jogada coloca uma peça no tabuleiro (ações 1 e 3)
+ */
+static inline int jogadaColocaPeca(const Jogada *jogada) {
+    return jogada->acao == 1 || jogada->acao == 3;
+}
+
+/**
+ * Aplica uma jogada ao estado da busca
+ * @return double - Ganho imediato da jogada (linhas eliminadas e fim de jogo)
+ */
+static double aplicarJogadaBusca(EstadoBusca *estado, const Jogada *jogada,
+                                 const PesosHeuristica *pesos, int *fimDeJogo) {
+    Colocacao colocacao = {0, 0, 0, 0, 0, 0};
+    uint8_t *frente = &estado->fila[estado->frente];
+    
+    estado->ultimaAcao = jogada->acao;
+    switch (jogada->acao) {
+        case 1:
+            colocarPeca(&estado->tabuleiro, frente[0], jogada->rotacao, jogada->coluna, &colocacao);
+            estado->frente++;  // A peça nova do final da fila ainda é desconhecida
+            break;
+            
+        case 2:
+            memmove(&estado->pilha[1], &estado->pilha[0], PILHA_BUSCA - 1);
+            estado->pilha[0] = frente[0];
+            estado->tamanhoPilha++;
+            estado->frente++;
+            break;
+            
+        case 3:
+            colocarPeca(&estado->tabuleiro, estado->pilha[0], jogada->rotacao, jogada->coluna, &colocacao);
+            memmove(&estado->pilha[0], &estado->pilha[1], PILHA_BUSCA - 1);
+            estado->pilha[PILHA_BUSCA - 1] = TIPO_DESCONHECIDO;
+            estado->tamanhoPilha--;
+            break;
+            
+        case 4: {
+            uint8_t tipo = frente[0];
+            frente[0] = estado->pilha[0];
+            estado->pilha[0] = tipo;
+            break;
+        }
+            
+        case 5:
+            // Frente da fila <-> k-ésima peça da pilha, como em operacaoTrocarMultipla
+            for (int i = 0; i < estado->pecasTroca; i++) {
+                uint8_t tipo = frente[i];
+                frente[i] = estado->pilha[estado->pecasTroca - 1 - i];
+                estado->pilha[estado->pecasTroca - 1 - i] = tipo;
+            }
+            break;
+    }
+    
+    *fimDeJogo = colocacao.fimDeJogo;
+    return pesos->linhas * colocacao.linhasEliminadas + (colocacao.fimDeJogo ? pesos->fimDeJogo : 0);
+}
+
+/**
+ * Chave do estado e da profundidade restante para a tabela de transposição.
+ * Inclui todas as peças que a subárvore pode alcançar: cada nível consome
+ * até 2 peças da fila (reservar e jogar) e pode descer uma posição na pilha,
+ * e a troca múltipla mexe em k posições de cada lado.
+ */
+static uint64_t chaveEstadoBusca(const EstadoBusca *estado, int profundidade) {
+    uint64_t chave = 0x9E3779B97F4A7C15ULL * (uint64_t)(profundidade + 1);
+    int fimFila = estado->frente + 2 * profundidade + estado->pecasTroca;
+    
+    if (fimFila > (int)sizeof(estado->fila)) {
+        fimFila = (int)sizeof(estado->fila);
+    }
+    for (int y = 0; y < estado->tabuleiro.alturaOcupada; y++) {
+        chave = (chave ^ estado->tabuleiro.linhas[y]) * 0xBF58476D1CE4E5B9ULL;
+    }
+    for (int i = estado->frente; i < fimFila; i++) {
+        chave = (chave ^ estado->fila[i]) * 0x94D049BB133111EBULL;
+    }
+    for (int i = 0; i < profundidade + estado->pecasTroca && i < PILHA_BUSCA; i++) {
+        chave = (chave ^ estado->pilha[i]) * 0x94D049BB133111EBULL;
+    }
+    chave ^= (uint64_t)estado->tamanhoPilha << 56 ^ (uint64_t)estado->ultimaAcao << 48;
+    return chave ^ (chave >> 31);
+}
+
+/**
+ * Valor do estado com 'profundidade' colocações à frente (busca em
+ * profundidade, maximizando). Retorna 0 se o prazo passar no meio.
+ */
+static double buscarValor(TrabalhadorBusca *trabalhador, const EstadoBusca *estado, int profundidade) {
+    const PesosHeuristica *pesos = &trabalhador->config->pesos;
+    
+    if (++trabalhador->nos % NOS_ENTRE_RELOGIOS == 0 && trabalhador->prazo > 0 &&
+        tempoAtual() > trabalhador->prazo) {
+        trabalhador->esgotado = 1;
+    }
+    if (trabalhador->esgotado) {
+        return 0;
+    }
+    if (profundidade == 0) {
+        return avaliarTabuleiro(&estado->tabuleiro, pesos);
+    }
+    
+    uint64_t chave = chaveEstadoBusca(estado, profundidade);
+    EntradaTransposicao *entrada = &trabalhador->transposicao[chave & trabalhador->mascaraTransposicao];
+    if (entrada->chave == chave && entrada->profundidade == profundidade) {
+        return entrada->valor;
+    }
+    
+    Jogada jogadas[MAX_JOGADAS];
+    int numJogadas = enumerarJogadas(estado, jogadas);
+    if (numJogadas == 0) {
+        return avaliarTabuleiro(&estado->tabuleiro, pesos);  // Só peças desconhecidas à frente
+    }
+    
+    double melhor = -1e300;
+    for (int j = 0; j < numJogadas; j++) {
+        EstadoBusca filho = *estado;
+        int fimDeJogo;
+        double valor = aplicarJogadaBusca(&filho, &jogadas[j], pesos, &fimDeJogo);
+        // Depois de um fim de jogo o ramo não é aprofundado
+        valor += fimDeJogo ? avaliarTabuleiro(&filho.tabuleiro, pesos)
+                           : buscarValor(trabalhador, &filho,
+                                         profundidade - jogadaColocaPeca(&jogadas[j]));
+        if (trabalhador->esgotado) {
+            return 0;
+        }
+        if (valor > melhor) {
+            melhor = valor;
+        }
+    }
+    
+    if (!trabalhador->esgotado) {
+        entrada->chave = chave;
+        entrada->valor = (float)melhor;
+        entrada->profundidade = (int8_t)profundidade;
+    }
+    return melhor;
+}
+
+/**
+ * Laço de uma thread: aprofundamento iterativo sobre a sua parte da raiz
+ */
+static void *executarTrabalhadorBusca(void *argumento) {
+    TrabalhadorBusca *trabalhador = argumento;
+    const PesosHeuristica *pesos = &trabalhador->config->pesos;
+    double prazo = trabalhador->prazo;
+    
+    for (int profundidade = 1; profundidade <= trabalhador->config->profundidade; profundidade++) {
+        // A profundidade 1 termina sempre, mesmo depois do prazo: sem ela a
+        // jogada seria a primeira legal, escolhida sem olhar o tabuleiro
+        trabalhador->prazo = profundidade == 1 ? 0 : prazo;
+        int melhorJogada = -1;
+        double melhorValor = -1e300;
+        
+        for (int j = trabalhador->indice; j < trabalhador->numJogadas; j += trabalhador->numThreads) {
+            EstadoBusca filho = *trabalhador->raiz;
+            int fimDeJogo;
+            double valor = aplicarJogadaBusca(&filho, &trabalhador->jogadas[j], pesos, &fimDeJogo);
+            valor += fimDeJogo ? avaliarTabuleiro(&filho.tabuleiro, pesos)
+                               : buscarValor(trabalhador, &filho,
+                                             profundidade - jogadaColocaPeca(&trabalhador->jogadas[j]));
+            if (trabalhador->esgotado) {
+                break;
+            }
+            if (valor > melhorValor) {
+                melhorValor = valor;
+                melhorJogada = j;
+            }
+        }
+        
+        if (trabalhador->esgotado) {
+            break;
+        }
+        trabalhador->melhorJogada[profundidade] = melhorJogada;
+        trabalhador->melhorValor[profundidade] = melhorValor;
+        trabalhador->profundidadeCompleta = profundidade;
+    }
+    return NULL;
+}
+
+/**
+ * Preenche a configuração de busca com os valores padrão: 2 colocações à
+ * frente, uma thread, orçamento de 1 ms (sem orçamento se --profundidade
+ * for dado sem --orcamento)
+ */
+void configuracaoBuscaPadrao(ConfiguracaoBusca *config) {
+    config->profundidade = 2;
+    config->numThreads = 1;
+    config->orcamentoSegundos = 0.001;
+    config->bitsTransposicao = BITS_TRANSPOSICAO;
+    config->pesos = PESOS_PADRAO;
+}
+
+/**
+ * Enumera as jogadas legais da partida (ações 1 e 3 com todas as colocações)
+ * @param jogadas - Recebe até MAX_JOGADAS jogadas
+ * @return int - Quantidade de jogadas
+ */
+int gerarJogadas(const FilaPecas *fila, const PilhaReserva *pilha, const Tabuleiro *tabuleiro,
+                 Jogada *jogadas) {
+    EstadoBusca estado;
+    montarEstadoBusca(&estado, fila, pilha, tabuleiro);
+    return enumerarJogadas(&estado, jogadas);
+}
+
+/**
+ * Cria um bot com a configuração dada
+ * @return int - 1 em caso de sucesso, 0 se a configuração for inválida ou faltar memória
+ */
+int criarMotorBusca(MotorBusca *motor, const ConfiguracaoBusca *config) {
+    if (config->profundidade < 1 || config->profundidade > MAX_PROFUNDIDADE_BUSCA ||
+        config->numThreads < 1 || config->numThreads > MAX_THREADS ||
+        config->bitsTransposicao < 4 || config->bitsTransposicao > 28) {
+        return 0;
+    }
+    
+    motor->config = *config;
+    motor->ultimaAcao = 0;
+    motor->entradasPorThread = (size_t)1 << config->bitsTransposicao;
+    motor->transposicao = calloc(motor->entradasPorThread * (size_t)config->numThreads,
+                                 sizeof(EntradaTransposicao));
+    return motor->transposicao != NULL;
+}
+
+/**
+ * Libera as tabelas do bot
+ */
+void liberarMotorBusca(MotorBusca *motor) {
+    free(motor->transposicao);
+    motor->transposicao = NULL;
+}
+
+/**
+ * Procura a melhor jogada para a partida. Com orçamento de tempo, devolve a
+ * melhor jogada da maior profundidade que todas as threads completaram.
+ * @param motor - Bot criado com criarMotorBusca
+ * @param resultado - Recebe a jogada escolhida e as estatísticas
+ * @return int - 1 se encontrou uma jogada, 0 se não há jogada legal
+ */
+int buscarJogada(MotorBusca *motor, const FilaPecas *fila, const PilhaReserva *pilha,
+                 const Tabuleiro *tabuleiro, ResultadoBusca *resultado) {
+    const ConfiguracaoBusca *config = &motor->config;
+    EstadoBusca raiz;
+    Jogada jogadas[MAX_JOGADAS];
+    TrabalhadorBusca trabalhadores[MAX_THREADS];
+    double inicio = tempoAtual();
+    
+    // Como dentro da busca, depois de reservar ou trocar vem uma colocação;
+    // sem isso uma busca cortada pelo prazo poderia desfazer a troca anterior
+    montarEstadoBusca(&raiz, fila, pilha, tabuleiro);
+    raiz.ultimaAcao = motor->ultimaAcao;
+    int numJogadas = enumerarJogadas(&raiz, jogadas);
+    if (numJogadas == 0) {
+        return 0;
+    }
+    
+    int numThreads = config->numThreads < numJogadas ? config->numThreads : numJogadas;
+    size_t entradas = motor->entradasPorThread;
+    EntradaTransposicao *transposicao = motor->transposicao;
+    
+    for (int t = 0; t < numThreads; t++) {
+        TrabalhadorBusca *trabalhador = &trabalhadores[t];
+        memset(trabalhador, 0, sizeof(*trabalhador));
+        trabalhador->raiz = &raiz;
+        trabalhador->config = config;
+        trabalhador->jogadas = jogadas;
+        trabalhador->numJogadas = numJogadas;
+        trabalhador->indice = t;
+        trabalhador->numThreads = numThreads;
+        trabalhador->prazo = config->orcamentoSegundos > 0 ? inicio + config->orcamentoSegundos : 0;
+        trabalhador->transposicao = transposicao + entradas * (size_t)t;
+        trabalhador->mascaraTransposicao = entradas - 1;
+    }
+    
+    for (int t = 1; t < numThreads; t++) {
+        trabalhadores[t].iniciada = pthread_create(&trabalhadores[t].thread, NULL,
+                                                   executarTrabalhadorBusca, &trabalhadores[t]) == 0;
+    }
+    // A thread principal também busca, e assume as jogadas das threads que
+    // não puderam ser criadas
+    executarTrabalhadorBusca(&trabalhadores[0]);
+    for (int t = 1; t < numThreads; t++) {
+        if (!trabalhadores[t].iniciada) {
+            executarTrabalhadorBusca(&trabalhadores[t]);
+        }
+    }
+    for (int t = 1; t < numThreads; t++) {
+        if (trabalhadores[t].iniciada) {
+            pthread_join(trabalhadores[t].thread, NULL);
+        }
+    }
+    
+    // Só vale uma profundidade que todas as threads completaram
+    int profundidade = config->profundidade;
+    for (int t = 0; t < numThreads; t++) {
+        if (trabalhadores[t].profundidadeCompleta < profundidade) {
+            profundidade = trabalhadores[t].profundidadeCompleta;
+        }
+    }
+    
+    int melhor = 0;  // A profundidade 1 sempre completa; isto é só por garantia
+    double melhorValor = 0;
+    long long nos = 0;
+    for (int t = 0; t < numThreads; t++) {
+        TrabalhadorBusca *trabalhador = &trabalhadores[t];
+        nos += trabalhador->nos;
+        if (profundidade > 0 && trabalhador->melhorJogada[profundidade] >= 0 &&
+            (t == 0 || trabalhador->melhorValor[profundidade] > melhorValor)) {
+            melhor = trabalhador->melhorJogada[profundidade];
+            melhorValor = trabalhador->melhorValor[profundidade];
+        }
+    }
+    
+    motor->ultimaAcao = jogadas[melhor].acao;
+    resultado->jogada = jogadas[melhor];
+    resultado->valor = melhorValor;
+    resultado->profundidadeAlcancada = profundidade;
+    resultado->nos = nos;
+    return 1;
+}
+
+/**
+ * Aplica uma jogada à partida, com a colocação escolhida para as ações 1 e 3
+ * @param colocacao - Recebe onde a peça caiu (pode ser NULL)
+ * @return ResultadoOperacao - OP_SUCESSO ou o motivo da falha
+ */
+ResultadoOperacao aplicarJogada(FilaPecas *fila, PilhaReserva *pilha, Tabuleiro *tabuleiro,
+                                const Jogada *jogada, Colocacao *colocacao) {
+    Peca peca;
+    
+    if (jogada->acao == 1 || jogada->acao == 3) {
+        if (jogada->acao == 1 ? filaVazia(fila) : pilhaVazia(pilha)) {
+            return jogada->acao == 1 ? OP_FILA_VAZIA : OP_PILHA_VAZIA;
+        }
+        peca = jogada->acao == 1 ? fila->pecas[fila->frente] : pilha->pecas[pilha->topo];
+        if (jogada->rotacao < 0 || jogada->rotacao >= NUM_ROTACOES ||
+            linhaDeQueda(tabuleiro, tipoPeca(peca), jogada->rotacao, jogada->coluna) < 0) {
+            return OP_OPCAO_INVALIDA;
+        }
+        
+        if (jogada->acao == 1) {
+            removerDaFila(fila);
+            adicionarPecaNaFila(fila);
+        } else {
+            desempilharPeca(pilha);
+        }
+        colocarPeca(tabuleiro, tipoPeca(peca), jogada->rotacao, jogada->coluna, colocacao);
+        return OP_SUCESSO;
+    }
+    return aplicarAcao(fila, pilha, NULL, jogada->acao);
+}
+
+/**
+ * Preenche as linhas do fundo de um tabuleiro vazio com máscaras separadas
+ * por vírgula, da linha 0 para cima (decimal, ou hexadecimal com 0x)
+ * @return int - 1 se todas as linhas são válidas (nenhuma cheia ou além da largura)
+ */
+int preencherLinhas(Tabuleiro *tabuleiro, const char *texto) {
+    int y = 0;
+    for (const char *p = texto; ; p++) {
+        char *fim;
+        errno = 0;
+        unsigned long mascara = strtoul(p, &fim, 0);
+        if (fim == p || errno != 0 || (*fim != ',' && *fim != '\0') || y >= tabuleiro->altura ||
+            (mascara & ~(unsigned long)tabuleiro->linhaCheia) != 0 || mascara == tabuleiro->linhaCheia) {
+            return 0;
+        }
+        tabuleiro->linhas[y++] = (uint32_t)mascara;
+        if (mascara != 0) {
+            tabuleiro->alturaOcupada = y;
+        }
+        p = fim;
+        if (*p == '\0') {
+            return 1;
+        }
+    }
+}
+
+/**
+ * Modo bot: o bot joga 'decisoes' vezes na partida, decidindo cada jogada
+ * com buscarJogada, e imprime o resultado do tabuleiro. O tempo de decisão
+ * (médio e máximo) vai para stderr.
+ * @return int - Código de saída do programa
+ */
+int executarModoBot(FilaPecas *fila, PilhaReserva *pilha, Tabuleiro *tabuleiro,
+                    const ConfiguracaoBusca *config, long long decisoes) {
+    MotorBusca motor;
+    long long contagemAcoes[NUM_ACOES] = {0};
+    long long nos = 0;
+    long long profundidades = 0;
+    long long cortadas = 0;        // Decisões em que o prazo cortou a profundidade
+    double tempoTotal = 0, tempoMaximo = 0;
+    ResultadoBusca resultado;
+    
+    if (!criarMotorBusca(&motor, config)) {
+        fprintf(stderr, "❌ Erro: configuração de busca inválida ou memória insuficiente.\n");
+        return 1;
+    }
+    
+    for (long long i = 0; i < decisoes; i++) {
+        double inicio = tempoAtual();
+        if (!buscarJogada(&motor, fila, pilha, tabuleiro, &resultado)) {
+            fprintf(stderr, "❌ Erro: nenhuma jogada possível.\n");
+            liberarMotorBusca(&motor);
+            return 1;
+        }
+        double segundos = tempoAtual() - inicio;
+        tempoTotal += segundos;
+        if (segundos > tempoMaximo) {
+            tempoMaximo = segundos;
+        }
+        
+        aplicarJogada(fila, pilha, tabuleiro, &resultado.jogada, NULL);
+        contagemAcoes[resultado.jogada.acao]++;
+        nos += resultado.nos;
+        profundidades += resultado.profundidadeAlcancada;
+        cortadas += resultado.profundidadeAlcancada < config->profundidade;
+    }
+    liberarMotorBusca(&motor);
+    
+    printf("decisoes=%lld jogar=%lld reservar=%lld usar=%lld trocar=%lld multipla=%lld\n",
+           decisoes, contagemAcoes[1], contagemAcoes[2], contagemAcoes[3],
+           contagemAcoes[4], contagemAcoes[5]);
+    printf("pecas_colocadas=%lld linhas_eliminadas=%lld fins_de_jogo=%lld\n",
+           tabuleiro->pecasColocadas, tabuleiro->linhasEliminadas, tabuleiro->finsDeJogo);
+    if (decisoes > 0) {
+        fprintf(stderr, "profundidade_media=%.2f nos_por_decisao=%.0f "
+                "decisao_media_us=%.1f decisao_maxima_us=%.1f\n",
+                (double)profundidades / decisoes, (double)nos / decisoes,
+                tempoTotal * 1e6 / decisoes, tempoMaximo * 1e6);
+    }
+    if (cortadas > 0) {
+        fprintf(stderr, "⚠️  Aviso: em %lld de %lld decisões o orçamento de %.3f ms não bastou para a "
+                "profundidade %d (use --orcamento 0 para não ter limite).\n",
+                cortadas, decisoes, config->orcamentoSegundos * 1e3, config->profundidade);
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Micro-benchmarks das primitivas de fila e pilha e das trocas do nível
+// Mestre. Cada medida repete a operação em blocos e restaura o estado entre
+// os blocos em O(1) (só os índices), então o custo medido é o da operação.
+// ---------------------------------------------------------------------------
+
+#define OPS_POR_MEDIDA 4000000  // Operações por repetição de cada medida
+#define REPETICOES_BENCH 5      // Repetições; vale a mais rápida
+
+// Formato de saída dos benchmarks
+typedef enum {
+    BENCH_CSV = 0,
+    BENCH_JSON
+} FormatoBench;
+
+// Tipos de operação medidos
+typedef enum {
+    BENCH_FILA_ADICIONAR = 0,
+    BENCH_FILA_REMOVER,
+    BENCH_PILHA_EMPILHAR,
+    BENCH_PILHA_DESEMPILHAR,
+    BENCH_TROCAR_ATUAL,
+    BENCH_TROCAR_MULTIPLA,
+    BENCH_TROCAR_PECAS,
+    BENCH_COLOCAR_PECA,
+    NUM_BENCH
+} OperacaoBench;
+
+static const char *NOMES_BENCH[NUM_BENCH] = {
+    "adicionarPecaNaFila", "removerDaFila", "empilharPeca",
+    "desempilharPeca", "trocarPecaAtual", "trocarMultipla", "trocarPecas", "colocarPeca"
+};
+
+static volatile uint64_t sumidouroBench;  // Impede que o compilador descarte as operações
+
+/**
+ * Executa uma repetição da medida e retorna o tempo em segundos
+ * @param operacao - Operação medida
+ * @param fila - Fila cheia
+ * @param pilha - Pilha cheia
+ * @param operacoes - Recebe o número de operações realizadas
+ */
+static double medirOperacao(OperacaoBench operacao, FilaPecas *fila, PilhaReserva *pilha,
+                            long long *operacoes) {
+    int n = fila->limite;
+    int m = pilha->capacidade;
+    long long blocos;
+    uint64_t soma = 0;
+    double inicio = tempoAtual();
+    
+    switch (operacao) {
+        case BENCH_FILA_ADICIONAR:
+            blocos = OPS_POR_MEDIDA / n + 1;
+            for (long long b = 0; b < blocos; b++) {
+                fila->tamanho = 0;               // Esvazia sem tocar nas peças
+                fila->frente = fila->tras;
+                fila->hash = 0;
+                fila->potencia = 1;
+                for (int i = 0; i < n; i++) {
+                    adicionarPecaNaFila(fila);
+                }
+                soma += fila->tras;
+            }
+            *operacoes = blocos * n;
+            break;
+            
+        case BENCH_FILA_REMOVER: {
+            FilaPecas cheia = *fila;
+            blocos = OPS_POR_MEDIDA / n + 1;
+            for (long long b = 0; b < blocos; b++) {
+                for (int i = 0; i < n; i++) {
+                    soma += (uint64_t)idPeca(removerDaFila(fila));
+                }
+                *fila = cheia;  // Devolve as peças
+            }
+            *operacoes = blocos * n;
+            break;
+        }
+            
+        case BENCH_PILHA_EMPILHAR:
+            blocos = OPS_POR_MEDIDA / m + 1;
+            for (long long b = 0; b < blocos; b++) {
+                inicializarPilha(pilha, pilha->pecas, m);
+                for (int i = 0; i < m; i++) {
+                    empilharPeca(pilha, fila->pecas[i & fila->mascara]);
+                }
+                soma += (uint64_t)pilha->topo;
+            }
+            *operacoes = blocos * m;
+            break;
+            
+        case BENCH_PILHA_DESEMPILHAR: {
+            PilhaReserva cheia = *pilha;
+            blocos = OPS_POR_MEDIDA / m + 1;
+            for (long long b = 0; b < blocos; b++) {
+                *pilha = cheia;
+                for (int i = 0; i < m; i++) {
+                    soma += (uint64_t)idPeca(desempilharPeca(pilha));
+                }
+            }
+            *pilha = cheia;
+            *operacoes = blocos * m;
+            break;
+        }
+            
+        case BENCH_TROCAR_ATUAL:
+            for (long long i = 0; i < OPS_POR_MEDIDA; i++) {
+                soma += operacaoTrocarAtual(fila, pilha);
+            }
+            *operacoes = OPS_POR_MEDIDA;
+            break;
+            
+        case BENCH_TROCAR_MULTIPLA:
+            for (long long i = 0; i < OPS_POR_MEDIDA; i++) {
+                soma += operacaoTrocarMultipla(fila, pilha);
+            }
+            *operacoes = OPS_POR_MEDIDA;
+            break;
+            
+        case BENCH_TROCAR_PECAS: {
+            // Troca do maior k possível; conta uma operação por peça trocada
+            int k = n < m ? n : m;
+            blocos = OPS_POR_MEDIDA / k + 1;
+            for (long long b = 0; b < blocos; b++) {
+                soma += operacaoTrocarPecas(fila, pilha, k);
+            }
+            *operacoes = blocos * k;
+            break;
+        }
+            
+        case BENCH_COLOCAR_PECA: {
+            // Peças da fila, em ciclo, na colocação padrão de um tabuleiro 10x20
+            Tabuleiro tabuleiro;
+            inicializarTabuleiro(&tabuleiro, LARGURA_TABULEIRO, ALTURA_TABULEIRO);
+            for (long long i = 0; i < OPS_POR_MEDIDA; i++) {
+                int tipo = tipoPeca(fila->pecas[i & fila->mascara]);
+                int rotacao;
+                int coluna = escolherColocacaoPadrao(&tabuleiro, tipo, &rotacao);
+                colocarPeca(&tabuleiro, tipo, rotacao, coluna, NULL);
+            }
+            soma += (uint64_t)tabuleiro.linhasEliminadas;
+            *operacoes = OPS_POR_MEDIDA;
+            break;
+        }
+            
+        default:
+            *operacoes = 0;
+            break;
+    }
+    
+    double segundos = tempoAtual() - inicio;
+    sumidouroBench += soma;
+    return segundos;
+}
+
+/**
+ * Modo benchmark: mede ns/op e ops/s de cada primitiva para vários tamanhos
+ * de fila e de pilha e imprime o resultado em CSV ou JSON
+ * @param formato - BENCH_CSV ou BENCH_JSON
+ * @param semente - Semente do gerador das filas medidas
+ * @return int - Código de saída do programa
+ */
+int executarModoBench(FormatoBench formato, uint64_t semente) {
+    const int tamanhosFila[] = {5, 16, 256, 1024};
+    const int tamanhosPilha[] = {3, 64, 1024};
+    const int numFilas = sizeof(tamanhosFila) / sizeof(tamanhosFila[0]);
+    const int numPilhas = sizeof(tamanhosPilha) / sizeof(tamanhosPilha[0]);
+    int primeiro = 1;
+    
+    if (formato == BENCH_CSV) {
+        printf("operacao,tamanho_fila,capacidade_pilha,operacoes,ns_por_op,ops_por_segundo\n");
+    } else {
+        printf("[\n");
+    }
+    
+    for (int op = 0; op < NUM_BENCH; op++) {
+        for (int f = 0; f < numFilas; f++) {
+            for (int p = 0; p < numPilhas; p++) {
+                // Operações só de fila não dependem da pilha (e vice-versa)
+                if ((op == BENCH_FILA_ADICIONAR || op == BENCH_FILA_REMOVER) && p > 0) continue;
+                if ((op == BENCH_PILHA_EMPILHAR || op == BENCH_PILHA_DESEMPILHAR) && f > 0) continue;
+                if (op == BENCH_COLOCAR_PECA && (f > 0 || p > 0)) continue;
+                
+                GeradorPecas gerador;
+                FilaPecas fila;
+                PilhaReserva pilha;
+                Peca *reserva = malloc((size_t)tamanhosPilha[p] * sizeof(Peca));
+                
+                inicializarGerador(&gerador, semente, GERADOR_ALEATORIO);
+                if (reserva == NULL || !inicializarFila(&fila, tamanhosFila[f], &gerador)) {
+                    free(reserva);
+                    fprintf(stderr, "❌ Erro: memória insuficiente para o benchmark.\n");
+                    return 1;
+                }
+                
+                // Pilha cheia com peças novas
+                inicializarPilha(&pilha, reserva, tamanhosPilha[p]);
+                for (int i = 0; i < tamanhosPilha[p]; i++) {
+                    empilharPeca(&pilha, gerarPeca(&gerador, -1 - i));
+                }
+                
+                double melhor = 0;
+                long long operacoes = 0;
+                for (int r = 0; r < REPETICOES_BENCH; r++) {
+                    double segundos = medirOperacao((OperacaoBench)op, &fila, &pilha, &operacoes);
+                    if (r == 0 || segundos < melhor) {
+                        melhor = segundos;
+                    }
+                }
+                
+                double nsPorOp = melhor * 1e9 / operacoes;
+                double opsPorSegundo = melhor > 0 ? operacoes / melhor : 0;
+                int colunaFila = (op == BENCH_PILHA_EMPILHAR || op == BENCH_PILHA_DESEMPILHAR ||
+                                  op == BENCH_COLOCAR_PECA) ? 0 : tamanhosFila[f];
+                int colunaPilha = (op == BENCH_FILA_ADICIONAR || op == BENCH_FILA_REMOVER ||
+                                   op == BENCH_COLOCAR_PECA) ? 0 : tamanhosPilha[p];
+                
+                if (formato == BENCH_CSV) {
+                    printf("%s,%d,%d,%lld,%.3f,%.0f\n", NOMES_BENCH[op], colunaFila, colunaPilha,
+                           operacoes, nsPorOp, opsPorSegundo);
+                } else {
+                    printf("%s  {\"operacao\": \"%s\", \"tamanho_fila\": %d, \"capacidade_pilha\": %d, "
+                           "\"operacoes\": %lld, \"ns_por_op\": %.3f, \"ops_por_segundo\": %.0f}",
+                           primeiro ? "" : ",\n", NOMES_BENCH[op], colunaFila, colunaPilha,
+                           operacoes, nsPorOp, opsPorSegundo);
+                }
+                primeiro = 0;
+                fflush(stdout);
+                
+                liberarFila(&fila);
+                free(reserva);
+            }
+        }
+    }
+    
+    if (formato == BENCH_JSON) {
+        printf("\n]\n");
+    }
+    return 0;
+}
+
+/**
+ * Função principal do programa
+ */
+int main(int argc, char *argv[]) {
+    FilaPecas fila;
+    PilhaReserva pilha;
+    GeradorPecas gerador;
+    static CanalPecas canal;
+    Arena arenaPartida;
+    Tabuleiro tabuleiro;
+    Tabuleiro *tabuleiroAtivo = NULL;
+    
+    ConfiguracaoJogo config = {
+        .limiteFila = TAMANHO_FILA,
+        .capacidadePilha = TAMANHO_PILHA,
+        .modoGerador = GERADOR_ALEATORIO,
+        .semente = (uint64_t)time(NULL),
+        .larguraTabuleiro = 0,
+        .alturaTabuleiro = 0,
+        .pecasTroca = PECAS_TROCA_MULTIPLA
+    };
+    const char *arquivoLote = NULL;
+    int modoLote = 0;
+    int numSessoes = 0;
+    int numThreads = 0;
+    int sessoesInformadas = 0;
+    int threadsInformadas = 0;
+    int trocaInformada = 0;
+    int profundidadeInformada = 0;
+    int orcamentoInformado = 0;
+    int registroInformado = 0;
+    int historicoInformado = 0;
+    const char *linhasIniciais = NULL;
+    long long acoesPorSessao = 1000;
+    int usarProdutor = 0;
+    const char *arquivoRegistro = NULL;
+    const char *arquivoReplay = NULL;
+    const char *arquivoDestino = NULL;
+    const char *arquivoMetricas = NULL;
+    const char *enderecoServidor = NULL;
+    int usarAnelIO = 0;
+    int servidorTexto = 0;
+    const char *arquivoBusca = NULL;
+    long long acaoBuscada = 0;
+    long long intervaloFotos = INTERVALO_FOTOS;
+    const char *arquivoSalvar = NULL;
+    const char *arquivoRestaurar = NULL;
+    int capacidadeHistorico = CAPACIDADE_HISTORICO;
+    Historico historico;
+    Historico *historicoAtivo = NULL;
+    static RegistroEventos registro;
+    RegistroEventos *registroAtivo = NULL;
+    int modoDiferencial = 1;
+    int modoBench = 0;
+    long long decisoesBot = 0;
+    ConfiguracaoBusca configBusca;
+    configuracaoBuscaPadrao(&configBusca);
+    FormatoBench formatoBench = BENCH_CSV;
+    
+    // Opções de linha de comando
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc) {
+            config.semente = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--fila") == 0 && i + 1 < argc) {
+            config.limiteFila = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--servidor") == 0 && i + 1 < argc) {
+            enderecoServidor = argv[++i];
+        } else if (strcmp(argv[i], "--texto") == 0) {
+            servidorTexto = 1;
+        } else if (strcmp(argv[i], "--io-uring") == 0) {
+            usarAnelIO = 1;
+        } else if (strcmp(argv[i], "--metricas") == 0 && i + 1 < argc) {
+            arquivoMetricas = argv[++i];
+        } else if (strcmp(argv[i], "--pilha") == 0 && i + 1 < argc) {
+            config.capacidadePilha = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--troca") == 0 && i + 1 < argc) {
+            config.pecasTroca = atoi(argv[++i]);
+            trocaInformada = 1;
+        } else if (strcmp(argv[i], "--gerador") == 0 && i + 1 < argc) {
+            const char *nome = argv[++i];
+            if (strcmp(nome, "aleatorio") == 0) {
+                config.modoGerador = GERADOR_ALEATORIO;
+            } else if (strcmp(nome, "sacola4") == 0) {
+                config.modoGerador = GERADOR_SACOLA_4;
+            } else if (strcmp(nome, "sacola7") == 0) {
+                config.modoGerador = GERADOR_SACOLA_7;
+            } else {
+                fprintf(stderr, "❌ Erro: gerador desconhecido '%s' (use aleatorio, sacola4 ou sacola7).\n", nome);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--sessoes") == 0 && i + 1 < argc) {
+            numSessoes = atoi(argv[++i]);
+            sessoesInformadas = 1;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            numThreads = atoi(argv[++i]);
+            threadsInformadas = 1;
+        } else if (strcmp(argv[i], "--acoes") == 0 && i + 1 < argc) {
+            acoesPorSessao = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            modoBench = 1;
+            // Formato opcional: csv (padrão) ou json
+            if (i + 1 < argc && strcmp(argv[i + 1], "json") == 0) {
+                formatoBench = BENCH_JSON;
+                i++;
+            } else if (i + 1 < argc && strcmp(argv[i + 1], "csv") == 0) {
+                i++;
+            }
+        } else if (strcmp(argv[i], "--tabuleiro") == 0) {
+            config.larguraTabuleiro = LARGURA_TABULEIRO;
+            config.alturaTabuleiro = ALTURA_TABULEIRO;
+            // Dimensões opcionais no formato LxA (ex.: 10x20)
+            if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) {
+                if (sscanf(argv[++i], "%dx%d", &config.larguraTabuleiro, &config.alturaTabuleiro) != 2) {
+                    config.larguraTabuleiro = -1;
+                }
+            }
+        } else if (strcmp(argv[i], "--bot") == 0 && i + 1 < argc) {
+            decisoesBot = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--profundidade") == 0 && i + 1 < argc) {
+            configBusca.profundidade = atoi(argv[++i]);
+            profundidadeInformada = 1;
+        } else if (strcmp(argv[i], "--orcamento") == 0 && i + 1 < argc) {
+            configBusca.orcamentoSegundos = atof(argv[++i]) / 1000.0;  // Em milissegundos
+            orcamentoInformado = 1;
+        } else if (strcmp(argv[i], "--linhas") == 0 && i + 1 < argc) {
+            linhasIniciais = argv[++i];
+        } else if (strcmp(argv[i], "--registro") == 0 && i + 1 < argc) {
+            arquivoRegistro = argv[++i];
+            registroInformado = 1;
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            arquivoReplay = argv[++i];
+        } else if (strcmp(argv[i], "--arquivar") == 0 && i + 2 < argc) {
+            arquivoRegistro = argv[++i];
+            arquivoDestino = argv[++i];
+        } else if (strcmp(argv[i], "--intervalo") == 0 && i + 1 < argc) {
+            intervaloFotos = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--buscar") == 0 && i + 2 < argc) {
+            arquivoBusca = argv[++i];
+            acaoBuscada = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--salvar") == 0 && i + 1 < argc) {
+            arquivoSalvar = argv[++i];
+        } else if (strcmp(argv[i], "--restaurar") == 0 && i + 1 < argc) {
+            arquivoRestaurar = argv[++i];
+        } else if (strcmp(argv[i], "--historico") == 0 && i + 1 < argc) {
+            capacidadeHistorico = atoi(argv[++i]);
+            historicoInformado = 1;
+        } else if (strcmp(argv[i], "--sem-diferencial") == 0) {
+            modoDiferencial = 0;
+        } else if (strcmp(argv[i], "--produtor") == 0) {
+            usarProdutor = 1;
+        } else if (strcmp(argv[i], "--lote") == 0) {
+            modoLote = 1;
+            // Arquivo opcional: sem arquivo ou "-" lê stdin
+            if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) {
+                arquivoLote = argv[++i];
+            }
+        } else {
+            fprintf(stderr, "❌ Erro: opção desconhecida '%s'.\n", argv[i]);
+            return 1;
+        }
+    }
+    
+    if (config.limiteFila < 1 || config.limiteFila > TAMANHO_MAXIMO_FILA) {
+        fprintf(stderr, "❌ Erro: tamanho de fila inválido (use 1 a %d).\n", TAMANHO_MAXIMO_FILA);
+        return 1;
+    }
+    if (config.capacidadePilha < 1 || config.capacidadePilha > CAPACIDADE_MAXIMA_PILHA) {
+        fprintf(stderr, "❌ Erro: capacidade de pilha inválida (use 1 a %d).\n", CAPACIDADE_MAXIMA_PILHA);
+        return 1;
+    }
+    // Sem --troca vale o padrão, mesmo que a fila ou a pilha sejam menores
+    // (a ação 5 só falha); com --troca, k precisa caber nas duas
+    if (trocaInformada && (config.pecasTroca < 1 || config.pecasTroca > config.limiteFila ||
+                           config.pecasTroca > config.capacidadePilha)) {
+        fprintf(stderr, "❌ Erro: peças da troca inválidas (use 1 até o tamanho da fila e da pilha).\n");
+        return 1;
+    }
+    // 0 é "sem a opção" só quando ela não foi dada
+    if (threadsInformadas && (numThreads < 1 || numThreads > MAX_THREADS)) {
+        fprintf(stderr, "❌ Erro: número de threads inválido (use 1 a %d).\n", MAX_THREADS);
+        return 1;
+    }
+    if (sessoesInformadas && numSessoes < 1) {
+        fprintf(stderr, "❌ Erro: número de sessões inválido (use 1 ou mais).\n");
+        return 1;
+    }
+    if (config.larguraTabuleiro != 0 &&
+        !inicializarTabuleiro(&tabuleiro, config.larguraTabuleiro, config.alturaTabuleiro)) {
+        fprintf(stderr, "❌ Erro: tabuleiro inválido (use LxA com largura 4 a %d e altura 4 a %d).\n",
+                LARGURA_MAXIMA_TABULEIRO, ALTURA_MAXIMA_TABULEIRO);
+        return 1;
+    }
+    if (config.larguraTabuleiro != 0) {
+        tabuleiroAtivo = &tabuleiro;
+    }
+    
+    // O registro começa na semente, e o gerador da thread produtora fica
+    // adiantado em relação às peças já usadas
+    if (arquivoRestaurar != NULL && arquivoRegistro != NULL) {
+        fprintf(stderr, "❌ Erro: --registro não pode ser usado com --restaurar.\n");
+        return 1;
+    }
+    if (arquivoSalvar != NULL && usarProdutor) {
+        fprintf(stderr, "❌ Erro: --salvar não pode ser usado com --produtor.\n");
+        return 1;
+    }
+    
+    // As métricas medem o menu interativo e o servidor; os outros modos
+    // (na mesma ordem de escolha abaixo) imprimem os próprios totais
+    int modoComMetricas = arquivoReplay == NULL && arquivoDestino == NULL && arquivoBusca == NULL &&
+                          !modoBench &&
+                          (enderecoServidor != NULL || (decisoesBot <= 0 && numThreads <= 0 && !modoLote));
+    if (arquivoMetricas != NULL && !modoComMetricas) {
+        fprintf(stderr, "❌ Erro: --metricas só funciona no modo interativo e no servidor.\n");
+        return 1;
+    }
+    
+    // A tabela de sessões só existe no servidor, na simulação e no lote
+    int modoComSessoes = arquivoReplay == NULL && arquivoDestino == NULL && arquivoBusca == NULL &&
+                         !modoBench &&
+                         (enderecoServidor != NULL || (decisoesBot <= 0 && (numThreads > 0 || modoLote)));
+    if (sessoesInformadas && !modoComSessoes) {
+        fprintf(stderr, "❌ Erro: --sessoes só funciona com --lote, --threads e --servidor.\n");
+        return 1;
+    }
+    
+    int modoBot = arquivoReplay == NULL && arquivoDestino == NULL && arquivoBusca == NULL &&
+                  !modoBench && enderecoServidor == NULL && decisoesBot > 0;
+    if (linhasIniciais != NULL && !modoBot) {
+        fprintf(stderr, "❌ Erro: --linhas só funciona com --bot.\n");
+        return 1;
+    }
+    
+    // Estado salvo: partida interativa, lote e simulação. No servidor cada
+    // partida vive só enquanto a conexão dela (a próxima conexão reinicia a
+    // sessão), então não há o que salvar nem onde retomar.
+    int modoComEstadoSalvo = arquivoReplay == NULL && arquivoDestino == NULL && arquivoBusca == NULL &&
+                             !modoBench && enderecoServidor == NULL && decisoesBot <= 0;
+    if ((arquivoSalvar != NULL || arquivoRestaurar != NULL) && !modoComEstadoSalvo) {
+        fprintf(stderr, "❌ Erro: --salvar e --restaurar só funcionam no modo interativo, em lote e na simulação.\n");
+        return 1;
+    }
+    
+    // Registro e thread produtora: só a partida única do modo interativo e
+    // do lote (sem --sessoes); --arquivar também usa arquivoRegistro, mas
+    // como entrada
+    int modoPartidaUnica = arquivoReplay == NULL && arquivoDestino == NULL && arquivoBusca == NULL &&
+                           !modoBench && enderecoServidor == NULL && decisoesBot <= 0 &&
+                           numThreads <= 0 && numSessoes <= 0;
+    if (registroInformado && !modoPartidaUnica) {
+        fprintf(stderr, "❌ Erro: --registro só funciona no modo interativo e em lote sem --sessoes.\n");
+        return 1;
+    }
+    if (usarProdutor && !modoPartidaUnica) {
+        fprintf(stderr, "❌ Erro: --produtor só funciona no modo interativo e em lote sem --sessoes.\n");
+        return 1;
+    }
+    
+    // Desfazer e refazer só existem no menu interativo
+    if (historicoInformado && (!modoPartidaUnica || modoLote)) {
+        fprintf(stderr, "❌ Erro: --historico só funciona no modo interativo.\n");
+        return 1;
+    }
+    if (capacidadeHistorico < 0 || capacidadeHistorico > HISTORICO_MAXIMO) {
+        fprintf(stderr, "❌ Erro: histórico inválido (use 0 a %d ações).\n", HISTORICO_MAXIMO);
+        return 1;
+    }
+    
+    // Replay: ./tetris_mestre --replay arquivo (a partida vem do cabeçalho)
+    if (arquivoReplay != NULL) {
+        return executarReplay(arquivoReplay);
+    }
+    
+    // Arquivo de replay: ./tetris_mestre --arquivar registro arquivo [--intervalo K]
+    if (arquivoDestino != NULL) {
+        if (intervaloFotos < 1 || intervaloFotos > UINT32_MAX) {
+            fprintf(stderr, "❌ Erro: intervalo entre fotos inválido.\n");
+            return 1;
+        }
+        return criarArquivoReplay(arquivoRegistro, arquivoDestino, (uint32_t)intervaloFotos);
+    }
+    
+    // Busca no arquivo: ./tetris_mestre --buscar arquivo N
+    if (arquivoBusca != NULL) {
+        if (acaoBuscada < 0) {
+            fprintf(stderr, "❌ Erro: ação inválida.\n");
+            return 1;
+        }
+        return executarBuscaReplay(arquivoBusca, (uint64_t)acaoBuscada);
+    }
+    
+    // Benchmarks: ./tetris_mestre --bench [csv|json]
+    if (modoBench) {
+        return executarModoBench(formatoBench, config.semente);
+    }
+    
+    // Servidor: ./tetris_mestre --servidor porta|caminho [--sessoes N] [--tabuleiro] [--io-uring] [--texto]
+    if (enderecoServidor != NULL) {
+        TabelaSessoes tabela;
+        if (!prepararTabela(&tabela, numSessoes > 0 ? numSessoes : SESSOES_SERVIDOR, &config, NULL)) {
+            return 1;
+        }
+        if (arquivoMetricas != NULL && !ativarMetricas(arquivoMetricas)) {
+            fprintf(stderr, "❌ Erro: memória insuficiente para as métricas.\n");
+        }
+        int codigo = executarModoServidor(&tabela, enderecoServidor, config.semente, usarAnelIO, servidorTexto);
+        if (!encerrarMetricas()) {
+            fprintf(stderr, "❌ Erro: falha ao gravar '%s'.\n", arquivoMetricas);
+            codigo = 1;
+        }
+        liberarTabelaSessoes(&tabela);
+        return codigo;
+    }
+    
+    // Bot: ./tetris_mestre --bot N [--profundidade P] [--orcamento MS] [--threads T]
+    if (decisoesBot > 0) {
+        if (configBusca.profundidade < 1 || configBusca.profundidade > MAX_PROFUNDIDADE_BUSCA) {
+            fprintf(stderr, "❌ Erro: profundidade inválida (use 1 a %d).\n", MAX_PROFUNDIDADE_BUSCA);
+            return 1;
+        }
+        if (tabuleiroAtivo == NULL) {
+            inicializarTabuleiro(&tabuleiro, LARGURA_TABULEIRO, ALTURA_TABULEIRO);
+            tabuleiroAtivo = &tabuleiro;
+        }
+        configBusca.numThreads = numThreads > 0 ? numThreads : 1;
+        // A profundidade pedida é respeitada, a menos que venha um orçamento
+        if (profundidadeInformada && !orcamentoInformado) {
+            configBusca.orcamentoSegundos = 0;
+        }
+        if (linhasIniciais != NULL && !preencherLinhas(tabuleiroAtivo, linhasIniciais)) {
+            fprintf(stderr, "❌ Erro: linhas iniciais inválidas (máscaras separadas por vírgula, "
+                    "sem linhas cheias, até a altura do tabuleiro).\n");
+            return 1;
+        }
+        
+        if (!prepararPartida(&config, &gerador, &fila, &pilha, &arenaPartida, &tabuleiro, &tabuleiroAtivo,
+                             NULL)) {
+            return 1;
+        }
+        int codigo = executarModoBot(&fila, &pilha, tabuleiroAtivo, &configBusca, decisoesBot);
+        liberarFila(&fila);
+        liberarArena(&arenaPartida);
+        return codigo;
+    }
+    
+    // Simulação paralela: ./tetris_mestre --threads T [--sessoes N] [--acoes K]
+    if (numThreads > 0) {
+        TabelaSessoes tabela;
+        if (numSessoes <= 0) {
+            numSessoes = 10000;
+        }
+        if (!prepararTabela(&tabela, numSessoes, &config, arquivoRestaurar)) {
+            return 1;
+        }
+        int codigo = executarModoSimulacao(&tabela, numThreads, acoesPorSessao, config.semente);
+        if (arquivoSalvar != NULL && !salvarTabelaComAviso(&tabela, &config, arquivoSalvar)) {
+            codigo = 1;
+        }
+        liberarTabelaSessoes(&tabela);
+        return codigo;
+    }
+    
+    // Modo em lote: ./tetris_mestre --lote [arquivo] [--semente N] [--sessoes N] [--tabuleiro]
+    if (modoLote) {
+        static LeitorComandos leitor;
+        leitor.arquivo = stdin;
+        if (arquivoLote != NULL && strcmp(arquivoLote, "-") != 0) {
+            leitor.arquivo = fopen(arquivoLote, "rb");
+            if (leitor.arquivo == NULL) {
+                fprintf(stderr, "❌ Erro: não foi possível abrir '%s'.\n", arquivoLote);
+                return 1;
+            }
+        }
+        
+        int codigo = 1;
+        if (numSessoes > 0) {
+            TabelaSessoes tabela;
+            if (prepararTabela(&tabela, numSessoes, &config, arquivoRestaurar)) {
+                codigo = executarModoLoteSessoes(&leitor, &tabela);
+                if (arquivoSalvar != NULL && !salvarTabelaComAviso(&tabela, &config, arquivoSalvar)) {
+                    codigo = 1;
+                }
+                liberarTabelaSessoes(&tabela);
+            }
+        } else {
+            if (prepararPartida(&config, &gerador, &fila, &pilha, &arenaPartida,
+                                &tabuleiro, &tabuleiroAtivo, arquivoRestaurar)) {
+                if (usarProdutor && !iniciarCanalPecas(&canal, &gerador)) {
+                    fprintf(stderr, "❌ Erro: não foi possível iniciar a thread produtora.\n");
+                    usarProdutor = 0;
+                }
+                if (arquivoRegistro != NULL) {
+                    if (abrirRegistro(&registro, arquivoRegistro, &config, &fila)) {
+                        registroAtivo = &registro;
+                    } else {
+                        fprintf(stderr, "❌ Erro: não foi possível criar '%s'.\n", arquivoRegistro);
+                    }
+                }
+                codigo = executarModoLote(&leitor, &fila, &pilha, tabuleiroAtivo, registroAtivo);
+                if (arquivoSalvar != NULL) {
+                    if (salvarPartida(arquivoSalvar, &config, &fila, &pilha, tabuleiroAtivo)) {
+                        fprintf(stderr, "✓ Partida salva em '%s'.\n", arquivoSalvar);
+                    } else {
+                        fprintf(stderr, "❌ Erro: falha ao gravar '%s'.\n", arquivoSalvar);
+                        codigo = 1;
+                    }
+                }
+                if (registroAtivo != NULL && !fecharRegistro(registroAtivo, &fila, &pilha, tabuleiroAtivo)) {
+                    fprintf(stderr, "❌ Erro: falha ao gravar '%s'.\n", arquivoRegistro);
+                    codigo = 1;
+                }
+                if (usarProdutor) {
+                    encerrarCanalPecas(&canal, &gerador);
+                }
+                liberarFila(&fila);
+                liberarArena(&arenaPartida);
+            }
+        }
+        
+        if (leitor.arquivo != stdin) {
+            fclose(leitor.arquivo);
+        }
+        return codigo;
+    }
+    
+    // Inicializa a fila com peças e a pilha vazia (ou restaura a partida salva)
+    if (!prepararPartida(&config, &gerador, &fila, &pilha, &arenaPartida, &tabuleiro, &tabuleiroAtivo,
+                         arquivoRestaurar)) {
+        return 1;
+    }
+    
+    // Com --produtor as próximas peças são sorteadas por outra thread
+    if (usarProdutor && !iniciarCanalPecas(&canal, &gerador)) {
+        fprintf(stderr, "❌ Erro: não foi possível iniciar a thread produtora.\n");
+        usarProdutor = 0;
+    }
+    
+    if (arquivoRegistro != NULL) {
+        if (abrirRegistro(&registro, arquivoRegistro, &config, &fila)) {
+            registroAtivo = &registro;
+        } else {
+            fprintf(stderr, "❌ Erro: não foi possível criar '%s'.\n", arquivoRegistro);
+        }
+    }
+    
+    // Desfazer precisa do gerador local (sem produtor) e não cabe no registro
+    if (capacidadeHistorico > 0 && !usarProdutor && registroAtivo == NULL) {
+        if (criarHistorico(&historico, capacidadeHistorico)) {
+            historicoAtivo = &historico;
+        } else {
+            fprintf(stderr, "❌ Erro: não há memória para o histórico.\n");
+        }
+    }
+    
+    // Sem terminal (entrada ou saída redirecionada) os quadros saem inteiros,
+    // um após o outro, com o mesmo texto de sempre
+    Renderizador tela;
+    inicializarRenderizador(&tela, modoDiferencial && isatty(STDOUT_FILENO));
+    
+    if (arquivoMetricas != NULL && !ativarMetricas(arquivoMetricas)) {
+        fprintf(stderr, "❌ Erro: memória insuficiente para as métricas.\n");
+    }
+    
+    // Loop principal do programa: a partida consome o que chegar na entrada
+    // e entrega um quadro por opção
+    PartidaInterativa partida;
+    char entrada[4096];
+    size_t lidos;
+    iniciarPartidaInterativa(&partida, &fila, &pilha, tabuleiroAtivo, historicoAtivo, registroAtivo,
+                             &tela, escreverNoTerminal, NULL);
+    while (!partida.encerrada && (lidos = lerEntrada(entrada, sizeof(entrada))) > 0) {
+        retomarPartida(&partida, entrada, lidos);
+    }
+    
+    // Fim da entrada equivale a sair
+    encerrarEntradaPartida(&partida);
+    liberarRenderizador(&tela);
+    
+    if (registroAtivo != NULL && !fecharRegistro(registroAtivo, &fila, &pilha, tabuleiroAtivo)) {
+        fprintf(stderr, "❌ Erro: falha ao gravar '%s'.\n", arquivoRegistro);
+    }
+    if (arquivoSalvar != NULL && !salvarPartida(arquivoSalvar, &config, &fila, &pilha, tabuleiroAtivo)) {
+        fprintf(stderr, "❌ Erro: falha ao gravar '%s'.\n", arquivoSalvar);
+    }
+    if (usarProdutor) {
+        encerrarCanalPecas(&canal, &gerador);
+    }
+    if (!encerrarMetricas()) {
+        fprintf(stderr, "❌ Erro: falha ao gravar '%s'.\n", arquivoMetricas);
+    }
+    if (historicoAtivo != NULL) {
+        liberarHistorico(historicoAtivo);
+    }
+    liberarFila(&fila);
+    liberarArena(&arenaPartida);
     return 0;
 }
\ No newline at end of file
@@ -1,95 +1,25 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include "tetris_nucleo.h"
 
 #define TAMANHO_FILA 5
 
-// Estrutura que representa uma peça do Tetris
-typedef struct {
-    char nome;  // Tipo da peça: 'I', 'O', 'T', 'L'
-    int id;     // Identificador único da peça
-} Peca;
-
-// Estrutura que representa a fila circular de peças
-typedef struct {
-    Peca pecas[TAMANHO_FILA];  // Array de peças
-    int frente;                 // Índice da frente da fila
-    int tras;                   // Índice do final da fila
-    int tamanho;                // Quantidade atual de peças na fila
-    int proximoId;              // Próximo ID a ser atribuído
-} FilaPecas;
-
-/**
- * Gera uma peça aleatória com um ID único
- * @param id - Identificador único para a peça
- * @return Peca - Nova peça gerada
- */
-Peca gerarPeca(int id) {
-    Peca novaPeca;
-    char tipos[] = {'I', 'O', 'T', 'L'};
-    
-    // Seleciona um tipo aleatório
-    novaPeca.nome = tipos[rand() % 4];
-    novaPeca.id = id;
-    
-    return novaPeca;
-}
-
-/**
- * Inicializa a fila de peças com elementos iniciais
- * @param fila - Ponteiro para a estrutura da fila
- */
-void inicializarFila(FilaPecas *fila) {
-    fila->frente = 0;
-    fila->tras = 0;
-    fila->tamanho = 0;
-    fila->proximoId = 0;
-    
-    // Preenche a fila com peças iniciais
-    for (int i = 0; i < TAMANHO_FILA; i++) {
-        fila->pecas[i] = gerarPeca(fila->proximoId);
-        fila->proximoId++;
-        fila->tamanho++;
-        fila->tras = (fila->tras + 1) % TAMANHO_FILA;
-    }
-}
-
-/**
- * Verifica se a fila está vazia
- * @param fila - Ponteiro para a estrutura da fila
- * @return int - 1 se vazia, 0 caso contrário
- */
-int filaVazia(FilaPecas *fila) {
-    return fila->tamanho == 0;
-}
-
 /**
- * Verifica se a fila está cheia
+ * Remove uma peça da frente da fila (dequeue), sem repor outra
  * @param fila - Ponteiro para a estrutura da fila
- * @return int - 1 se cheia, 0 caso contrário
- */
-int filaCheia(FilaPecas *fila) {
-    return fila->tamanho == TAMANHO_FILA;
-}
-
-/**
- * Remove uma peça da frente da fila (dequeue)
- * @param fila - Ponteiro para a estrutura da fila
- * @return Peca - Peça removida
+ * @return Peca - Peça removida (id -1 se a fila estava vazia)
  */
 Peca jogarPeca(FilaPecas *fila) {
     if (filaVazia(fila)) {
         printf("\n❌ Erro: A fila está vazia!\n");
-        Peca pecaVazia = {' ', -1};
-        return pecaVazia;
+        return criarPeca(0, (IdPeca)-1);
     }
     
     // Remove a peça da frente
-    Peca pecaJogada = fila->pecas[fila->frente];
-    fila->frente = (fila->frente + 1) % TAMANHO_FILA;
-    fila->tamanho--;
+    Peca pecaJogada = removerDaFila(fila);
     
-    printf("\n✓ Peça [%c %d] jogada com sucesso!\n", pecaJogada.nome, pecaJogada.id);
+    printf("\n✓ Peça " FORMATO_PECA " jogada com sucesso!\n", ARGS_PECA(pecaJogada));
     return pecaJogada;
 }
 
@@ -104,13 +34,10 @@ void inserirPeca(FilaPecas *fila) {
     }
     
     // Gera e insere nova peça no final
-    Peca novaPeca = gerarPeca(fila->proximoId);
-    fila->pecas[fila->tras] = novaPeca;
-    fila->tras = (fila->tras + 1) % TAMANHO_FILA;
-    fila->tamanho++;
-    fila->proximoId++;
+    adicionarPecaNaFila(fila);
+    Peca novaPeca = ultimaPecaDaFila(fila);
     
-    printf("\n✓ Nova peça [%c %d] inserida com sucesso!\n", novaPeca.nome, novaPeca.id);
+    printf("\n✓ Nova peça " FORMATO_PECA " inserida com sucesso!\n", ARGS_PECA(novaPeca));
 }
 
 /**
@@ -126,8 +53,8 @@ void exibirFila(FilaPecas *fila) {
     } else {
         int indice = fila->frente;
         for (int i = 0; i < fila->tamanho; i++) {
-            printf("[%c %d] ", fila->pecas[indice].nome, fila->pecas[indice].id);
-            indice = (indice + 1) % TAMANHO_FILA;
+            printf(FORMATO_PECA " ", ARGS_PECA(fila->pecas[indice]));
+            indice = (indice + 1) & fila->mascara;
         }
     }
     
@@ -151,15 +78,20 @@ void exibirMenu() {
 /**
  * Função principal do programa
  */
-int main() {
+int main(int argc, char *argv[]) {
+    GeradorPecas gerador;
     FilaPecas fila;
     int opcao;
     
-    // Inicializa gerador de números aleatórios
-    srand(time(NULL));
+    // Semente do gerador: argumento opcional, ou o relógio se omitida
+    uint64_t semente = (argc >= 2) ? strtoull(argv[1], NULL, 10) : (uint64_t)time(NULL);
     
-    // Inicializa a fila com peças
-    inicializarFila(&fila);
+    // Inicializa a fila com peças (sorteio independente entre I, O, T, L)
+    inicializarGerador(&gerador, semente, GERADOR_ALEATORIO);
+    if (!inicializarFila(&fila, TAMANHO_FILA, &gerador)) {
+        fprintf(stderr, "❌ Erro: memória insuficiente para a fila.\n");
+        return 1;
+    }
     
     printf("╔════════════════════════════════════════╗\n");
     printf("║   BEM-VINDO AO TETRIS STACK!          ║\n");
@@ -199,5 +131,6 @@ int main() {
         
     } while(opcao != 0);
     
+    liberarFila(&fila);
     return 0;
 }
\ No newline at end of file
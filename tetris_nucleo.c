@@ -0,0 +1,338 @@
+// Núcleo do Tetris Stack: as funções que não precisam ficar inline no
+// cabeçalho. Sem E/S; ver tetris_nucleo.h.
+#include <stdlib.h>
+#include <string.h>
+#include "tetris_nucleo.h"
+
+/**
+ * Gera o próximo número de 64 bits do xoshiro256**
+ */
+uint64_t proximoAleatorio(GeradorPecas *gerador) {
+    uint64_t *s = gerador->estado;
+    uint64_t resultado = rotl64(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl64(s[3], 45);
+    
+    return resultado;
+}
+
+/**
+ * Sorteia um inteiro uniforme em [0, limite) sem viés de módulo
+ * (multiplicação de 64 bits com rejeição, método de Lemire)
+ */
+uint32_t aleatorioLimitado(GeradorPecas *gerador, uint32_t limite) {
+    uint64_t m = (proximoAleatorio(gerador) >> 32) * limite;
+    uint32_t baixo = (uint32_t)m;
+    
+    if (baixo < limite) {
+        uint32_t minimo = (uint32_t)(-limite) % limite;
+        while (baixo < minimo) {
+            m = (proximoAleatorio(gerador) >> 32) * limite;
+            baixo = (uint32_t)m;
+        }
+    }
+    return (uint32_t)(m >> 32);
+}
+
+/**
+ * Inicializa o gerador a partir de uma semente. A mesma semente (e o mesmo
+ * modo) produz sempre a mesma sequência de peças.
+ * @param gerador - Ponteiro para o gerador
+ * @param semente - Semente de 64 bits
+ * @param modo - Sorteio independente ou por sacolas
+ */
+void inicializarGerador(GeradorPecas *gerador, uint64_t semente, ModoGerador modo) {
+    for (int i = 0; i < 4; i++) {
+        gerador->estado[i] = splitmix64(&semente);
+    }
+    gerador->modo = modo;
+    gerador->leitura = 0;
+    gerador->escrita = 0;  // Anel vazio: sorteia no primeiro uso
+    gerador->receberTipo = NULL;
+    gerador->fonte = NULL;
+}
+
+/**
+ * Escreve no anel uma sacola embaralhada (Fisher-Yates) com os primeiros
+ * 'quantidade' tipos de TIPOS_PECA
+ */
+static void escreverSacola(GeradorPecas *gerador, int quantidade) {
+    uint8_t sacola[sizeof(TIPOS_PECA)];
+    
+    for (int i = 0; i < quantidade; i++) {
+        sacola[i] = (uint8_t)i;
+    }
+    for (int i = quantidade - 1; i > 0; i--) {
+        int j = (int)aleatorioLimitado(gerador, (uint32_t)(i + 1));
+        uint8_t temp = sacola[i];
+        sacola[i] = sacola[j];
+        sacola[j] = temp;
+    }
+    for (int i = 0; i < quantidade; i++) {
+        gerador->tipos[gerador->escrita++ & (TAMANHO_BUFFER_TIPOS - 1)] = sacola[i];
+    }
+}
+
+/**
+ * Escreve no anel um lote de 32 tipos independentes com uma única saída de
+ * 64 bits. Como há 4 tipos, cada grupo de 2 bits escolhe um tipo sem viés.
+ */
+static void escreverLoteAleatorio(GeradorPecas *gerador) {
+    uint64_t bits = proximoAleatorio(gerador);
+    for (int i = 0; i < TAMANHO_LOTE_TIPOS; i++) {
+        gerador->tipos[gerador->escrita++ & (TAMANHO_BUFFER_TIPOS - 1)] = (uint8_t)(bits & 3);
+        bits >>= 2;
+    }
+}
+
+/**
+ * Reabastece o anel com blocos inteiros (lotes ou sacolas) enquanto couberem.
+ * Chamado só quando o anel esvazia, então o sorteio sai do caminho de cada peça.
+ */
+void reabastecerTipos(GeradorPecas *gerador) {
+    int bloco = TAMANHO_LOTE_TIPOS;
+    if (gerador->modo == GERADOR_SACOLA_4) bloco = 4;
+    if (gerador->modo == GERADOR_SACOLA_7) bloco = 7;
+    
+    while (TAMANHO_BUFFER_TIPOS - (int)(gerador->escrita - gerador->leitura) >= bloco) {
+        if (gerador->modo == GERADOR_ALEATORIO) {
+            escreverLoteAleatorio(gerador);
+        } else {
+            escreverSacola(gerador, bloco);
+        }
+    }
+}
+
+/**
+ * Gera várias peças de uma vez, com IDs consecutivos
+ * @param destino - Array que recebe as peças
+ * @param quantidade - Número de peças a gerar
+ * @param idInicial - ID da primeira peça
+ */
+void gerarPecasEmLote(GeradorPecas *gerador, Peca *destino, int quantidade, IdPeca idInicial) {
+    for (int i = 0; i < quantidade; i++) {
+        destino[i] = gerarPeca(gerador, idInicial + i);
+    }
+}
+
+/**
+ * Calcula a capacidade do array da fila: a menor potência de 2 >= limite
+ */
+int capacidadeFila(int limite) {
+    int capacidade = 1;
+    while (capacidade < limite) {
+        capacidade <<= 1;
+    }
+    return capacidade;
+}
+
+/**
+ * Recalcula o hash do estado percorrendo a fila e a pilha. Serve para
+ * conferir os hashes incrementais; o jogo nunca precisa dele.
+ */
+uint64_t recalcularHashEstado(const FilaPecas *fila, const PilhaReserva *pilha) {
+    FilaPecas copiaFila = *fila;
+    PilhaReserva copiaPilha = *pilha;
+    uint64_t peso = 1;
+    
+    copiaFila.hash = 0;
+    for (int i = 0; i < fila->tamanho; i++) {
+        copiaFila.hash += chavePeca(fila->pecas[(fila->frente + i) & fila->mascara]) * peso;
+        peso *= BASE_HASH_FILA;
+    }
+    
+    peso = 1;
+    copiaPilha.hash = 0;
+    for (int i = 0; i <= pilha->topo; i++) {
+        copiaPilha.hash += chavePeca(pilha->pecas[i]) * peso;
+        peso *= BASE_HASH_PILHA;
+    }
+    return hashEstado(&copiaFila, &copiaPilha);
+}
+
+/**
+ * Inicializa a fila sobre um array já alocado pelo chamador e a preenche
+ * com as peças iniciais
+ * @param fila - Ponteiro para a estrutura da fila
+ * @param armazenamento - Array com capacidadeFila(limite) posições
+ * @param limite - Quantidade de peças da fila
+ * @param gerador - Gerador (já inicializado) das peças da fila
+ */
+void inicializarFilaEm(FilaPecas *fila, Peca *armazenamento, int limite,
+                       GeradorPecas *gerador) {
+    fila->pecas = armazenamento;
+    fila->mascara = capacidadeFila(limite) - 1;
+    fila->limite = limite;
+    fila->gerador = gerador;
+    
+    // Preenche a fila com peças iniciais
+    gerarPecasEmLote(gerador, fila->pecas, limite, 0);
+    fila->frente = 0;
+    fila->tras = limite & fila->mascara;
+    fila->tamanho = limite;
+    fila->proximoId = limite;
+    
+    // Único ponto em que o hash é calculado percorrendo as peças
+    fila->hash = 0;
+    fila->potencia = 1;
+    for (int i = 0; i < limite; i++) {
+        fila->hash += chavePeca(fila->pecas[i]) * fila->potencia;
+        fila->potencia *= BASE_HASH_FILA;
+    }
+}
+
+/**
+ * Inicializa a fila de peças com elementos iniciais, alocando o array
+ * @param fila - Ponteiro para a estrutura da fila
+ * @param limite - Quantidade de peças da fila (1 a TAMANHO_MAXIMO_FILA)
+ * @param gerador - Gerador (já inicializado) das peças da fila
+ * @return int - 1 em caso de sucesso, 0 se o limite for inválido ou faltar memória
+ */
+int inicializarFila(FilaPecas *fila, int limite, GeradorPecas *gerador) {
+    if (limite < 1 || limite > TAMANHO_MAXIMO_FILA) {
+        return 0;
+    }
+    
+    Peca *armazenamento = malloc((size_t)capacidadeFila(limite) * sizeof(Peca));
+    if (armazenamento == NULL) {
+        return 0;
+    }
+    
+    inicializarFilaEm(fila, armazenamento, limite, gerador);
+    return 1;
+}
+
+/**
+ * Libera o array de peças da fila
+ */
+void liberarFila(FilaPecas *fila) {
+    free(fila->pecas);
+    fila->pecas = NULL;
+}
+
+/**
+ * Inicializa uma arena vazia (nenhum bloco é alocado até o primeiro uso)
+ */
+void inicializarArena(Arena *arena) {
+    arena->atual = NULL;
+    arena->proximoBloco = BLOCO_INICIAL_ARENA;
+    arena->reservado = 0;
+}
+
+/**
+ * Aloca 'tamanho' bytes alinhados da arena
+ * @return void* - Memória válida até liberarArena, ou NULL se faltar memória
+ */
+void *alocarNaArena(Arena *arena, size_t tamanho) {
+    tamanho = (tamanho + ALINHAMENTO_ARENA - 1) & ~(size_t)(ALINHAMENTO_ARENA - 1);
+    BlocoArena *bloco = arena->atual;
+    
+    if (bloco == NULL || bloco->tamanho - bloco->usado < tamanho) {
+        size_t tamanhoBloco = arena->proximoBloco;
+        while (tamanhoBloco < tamanho) {
+            tamanhoBloco *= 2;
+        }
+        bloco = malloc(sizeof(BlocoArena) + tamanhoBloco);
+        if (bloco == NULL) {
+            return NULL;
+        }
+        bloco->anterior = arena->atual;
+        bloco->tamanho = tamanhoBloco;
+        bloco->usado = 0;
+        arena->atual = bloco;
+        arena->reservado += tamanhoBloco;
+        if (arena->proximoBloco < BLOCO_MAXIMO_ARENA) {
+            arena->proximoBloco *= 2;
+        }
+    }
+    
+    void *memoria = bloco->dados + bloco->usado;
+    bloco->usado += tamanho;
+    return memoria;
+}
+
+/**
+ * Libera de uma vez todos os blocos da arena; ela volta a ficar vazia
+ */
+void liberarArena(Arena *arena) {
+    BlocoArena *bloco = arena->atual;
+    while (bloco != NULL) {
+        BlocoArena *anterior = bloco->anterior;
+        free(bloco);
+        bloco = anterior;
+    }
+    inicializarArena(arena);
+}
+
+/**
+ * Inicializa a pilha de reserva vazia
+ * @param pilha - Ponteiro para a estrutura da pilha
+ * @param armazenamento - Array com 'capacidade' posições
+ * @param capacidade - Quantidade máxima de peças na pilha
+ */
+void inicializarPilha(PilhaReserva *pilha, Peca *armazenamento, int capacidade) {
+    pilha->pecas = armazenamento;
+    pilha->capacidade = capacidade;
+    pilha->alocadas = capacidade;
+    pilha->arena = NULL;
+    pilha->topo = -1;  // Pilha começa vazia
+    pilha->hash = 0;
+    pilha->potencia = 1;
+    pilha->pecasTroca = 0;
+}
+
+/**
+ * Inicializa a pilha vazia com o array na arena: PILHA_INICIAL_ARENA
+ * posições agora, e o resto conforme a pilha crescer
+ * @param capacidade - Quantidade máxima de peças na pilha
+ * @return int - 1 em caso de sucesso, 0 se faltar memória
+ */
+int inicializarPilhaNaArena(PilhaReserva *pilha, Arena *arena, int capacidade) {
+    int alocadas = capacidade < PILHA_INICIAL_ARENA ? capacidade : PILHA_INICIAL_ARENA;
+    Peca *pecas = alocarNaArena(arena, (size_t)alocadas * sizeof(Peca));
+    if (pecas == NULL) {
+        return 0;
+    }
+    
+    inicializarPilha(pilha, pecas, capacidade);
+    pilha->alocadas = alocadas;
+    pilha->arena = arena;
+    return 1;
+}
+
+/**
+ * Garante que o array da pilha tenha pelo menos 'minimo' posições, dobrando
+ * o tamanho (até a capacidade) e copiando as peças para um array novo da arena
+ * @return int - 1 se há espaço, 0 se a pilha é fixa ou faltou memória
+ */
+int reservarNaPilha(PilhaReserva *pilha, int minimo) {
+    if (minimo <= pilha->alocadas) {
+        return 1;
+    }
+    if (pilha->arena == NULL || minimo > pilha->capacidade) {
+        return 0;
+    }
+    
+    int alocadas = pilha->alocadas * 2;
+    if (alocadas < minimo) {
+        alocadas = minimo;
+    }
+    if (alocadas > pilha->capacidade) {
+        alocadas = pilha->capacidade;
+    }
+    Peca *pecas = alocarNaArena(pilha->arena, (size_t)alocadas * sizeof(Peca));
+    if (pecas == NULL) {
+        return 0;
+    }
+    
+    memcpy(pecas, pilha->pecas, (size_t)(pilha->topo + 1) * sizeof(Peca));
+    pilha->pecas = pecas;
+    pilha->alocadas = alocadas;
+    return 1;
+}
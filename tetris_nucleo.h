@@ -0,0 +1,396 @@
+#ifndef TETRIS_NUCLEO_H
+#define TETRIS_NUCLEO_H
+
+// ---------------------------------------------------------------------------
+// Núcleo do Tetris Stack: peças, gerador, fila circular e pilha de reserva
+// ---------------------------------------------------------------------------
+// Compartilhado pelos três níveis (tetris_novato, tetris_aventureiro e
+// tetris_mestre) através da biblioteca estática libtetris_nucleo.a.
+// Nada aqui lê ou imprime: as mensagens ao jogador ficam em cada programa.
+// As funções chamadas a cada peça são static inline neste cabeçalho, para
+// que o compilador as expanda dentro dos programas; o resto fica em
+// tetris_nucleo.c (e com -flto também pode ser expandido no link).
+// PECA_COMPACTA muda o formato de Peca, então a biblioteca e os programas
+// precisam ser compilados com o mesmo valor (o Makefile passa o mesmo CFLAGS).
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TAMANHO_MAXIMO_FILA (1 << 20)
+#define CAPACIDADE_MAXIMA_PILHA (1 << 20)
+#define PILHA_INICIAL_ARENA 16    // Posições iniciais de uma pilha que cresce na arena
+
+// Tipos de peça; o índice neste array é o tipo guardado na forma compacta
+static const char TIPOS_PECA[] = {'I', 'O', 'T', 'L', 'J', 'S', 'Z'};
+
+#define BITS_TIPO_PECA 3  // 7 tipos cabem em 3 bits
+
+// Estrutura que representa uma peça do Tetris.
+// Compilando com -DPECA_COMPACTA=32 (ou 64) a peça vira uma única palavra de
+// 32 (ou 64) bits: tipo nos 3 bits baixos e id nos bits restantes (29 ou 61).
+// Os programas acessam as peças só por criarPeca/nomePeca/idPeca.
+#if defined(PECA_COMPACTA) && PECA_COMPACTA == 64
+typedef uint64_t Peca;
+typedef uint64_t IdPeca;
+#elif defined(PECA_COMPACTA) && PECA_COMPACTA == 32
+typedef uint32_t Peca;
+typedef uint32_t IdPeca;  // Ids acima de 2^29 - 1 dão a volta
+#else
+typedef struct {
+    char nome;  // Tipo da peça: 'I', 'O', 'T', 'L' (e 'J', 'S', 'Z' na sacola de 7)
+    int id;     // Identificador único da peça
+} Peca;
+typedef int IdPeca;
+#endif
+
+// Formato de impressão de uma peça: printf("Peça " FORMATO_PECA, ARGS_PECA(p))
+#define FORMATO_PECA "[%c %lld]"
+#define ARGS_PECA(p) nomePeca(p), (long long)idPeca(p)
+
+/**
+ * Monta uma peça a partir do índice do tipo (em TIPOS_PECA) e do id
+ */
+static inline Peca criarPeca(int tipo, IdPeca id) {
+#ifdef PECA_COMPACTA
+    return ((Peca)id << BITS_TIPO_PECA) | (Peca)tipo;
+#else
+    Peca peca;
+    peca.nome = TIPOS_PECA[tipo];
+    peca.id = id;
+    return peca;
+#endif
+}
+
+/**
+ * Retorna a letra do tipo da peça ('I', 'O', ...)
+ */
+static inline char nomePeca(Peca peca) {
+#ifdef PECA_COMPACTA
+    return TIPOS_PECA[peca & ((1u << BITS_TIPO_PECA) - 1)];
+#else
+    return peca.nome;
+#endif
+}
+
+/**
+ * Retorna o id da peça
+ */
+static inline IdPeca idPeca(Peca peca) {
+#ifdef PECA_COMPACTA
+    return (IdPeca)(peca >> BITS_TIPO_PECA);
+#else
+    return peca.id;
+#endif
+}
+
+/**
+ * Retorna o índice do tipo da peça em TIPOS_PECA (0 a 6)
+ */
+static inline int tipoPeca(Peca peca) {
+#ifdef PECA_COMPACTA
+    return (int)(peca & ((1u << BITS_TIPO_PECA) - 1));
+#else
+    // Letra -> índice, para 'I', 'O', 'T', 'L', 'J', 'S', 'Z'
+    static const int8_t INDICE_LETRA[26] = {
+        ['I' - 'A'] = 0, ['O' - 'A'] = 1, ['T' - 'A'] = 2, ['L' - 'A'] = 3,
+        ['J' - 'A'] = 4, ['S' - 'A'] = 5, ['Z' - 'A'] = 6
+    };
+    return INDICE_LETRA[(peca.nome - 'A') % 26];
+#endif
+}
+
+#define TAMANHO_LOTE_TIPOS 32     // Modo aleatório: 32 x 2 bits = uma saída de 64 bits
+#define TAMANHO_BUFFER_TIPOS 64   // Anel de tipos pré-gerados (potência de 2)
+
+// Como o gerador escolhe os tipos das peças
+typedef enum {
+    GERADOR_ALEATORIO = 0,  // Cada peça sorteada de forma independente entre I, O, T, L
+    GERADOR_SACOLA_4,       // Permutações embaralhadas de I, O, T, L
+    GERADOR_SACOLA_7        // Permutações embaralhadas dos 7 tetraminós
+} ModoGerador;
+
+// Fonte externa dos tipos das peças (a thread produtora de tetris_canal.h)
+typedef int (*ReceberTipo)(void *fonte);
+
+// Gerador de peças com estado próprio (xoshiro256**) e semente explícita
+typedef struct {
+    uint64_t estado[4];                    // Estado do xoshiro256**
+    ModoGerador modo;                      // Modo de sorteio dos tipos
+    uint8_t tipos[TAMANHO_BUFFER_TIPOS];   // Anel de tipos já sorteados (índices em TIPOS_PECA)
+    uint32_t leitura;                      // Total de tipos consumidos do anel
+    uint32_t escrita;                      // Total de tipos escritos no anel
+    ReceberTipo receberTipo;               // Entrega os tipos quando 'fonte' não é NULL
+    void *fonte;                           // Se não for NULL, os tipos vêm daqui e não do anel
+} GeradorPecas;
+
+// Arena: blocos grandes dos quais as alocações saem por incremento de um
+// ponteiro. Nada é liberado individualmente; liberarArena devolve todos os
+// blocos de uma vez, no fim da sessão, sem fragmentar o heap com pedaços
+// pequenos de muitas sessões.
+#define BLOCO_INICIAL_ARENA 1024          // Bytes do primeiro bloco
+#define BLOCO_MAXIMO_ARENA (64 * 1024)    // Os blocos dobram de tamanho até este limite
+#define ALINHAMENTO_ARENA 16
+
+typedef struct BlocoArena {
+    struct BlocoArena *anterior;          // Bloco alocado antes deste
+    size_t tamanho;                       // Bytes em 'dados'
+    size_t usado;                         // Bytes já entregues
+    _Alignas(ALINHAMENTO_ARENA) unsigned char dados[];
+} BlocoArena;
+
+typedef struct {
+    BlocoArena *atual;                    // Bloco de onde saem as alocações (NULL = arena vazia)
+    size_t proximoBloco;                  // Tamanho do próximo bloco
+    size_t reservado;                     // Total de bytes em blocos
+} Arena;
+
+// Estrutura que representa a fila circular de peças.
+// O tamanho da prévia (limite) é escolhido na inicialização; o array tem a
+// potência de 2 seguinte, para que o índice circular seja um AND com a máscara.
+typedef struct {
+    Peca *pecas;                // Array de peças (capacidade potência de 2)
+    int mascara;                // Capacidade do array - 1
+    int limite;                 // Quantidade máxima de peças na fila
+    int frente;                 // Índice da frente da fila
+    int tras;                   // Índice do final da fila
+    int tamanho;                // Quantidade atual de peças na fila
+    IdPeca proximoId;           // Próximo ID a ser atribuído
+    GeradorPecas *gerador;      // Gerador das novas peças da fila
+    uint64_t hash;              // Hash incremental do conteúdo, a partir da frente
+    uint64_t potencia;          // BASE_HASH_FILA^tamanho (peso da próxima posição)
+} FilaPecas;
+
+// Estrutura que representa a pilha de peças reservadas.
+// O array pertence a quem inicializa a pilha (o programa ou a tabela de sessões).
+// Uma pilha ligada a uma arena começa pequena e dobra o array, tirado da
+// arena, quando ele enche, até a capacidade; o array antigo fica na arena
+// até ela ser liberada.
+typedef struct {
+    Peca *pecas;                 // Array de peças reservadas
+    int capacidade;              // Quantidade máxima de peças na pilha
+    int alocadas;                // Posições do array atual (= capacidade sem arena)
+    Arena *arena;                // De onde vem o array quando ele cresce (NULL = fixo)
+    int topo;                    // Índice do topo da pilha (-1 = vazia)
+    uint64_t hash;               // Hash incremental do conteúdo, a partir da base
+    uint64_t potencia;           // BASE_HASH_PILHA^(topo + 1) (peso da próxima posição)
+    int pecasTroca;              // Peças trocadas pela ação 5 (0 = PECAS_TROCA_MULTIPLA)
+} PilhaReserva;
+
+// Hash incremental do estado (estilo Zobrist): cada peça vira uma chave de
+// 64 bits e a posição i recebe peso BASE^i (módulo 2^64), contando a partir
+// da frente da fila e da base da pilha. Como as bases são ímpares, têm
+// inverso módulo 2^64, e tirar a frente da fila é subtrair a chave dela e
+// multiplicar pelo inverso: toda operação atualiza o hash em O(1).
+#define BASE_HASH_FILA 0x9E3779B97F4A7C15ULL
+#define INVERSO_BASE_FILA 0xF1DE83E19937733DULL   // BASE_HASH_FILA^-1 mod 2^64
+#define BASE_HASH_PILHA 0xD6E8FEB86659FD93ULL
+#define INVERSO_BASE_PILHA 0xCFEE444D8B59A89BULL  // BASE_HASH_PILHA^-1 mod 2^64
+
+// Gerador de peças (tetris_nucleo.c)
+uint64_t proximoAleatorio(GeradorPecas *gerador);
+uint32_t aleatorioLimitado(GeradorPecas *gerador, uint32_t limite);
+void inicializarGerador(GeradorPecas *gerador, uint64_t semente, ModoGerador modo);
+void reabastecerTipos(GeradorPecas *gerador);
+void gerarPecasEmLote(GeradorPecas *gerador, Peca *destino, int quantidade, IdPeca idInicial);
+
+// Fila, arena e pilha
+int capacidadeFila(int limite);
+uint64_t recalcularHashEstado(const FilaPecas *fila, const PilhaReserva *pilha);
+void inicializarFilaEm(FilaPecas *fila, Peca *armazenamento, int limite,
+                       GeradorPecas *gerador);
+int inicializarFila(FilaPecas *fila, int limite, GeradorPecas *gerador);
+void liberarFila(FilaPecas *fila);
+void inicializarArena(Arena *arena);
+void *alocarNaArena(Arena *arena, size_t tamanho);
+void liberarArena(Arena *arena);
+void inicializarPilha(PilhaReserva *pilha, Peca *armazenamento, int capacidade);
+int inicializarPilhaNaArena(PilhaReserva *pilha, Arena *arena, int capacidade);
+int reservarNaPilha(PilhaReserva *pilha, int minimo);
+
+/**
+ * Avança o SplitMix64, usado apenas para espalhar a semente no estado
+ */
+static inline uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t rotl64(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+/**
+ * Retira o próximo tipo do anel pré-gerado do próprio gerador
+ * @return int - Índice do tipo em TIPOS_PECA
+ */
+static inline int sortearTipo(GeradorPecas *gerador) {
+    if (gerador->leitura == gerador->escrita) {
+        reabastecerTipos(gerador);
+    }
+    
+    return gerador->tipos[gerador->leitura++ & (TAMANHO_BUFFER_TIPOS - 1)];
+}
+
+/**
+ * Inverso de sortearTipo: devolve ao anel o último tipo retirado, para
+ * que ele saia de novo no próximo sorteio. O tipo é reescrito porque um
+ * reabastecimento posterior (já desfeito) pode ter usado a posição.
+ */
+static inline void devolverTipo(GeradorPecas *gerador, int tipo) {
+    gerador->tipos[--gerador->leitura & (TAMANHO_BUFFER_TIPOS - 1)] = (uint8_t)tipo;
+}
+
+/**
+ * Gera uma peça com um ID único. O tipo vem do anel pré-gerado do próprio
+ * gerador ou, se houver uma fonte ligada, dela (a thread produtora).
+ * @param gerador - Gerador de onde sai o tipo da peça
+ * @param id - Identificador único para a peça
+ * @return Peca - Nova peça gerada
+ */
+static inline Peca gerarPeca(GeradorPecas *gerador, IdPeca id) {
+    if (gerador->fonte != NULL) {
+        return criarPeca(gerador->receberTipo(gerador->fonte), id);
+    }
+    
+    return criarPeca(sortearTipo(gerador), id);
+}
+
+/**
+ * Chave de hash de uma peça (tipo e id), embaralhada como no SplitMix64
+ */
+static inline uint64_t chavePeca(Peca peca) {
+    uint64_t z = ((uint64_t)idPeca(peca) << BITS_TIPO_PECA | (uint64_t)tipoPeca(peca)) +
+                 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * Hash combinado da fila e da pilha, sem percorrer nenhuma das duas
+ */
+static inline uint64_t hashEstado(const FilaPecas *fila, const PilhaReserva *pilha) {
+    return fila->hash ^ rotl64(pilha->hash * 0x94D049BB133111EBULL, 29);
+}
+
+/**
+ * Verifica se a fila está vazia
+ */
+static inline int filaVazia(FilaPecas *fila) {
+    return fila->tamanho == 0;
+}
+
+/**
+ * Verifica se a fila está cheia
+ */
+static inline int filaCheia(FilaPecas *fila) {
+    return fila->tamanho == fila->limite;
+}
+
+/**
+ * Verifica se a pilha está vazia
+ */
+static inline int pilhaVazia(PilhaReserva *pilha) {
+    return pilha->topo == -1;
+}
+
+/**
+ * Verifica se a pilha está cheia
+ */
+static inline int pilhaCheia(PilhaReserva *pilha) {
+    return pilha->topo == pilha->capacidade - 1;
+}
+
+/**
+ * Adiciona uma nova peça gerada ao final da fila
+ */
+static inline void adicionarPecaNaFila(FilaPecas *fila) {
+    if (filaCheia(fila)) {
+        return;  // Não adiciona se já está cheia
+    }
+    
+    // Gera e insere nova peça no final
+    Peca novaPeca = gerarPeca(fila->gerador, fila->proximoId);
+    fila->pecas[fila->tras] = novaPeca;
+    fila->tras = (fila->tras + 1) & fila->mascara;
+    fila->tamanho++;
+    fila->proximoId++;
+    
+    fila->hash += chavePeca(novaPeca) * fila->potencia;
+    fila->potencia *= BASE_HASH_FILA;
+}
+
+/**
+ * Remove e retorna a peça da frente da fila
+ */
+static inline Peca removerDaFila(FilaPecas *fila) {
+    Peca pecaRemovida = fila->pecas[fila->frente];
+    fila->frente = (fila->frente + 1) & fila->mascara;
+    fila->tamanho--;
+    
+    // Todas as posições andam uma para a frente: divide os pesos por BASE
+    fila->hash = (fila->hash - chavePeca(pecaRemovida)) * INVERSO_BASE_FILA;
+    fila->potencia *= INVERSO_BASE_FILA;
+    return pecaRemovida;
+}
+
+/**
+ * Empilha uma peça no topo da pilha de reserva (push)
+ * @param pilha - Ponteiro para a estrutura da pilha
+ * @param peca - Peça a ser empilhada
+ */
+static inline void empilharPeca(PilhaReserva *pilha, Peca peca) {
+    pilha->topo++;
+    pilha->pecas[pilha->topo] = peca;
+    pilha->hash += chavePeca(peca) * pilha->potencia;
+    pilha->potencia *= BASE_HASH_PILHA;
+}
+
+/**
+ * Remove e retorna a peça do topo da pilha (pop)
+ */
+static inline Peca desempilharPeca(PilhaReserva *pilha) {
+    Peca peca = pilha->pecas[pilha->topo];
+    pilha->topo--;
+    pilha->potencia *= INVERSO_BASE_PILHA;
+    pilha->hash -= chavePeca(peca) * pilha->potencia;
+    return peca;
+}
+
+/**
+ * Retorna a última peça inserida na fila
+ */
+static inline Peca ultimaPecaDaFila(FilaPecas *fila) {
+    return fila->pecas[(fila->tras - 1) & fila->mascara];
+}
+
+/**
+ * Inverso de removerDaFila: põe a peça de volta na frente
+ */
+static inline void devolverAFrenteDaFila(FilaPecas *fila, Peca peca) {
+    fila->frente = (fila->frente - 1) & fila->mascara;
+    fila->pecas[fila->frente] = peca;
+    fila->tamanho++;
+    
+    // Todas as posições andam uma para trás: multiplica os pesos por BASE
+    fila->hash = fila->hash * BASE_HASH_FILA + chavePeca(peca);
+    fila->potencia *= BASE_HASH_FILA;
+}
+
+/**
+ * Inverso de adicionarPecaNaFila (sem mexer no gerador nem em proximoId):
+ * remove e retorna a última peça da fila
+ */
+static inline Peca removerDoFinalDaFila(FilaPecas *fila) {
+    fila->tras = (fila->tras - 1) & fila->mascara;
+    Peca peca = fila->pecas[fila->tras];
+    fila->tamanho--;
+    
+    fila->potencia *= INVERSO_BASE_FILA;
+    fila->hash -= chavePeca(peca) * fila->potencia;
+    return peca;
+}
+
+#endif  // TETRIS_NUCLEO_H